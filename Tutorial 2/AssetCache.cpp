@@ -0,0 +1,176 @@
+#include "AssetCache.h"
+#include "MeshCache.h"
+#include "Hash.h"
+#include <sstream>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	///Asset methods
+
+	bool Asset::InUse() const
+	{
+		if (triangle_mesh && (triangle_mesh->getReferenceCount() > 1))
+			return true;
+		if (convex_mesh && (convex_mesh->getReferenceCount() > 1))
+			return true;
+		for (PxU32 i = 0; i < convex_hulls.size(); i++)
+			if (convex_hulls[i]->getReferenceCount() > 1)
+				return true;
+		return false;
+	}
+
+	void Asset::Release()
+	{
+		if (triangle_mesh)
+			triangle_mesh->release();
+		if (convex_mesh)
+			convex_mesh->release();
+		for (PxU32 i = 0; i < convex_hulls.size(); i++)
+			convex_hulls[i]->release();
+		*this = Asset();
+	}
+
+	///AssetCache methods
+
+	string AssetCache::Key(const string& path, const PxVec3& scale, const string& variant)
+	{
+		ostringstream key;
+		key << path << "|" << scale.x << "," << scale.y << "," << scale.z << "|" << variant;
+		return key.str();
+	}
+
+	bool AssetCache::Find(const string& key, Asset& asset) const
+	{
+		lock_guard<mutex> lock(assets_mutex);
+		map<string, Asset>::const_iterator found = assets.find(key);
+		if (found == assets.end())
+			return false;
+		asset = found->second;
+		return true;
+	}
+
+	void AssetCache::Insert(const string& key, Asset& asset)
+	{
+		lock_guard<mutex> lock(assets_mutex);
+		pair<map<string, Asset>::iterator, bool> inserted = assets.insert(make_pair(key, asset));
+		if (!inserted.second)
+		{
+			asset.Release();
+			asset = inserted.first->second;
+		}
+	}
+
+	PxU32 AssetCache::Collect()
+	{
+		lock_guard<mutex> lock(assets_mutex);
+		PxU32 count = 0;
+		for (map<string, Asset>::iterator it = assets.begin(); it != assets.end();)
+		{
+			if (it->second.InUse())
+			{
+				it++;
+				continue;
+			}
+			it->second.Release();
+			it = assets.erase(it);
+			count++;
+		}
+		return count;
+	}
+
+	void AssetCache::Clear()
+	{
+		lock_guard<mutex> lock(assets_mutex);
+		for (map<string, Asset>::iterator it = assets.begin(); it != assets.end(); it++)
+			it->second.Release();
+		assets.clear();
+	}
+
+	PxU32 AssetCache::Size() const
+	{
+		lock_guard<mutex> lock(assets_mutex);
+		return (PxU32)assets.size();
+	}
+
+	AssetCache& GetAssetCache()
+	{
+		static AssetCache cache;
+		return cache;
+	}
+
+	//meshes built in code have no path, their vertices and triangles stand in for it
+	static string ContentKey(const char* type, const vector<PxVec3>& vertices, const vector<PxU32>& indices, const string& variant)
+	{
+		Hasher hasher;
+		hasher.Add((PxU64)vertices.size());
+		if (!vertices.empty())
+			hasher.Add(vertices.data(), vertices.size() * sizeof(PxVec3));
+		hasher.Add((PxU64)indices.size());
+		if (!indices.empty())
+			hasher.Add(indices.data(), indices.size() * sizeof(PxU32));
+		return AssetCache::Key(string(type) + ":" + hasher.Hex(), PxVec3(1.f), variant);
+	}
+
+	static string OptionsVariant(const CookingOptions& options)
+	{
+		ostringstream variant;
+		variant << options.midphase << " " << options.weld_tolerance << " " << options.clean_mesh << options.active_edges << options.runtime;
+		return variant.str();
+	}
+
+	PxTriangleMesh* CookSharedTriangleMesh(const vector<PxVec3>& vertices, const vector<PxU32>& indices, const CookingOptions& options)
+	{
+		string key = ContentKey("triangle", vertices, indices, OptionsVariant(options));
+		Asset asset;
+		if (GetAssetCache().Find(key, asset))
+			return asset.triangle_mesh;
+
+		PxTriangleMeshDesc mesh_desc;
+		mesh_desc.points.count = (PxU32)vertices.size();
+		mesh_desc.points.stride = sizeof(PxVec3);
+		mesh_desc.points.data = &vertices.front();
+		mesh_desc.triangles.count = (PxU32)indices.size() / 3;
+		mesh_desc.triangles.stride = 3 * sizeof(PxU32);
+		mesh_desc.triangles.data = &indices.front();
+
+		asset.triangle_mesh = CookTriangleMesh(mesh_desc, options);
+		GetAssetCache().Insert(key, asset);
+		return asset.triangle_mesh;
+	}
+
+	PxConvexMesh* CookSharedConvexMesh(const vector<PxVec3>& vertices, const CookingOptions& options)
+	{
+		string key = ContentKey("convex", vertices, vector<PxU32>(), OptionsVariant(options));
+		Asset asset;
+		if (GetAssetCache().Find(key, asset))
+			return asset.convex_mesh;
+
+		PxConvexMeshDesc mesh_desc;
+		mesh_desc.points.count = (PxU32)vertices.size();
+		mesh_desc.points.stride = sizeof(PxVec3);
+		mesh_desc.points.data = &vertices.front();
+		mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+		mesh_desc.vertexLimit = 256;
+
+		asset.convex_mesh = CookConvexMesh(mesh_desc, options);
+		GetAssetCache().Insert(key, asset);
+		return asset.convex_mesh;
+	}
+
+	vector<PxConvexMesh*> CookSharedConvexHulls(const vector<PxVec3>& vertices, const vector<PxU32>& indices, const DecompositionParams& params)
+	{
+		ostringstream variant;
+		variant << params.max_hulls << " " << params.resolution << " " << params.concavity << " " << params.hull_vertex_limit;
+		string key = ContentKey("hulls", vertices, indices, variant.str());
+		Asset asset;
+		if (GetAssetCache().Find(key, asset))
+			return asset.convex_hulls;
+
+		asset.convex_hulls = CookConvexHulls(DecomposeConvexCached(vertices, indices, params), params);
+		GetAssetCache().Insert(key, asset);
+		return asset.convex_hulls;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include "Model.h"
+#include "ConvexDecomposition.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <mutex>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///Meshes cooked from one asset
+	struct Asset
+	{
+		PxTriangleMesh* triangle_mesh;
+		//full detail model drawn instead of a simplified triangle mesh
+		shared_ptr<const Model> render_model;
+		PxConvexMesh* convex_mesh;
+		vector<PxConvexMesh*> convex_hulls;
+
+		Asset() : triangle_mesh(0), convex_mesh(0) {}
+
+		///Is any of the collision meshes used by a shape? (the cache holds one reference itself)
+		bool InUse() const;
+
+		///Release the meshes
+		void Release();
+	};
+
+	///Cooked meshes shared by every actor built from the same asset
+	///Assets are keyed by their path, scale and how they were cooked, so identical bodies share a single set of
+	///PhysX meshes. PhysX counts the references of its meshes: every shape holds one and the cache holds one more,
+	///Collect releases the assets whose meshes are no longer used by any shape.
+	class AssetCache
+	{
+		mutable mutex assets_mutex;
+		map<string, Asset> assets;
+
+	public:
+		///Build a key from the asset path, its scale and a description of how it is cooked
+		static string Key(const string& path, const PxVec3& scale, const string& variant);
+
+		///Get the meshes of a cached asset, returns false if it is not in the cache
+		bool Find(const string& key, Asset& asset) const;
+
+		///Store freshly cooked meshes
+		///If another thread stored the same asset first its meshes replace the given ones, which are released.
+		void Insert(const string& key, Asset& asset);
+
+		///Release the assets no actor uses any more, returns how many were released
+		PxU32 Collect();
+
+		///Release all assets, required before PhysX is released
+		void Clear();
+
+		///Number of cached assets
+		PxU32 Size() const;
+	};
+
+	///Get the asset cache shared by the loaders
+	AssetCache& GetAssetCache();
+
+	///Cook a triangle mesh, or share the one cooked before from the same vertices, triangles and options
+	///Meshes built in code are keyed by their content, the asset cache owns them and Collect releases them
+	///once no shape uses them.
+	PxTriangleMesh* CookSharedTriangleMesh(const vector<PxVec3>& vertices, const vector<PxU32>& indices,
+		const CookingOptions& options=CookingOptions());
+
+	///Cook the convex hull of the vertices, or share the one cooked before (see above)
+	PxConvexMesh* CookSharedConvexMesh(const vector<PxVec3>& vertices, const CookingOptions& options=CookingOptions());
+
+	///Decompose a concave model and cook its hulls, or share the ones cooked before (see above)
+	vector<PxConvexMesh*> CookSharedConvexHulls(const vector<PxVec3>& vertices, const vector<PxU32>& indices,
+		const DecompositionParams& params=DecompositionParams());
+}
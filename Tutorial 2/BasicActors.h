@@ -1,6 +1,9 @@
 #pragma once
 
 #include "PhysicsEngine.h"
+#include "MeshCache.h"
+#include "ConvexDecomposition.h"
+#include "AssetCache.h"
 #include <iostream>
 #include <iomanip>
 
@@ -76,31 +79,24 @@ namespace PhysicsEngine
 	class ConvexMesh : public DynamicActor
 	{
 	public:
-		//constructor
+		//constructor, actors built from the same vertices share their mesh (see CookSharedConvexMesh)
 		ConvexMesh(const std::vector<PxVec3>& verts, const PxTransform& pose=PxTransform(PxIdentity), PxReal density=1.f)
 			: DynamicActor(pose)
 		{
-			PxConvexMeshDesc mesh_desc;
-			mesh_desc.points.count = (PxU32)verts.size();
-			mesh_desc.points.stride = sizeof(PxVec3);
-			mesh_desc.points.data = &verts.front();
-			mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
-			mesh_desc.vertexLimit = 256;
+			CreateShape(PxConvexMeshGeometry(CookSharedConvexMesh(verts)), density);
+		}
 
-			CreateShape(PxConvexMeshGeometry(CookMesh(mesh_desc)), density);
+		//constructor from an already cooked mesh
+		ConvexMesh(PxConvexMesh* mesh, const PxTransform& pose=PxTransform(PxIdentity), PxReal density=1.f)
+			: DynamicActor(pose)
+		{
+			CreateShape(PxConvexMeshGeometry(mesh), density);
 		}
 
-		//mesh cooking (preparation)
+		//mesh cooking (preparation), reuses the on-disk cache when possible
 		PxConvexMesh* CookMesh(const PxConvexMeshDesc& mesh_desc)
 		{
-			PxDefaultMemoryOutputStream stream;
-
-			if(!GetCooking()->cookConvexMesh(mesh_desc, stream))
-				throw new Exception("ConvexMesh::CookMesh, cooking failed.");
-
-			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
-
-			return GetPhysics()->createConvexMesh(input);
+			return CookConvexMesh(mesh_desc);
 		}
 	};
 
@@ -108,64 +104,86 @@ namespace PhysicsEngine
 	class TriangleMesh : public StaticActor
 	{
 	public:
-		//constructor
-		TriangleMesh(const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const PxTransform& pose=PxTransform(PxIdentity))
+		//constructor, actors built from the same data share their mesh (see CookSharedTriangleMesh)
+		TriangleMesh(const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const PxTransform& pose=PxTransform(PxIdentity),
+			const CookingOptions& options=CookingOptions())
 			: StaticActor(pose)
 		{
-			PxTriangleMeshDesc mesh_desc;
-			mesh_desc.points.count = (PxU32)verts.size();
-			mesh_desc.points.stride = sizeof(PxVec3);
-			mesh_desc.points.data = &verts.front();
-			mesh_desc.triangles.count = (PxU32)trigs.size()/3;
-			mesh_desc.triangles.stride = 3*sizeof(PxU32);
-			mesh_desc.triangles.data = &trigs.front();
-
-			CreateShape(PxTriangleMeshGeometry(CookMesh(mesh_desc)));
+			CreateShape(PxTriangleMeshGeometry(CookSharedTriangleMesh(verts, trigs, options)));
 		}
 
-		//mesh cooking (preparation)
-		PxTriangleMesh* CookMesh(const PxTriangleMeshDesc& mesh_desc)
+		//constructor from an already cooked mesh
+		TriangleMesh(PxTriangleMesh* mesh, const PxTransform& pose=PxTransform(PxIdentity))
+			: StaticActor(pose)
 		{
-			PxDefaultMemoryOutputStream stream;
+			CreateShape(PxTriangleMeshGeometry(mesh));
+		}
 
-			if(!GetCooking()->cookTriangleMesh(mesh_desc, stream))
-				throw new Exception("TriangleMesh::CookMesh, cooking failed.");
+		//mesh cooking (preparation), reuses the on-disk cache when possible
+		PxTriangleMesh* CookMesh(const PxTriangleMeshDesc& mesh_desc, const CookingOptions& options=CookingOptions())
+		{
+			return CookTriangleMesh(mesh_desc, options);
+		}
+	};
 
-			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+	///A static triangle mesh with a material table (see MergedMesh)
+	///The material index of every triangle selects both its material and its color.
+	class MaterialTriangleMesh : public StaticActor
+	{
+		std::vector<PxVec3> material_colors;
 
-			return GetPhysics()->createTriangleMesh(input);
+	public:
+		//constructor from an already cooked mesh with material indices
+		MaterialTriangleMesh(PxTriangleMesh* mesh, const std::vector<PxMaterial*>& materials, const std::vector<PxVec3>& _material_colors,
+			const PxTransform& pose=PxTransform(PxIdentity))
+			: StaticActor(pose), material_colors(_material_colors)
+		{
+			CreateShape(PxTriangleMeshGeometry(mesh));
+			GetShape()->setMaterials(&materials.front(), (PxU16)materials.size());
+			((UserData*)GetShape()->userData)->material_colors = &material_colors.front();
+			((UserData*)GetShape()->userData)->material_count = (PxU32)material_colors.size();
 		}
 	};
 
+	///Dynamic triangle meshes can only be kinematic in PhysX, use CompoundConvexMesh for simulated concave objects
 	class TriangleMeshDynamic : public DynamicActor
 	{
 	public:
-		//constructor
-		TriangleMeshDynamic(const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const PxTransform& pose = PxTransform(PxIdentity), PxReal density = 1.f)
+		//constructor, actors built from the same data share their mesh (see CookSharedTriangleMesh)
+		TriangleMeshDynamic(const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const PxTransform& pose = PxTransform(PxIdentity), PxReal density = 1.f,
+			const CookingOptions& options = CookingOptions())
 			: DynamicActor(pose)
 		{
-			PxTriangleMeshDesc mesh_desc;
-			mesh_desc.points.count = (PxU32)verts.size();
-			mesh_desc.points.stride = sizeof(PxVec3);
-			mesh_desc.points.data = &verts.front();
-			mesh_desc.triangles.count = (PxU32)trigs.size() / 3;
-			mesh_desc.triangles.stride = 3 * sizeof(PxU32);
-			mesh_desc.triangles.data = &trigs.front();
-
-			CreateShape(PxTriangleMeshGeometry(CookMesh(mesh_desc)), density);
+			CreateShape(PxTriangleMeshGeometry(CookSharedTriangleMesh(verts, trigs, options)), density);
 		}
 
-		//mesh cooking (preparation)
-		PxTriangleMesh* CookMesh(const PxTriangleMeshDesc& mesh_desc)
+		//mesh cooking (preparation), reuses the on-disk cache when possible
+		PxTriangleMesh* CookMesh(const PxTriangleMeshDesc& mesh_desc, const CookingOptions& options=CookingOptions())
 		{
-			PxDefaultMemoryOutputStream stream;
-
-			if (!GetCooking()->cookTriangleMesh(mesh_desc, stream))
-				throw new Exception("TriangleMesh::CookMesh, cooking failed.");
+			return CookTriangleMesh(mesh_desc, options);
+		}
+	};
 
-			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+	///A concave dynamic object made from a compound of convex hulls
+	class CompoundConvexMesh : public DynamicActor
+	{
+	public:
+		//constructor, decomposes the mesh (or reads the decomposition from the mesh cache), the hulls are shared (see CookSharedConvexHulls)
+		CompoundConvexMesh(const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const PxTransform& pose=PxTransform(PxIdentity),
+			PxReal density=1.f, const DecompositionParams& params=DecompositionParams())
+			: DynamicActor(pose)
+		{
+			std::vector<PxConvexMesh*> meshes = CookSharedConvexHulls(verts, trigs, params);
+			for (PxU32 i = 0; i < meshes.size(); i++)
+				CreateShape(PxConvexMeshGeometry(meshes[i]), density);
+		}
 
-			return GetPhysics()->createTriangleMesh(input);
+		//constructor from already cooked hulls
+		CompoundConvexMesh(const std::vector<PxConvexMesh*>& meshes, const PxTransform& pose=PxTransform(PxIdentity), PxReal density=1.f)
+			: DynamicActor(pose)
+		{
+			for (PxU32 i = 0; i < meshes.size(); i++)
+				CreateShape(PxConvexMeshGeometry(meshes[i]), density);
 		}
 	};
 
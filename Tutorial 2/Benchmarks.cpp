@@ -0,0 +1,434 @@
+#include "Benchmarks.h"
+#include "ModelLoader.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+#include "ObjParser.h"
+#include "FileIO.h"
+#include "ThreadPool.h"
+#include "BasicActors.h"
+#include "Extras\Renderer.h"
+#include "Extras\FrameCapture.h"
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <deque>
+
+namespace Benchmarks
+{
+	using namespace physx;
+	using namespace PhysicsEngine;
+	using namespace VisualDebugger;
+	using namespace std;
+
+	typedef chrono::high_resolution_clock Clock;
+
+	double Milliseconds(Clock::time_point start)
+	{
+		return chrono::duration<double, milli>(Clock::now() - start).count();
+	}
+
+	//deterministic random numbers so that every run queries the same points
+	class Random
+	{
+		PxU32 state;
+
+	public:
+		Random(PxU32 seed=12345) : state(seed) {}
+
+		PxReal Next()
+		{
+			state = state * 1664525u + 1013904223u;
+			return (PxReal)(state >> 8) / (PxReal)(1 << 24);
+		}
+
+		PxVec3 Direction()
+		{
+			PxVec3 dir(Next()*2.f - 1.f, Next()*2.f - 1.f, Next()*2.f - 1.f);
+			return dir.isZero() ? PxVec3(0.f, -1.f, 0.f) : dir.getNormalized();
+		}
+	};
+
+	//balls resting slightly inside random triangles, like a ball rolling on the course
+	vector<PxVec3> BallPositions(const vector<PxVec3>& vertices, const vector<PxU32>& indices, PxU32 count, PxReal radius, Random& random)
+	{
+		vector<PxVec3> positions(count);
+		for (PxU32 i = 0; i < count; i++)
+		{
+			PxU32 trig = (PxU32)(random.Next() * (indices.size() / 3)) % (PxU32)(indices.size() / 3);
+			const PxVec3& v0 = vertices[indices[trig * 3]];
+			const PxVec3& v1 = vertices[indices[trig * 3 + 1]];
+			const PxVec3& v2 = vertices[indices[trig * 3 + 2]];
+			PxVec3 normal = (v1 - v0).cross(v2 - v0).getNormalized();
+			positions[i] = (v0 + v1 + v2) / 3.f + normal * (radius * .8f);
+		}
+		return positions;
+	}
+
+	//average cost of a ball contact against the mesh in microseconds
+	double ContactTime(PxTriangleMesh* mesh, const vector<PxVec3>& positions, PxReal radius, PxU32& contacts)
+	{
+		PxTriangleMeshGeometry geometry(mesh);
+		PxTransform pose(PxIdentity);
+		PxSphereGeometry ball(radius);
+
+		contacts = 0;
+		Clock::time_point start = Clock::now();
+		for (PxU32 i = 0; i < positions.size(); i++)
+		{
+			PxVec3 direction;
+			PxF32 depth;
+			contacts += PxGeometryQuery::computePenetration(direction, depth, ball, PxTransform(positions[i]), geometry, pose) ? 1 : 0;
+		}
+		return Milliseconds(start) * 1000.0 / positions.size();
+	}
+
+	void CookingPresets(const string& path)
+	{
+		const PxU32 cook_repeats = 3;
+		const PxU32 ray_count = 100000;
+		const PxU32 contact_count = 20000;
+		const PxReal ball_radius = .25f;
+
+		ModelImport importer;
+		vector<PxVec3> vertices;
+		vector<PxU32> indices;
+		importer.LoadOBJ(path.c_str(), vertices, indices);
+
+		PxTriangleMeshDesc mesh_desc;
+		mesh_desc.points.count = (PxU32)vertices.size();
+		mesh_desc.points.stride = sizeof(PxVec3);
+		mesh_desc.points.data = &vertices.front();
+		mesh_desc.triangles.count = (PxU32)indices.size() / 3;
+		mesh_desc.triangles.stride = 3 * sizeof(PxU32);
+		mesh_desc.triangles.data = &indices.front();
+
+		PxBounds3 bounds = PxBounds3::empty();
+		for (PxU32 i = 0; i < vertices.size(); i++)
+			bounds.include(vertices[i]);
+
+		//query inputs shared by every preset
+		Random random;
+		vector<PxVec3> ray_origins(ray_count), ray_dirs(ray_count);
+		for (PxU32 i = 0; i < ray_count; i++)
+		{
+			ray_origins[i] = bounds.minimum + bounds.getDimensions().multiply(PxVec3(random.Next(), random.Next(), random.Next()));
+			ray_dirs[i] = random.Direction();
+		}
+		vector<PxVec3> ball_positions = BallPositions(vertices, indices, contact_count, ball_radius, random);
+		const PxReal max_distance = bounds.getDimensions().magnitude();
+
+		vector<CookingOptions> presets;
+		presets.push_back(CookingOptions());
+		presets.push_back(CookingOptions::Runtime());
+		presets.push_back(CookingOptions::QualityBVH33());
+		presets.push_back(CookingOptions::QualityBVH34());
+
+		cout << "Cooking presets: " << path << " (" << vertices.size() << " verts, " << indices.size() / 3 << " trigs)" << endl;
+		cout << left << setw(40) << "  preset" << right << setw(12) << "cook ms" << setw(12) << "cooked KB" << setw(12) << "memory KB"
+			<< setw(14) << "raycast us" << setw(14) << "contact us" << endl;
+		cout << fixed << setprecision(3);
+
+		for (PxU32 p = 0; p < presets.size(); p++)
+		{
+			PxCooking* cooking = GetCooking(presets[p]);
+
+			//cook straight into memory, the on-disk cache would hide the cooking cost
+			double cook_time = 0.0;
+			PxDefaultMemoryOutputStream stream;
+			for (PxU32 i = 0; i < cook_repeats; i++)
+			{
+				PxDefaultMemoryOutputStream repeat_stream;
+				Clock::time_point start = Clock::now();
+				if (!cooking->cookTriangleMesh(mesh_desc, (i == 0) ? (PxOutputStream&)stream : (PxOutputStream&)repeat_stream))
+					throw new Exception("Benchmarks::CookingPresets, cooking failed.");
+				cook_time += Milliseconds(start);
+			}
+			cook_time /= cook_repeats;
+
+			//the memory of the mesh at runtime is what PhysX allocates for it, the cooked stream is only its file size
+			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+			size_t allocated = PxAllocatedBytes();
+			PxTriangleMesh* mesh = GetPhysics()->createTriangleMesh(input);
+			size_t mesh_memory = PxAllocatedBytes() - allocated;
+			PxTriangleMeshGeometry geometry(mesh);
+			PxTransform pose(PxIdentity);
+
+			PxU32 hits = 0;
+			Clock::time_point start = Clock::now();
+			for (PxU32 i = 0; i < ray_count; i++)
+			{
+				PxRaycastHit hit;
+				hits += PxGeometryQuery::raycast(ray_origins[i], ray_dirs[i], geometry, pose, max_distance, PxHitFlag::eDEFAULT, 1, &hit);
+			}
+			double raycast_time = Milliseconds(start) * 1000.0 / ray_count;
+
+			PxU32 contacts;
+			double contact_time = ContactTime(mesh, ball_positions, ball_radius, contacts);
+
+			cout << "  " << left << setw(38) << presets[p].Name() << right << setw(12) << cook_time
+				<< setw(12) << stream.getSize() / 1024.0 << setw(12) << mesh_memory / 1024.0 << setw(14) << raycast_time << setw(14) << contact_time
+				<< "   (" << hits << " hits, " << contacts << " contacts)" << endl;
+
+			mesh->release();
+		}
+
+		cout.unsetf(ios::floatfield);
+	}
+
+	void Simplification(const string& path)
+	{
+		const PxU32 contact_count = 20000;
+		const PxReal ball_radius = .25f;
+		const PxReal tolerances[] = { 0.f, .001f, .005f, .01f, .05f };
+
+		ModelImport importer;
+		vector<PxVec3> vertices;
+		vector<PxU32> indices;
+		importer.LoadOBJ(path.c_str(), vertices, indices);
+
+		//the same balls for every tolerance, placed on the full detail model
+		Random random;
+		vector<PxVec3> ball_positions = BallPositions(vertices, indices, contact_count, ball_radius, random);
+
+		cout << "Collision mesh simplification: " << path << " (" << vertices.size() << " verts, " << indices.size() / 3 << " trigs)" << endl;
+		cout << setw(12) << "tolerance" << setw(10) << "trigs" << setw(12) << "reduction" << setw(14) << "simplify ms"
+			<< setw(14) << "contact us" << setw(10) << "speedup" << endl;
+		cout << fixed << setprecision(3);
+
+		double full_contact_time = 0.0;
+		for (PxU32 t = 0; t < sizeof(tolerances) / sizeof(tolerances[0]); t++)
+		{
+			vector<PxVec3> collision_vertices = vertices;
+			vector<PxU32> collision_indices = indices;
+
+			Clock::time_point start = Clock::now();
+			if (tolerances[t] > 0.f)
+				SimplifyMesh(vertices, indices, tolerances[t], collision_vertices, collision_indices);
+			double simplify_time = Milliseconds(start);
+
+			PxTriangleMeshDesc mesh_desc;
+			mesh_desc.points.count = (PxU32)collision_vertices.size();
+			mesh_desc.points.stride = sizeof(PxVec3);
+			mesh_desc.points.data = &collision_vertices.front();
+			mesh_desc.triangles.count = (PxU32)collision_indices.size() / 3;
+			mesh_desc.triangles.stride = 3 * sizeof(PxU32);
+			mesh_desc.triangles.data = &collision_indices.front();
+
+			PxDefaultMemoryOutputStream stream;
+			if (!GetCooking()->cookTriangleMesh(mesh_desc, stream))
+				throw new Exception("Benchmarks::Simplification, cooking failed.");
+			//the memory of the mesh at runtime is what PhysX allocates for it, the cooked stream is only its file size
+			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+			size_t allocated = PxAllocatedBytes();
+			PxTriangleMesh* mesh = GetPhysics()->createTriangleMesh(input);
+			size_t mesh_memory = PxAllocatedBytes() - allocated;
+
+			PxU32 contacts;
+			double contact_time = ContactTime(mesh, ball_positions, ball_radius, contacts);
+			if (t == 0)
+				full_contact_time = contact_time;
+
+			cout << setw(12) << tolerances[t] << setw(10) << collision_indices.size() / 3
+				<< setw(11) << 100.0 * (1.0 - (double)collision_indices.size() / indices.size()) << "%"
+				<< setw(14) << simplify_time << setw(14) << contact_time << setw(9) << full_contact_time / contact_time << "x"
+				<< "   (" << contacts << " contacts)" << endl;
+
+			mesh->release();
+		}
+
+		cout.unsetf(ios::floatfield);
+	}
+
+	void ObjParsing(const string& path)
+	{
+		const PxU32 repeats = 5;
+
+		MappedFile file(path);
+		if (!file.IsOpen())
+			throw new Exception("Benchmarks::ObjParsing, cannot open the model.");
+		const char* data = (const char*)file.Data();
+		double megabytes = file.Size() / (1024.0 * 1024.0);
+		unsigned int threads = GetThreadPool().Size();
+
+		ModelImport importer;
+		vector<PxVec3> vertices, reference_vertices;
+		vector<PxU32> indices, reference_indices;
+
+		//the file is read once before timing, so all parsers start from the file cache
+		importer.LoadOBJ2(path.c_str(), vertices, indices);
+		ParseOBJ(data, file.Size(), reference_vertices, reference_indices, 1);
+		bool agree = (vertices == reference_vertices) && (indices == reference_indices);
+
+		double stream_time = 0.0, single_time = 0.0, parallel_time = 0.0;
+		bool identical = true;
+		for (PxU32 i = 0; i < repeats; i++)
+		{
+			vertices.clear();
+			indices.clear();
+			Clock::time_point start = Clock::now();
+			importer.LoadOBJ2(path.c_str(), vertices, indices);
+			stream_time += Milliseconds(start);
+
+			vertices.clear();
+			indices.clear();
+			start = Clock::now();
+			ParseOBJ(data, file.Size(), vertices, indices, 1);
+			single_time += Milliseconds(start);
+
+			vertices.clear();
+			indices.clear();
+			start = Clock::now();
+			ParseOBJ(data, file.Size(), vertices, indices, threads);
+			parallel_time += Milliseconds(start);
+
+			//the chunked parse has to give the same bytes as the sequential one
+			identical = identical && (vertices.size() == reference_vertices.size()) && (indices == reference_indices) &&
+				(vertices.empty() || !memcmp(&vertices.front(), &reference_vertices.front(), vertices.size() * sizeof(PxVec3)));
+		}
+		stream_time /= repeats;
+		single_time /= repeats;
+		parallel_time /= repeats;
+
+		cout << "OBJ parsing: " << path << " (" << fixed << setprecision(2) << megabytes << " MB, "
+			<< reference_vertices.size() << " verts, " << reference_indices.size() / 3 << " trigs)" << endl;
+		cout << left << setw(24) << "  parser" << right << setw(12) << "ms" << setw(12) << "MB/s" << endl;
+		cout << left << setw(24) << "  LoadOBJ2 (streams)" << right << setw(12) << stream_time << setw(12) << megabytes / (stream_time / 1000.0) << endl;
+		cout << left << setw(24) << "  ParseOBJ (1 thread)" << right << setw(12) << single_time << setw(12) << megabytes / (single_time / 1000.0)
+			<< "   (" << stream_time / single_time << "x)" << endl;
+		cout << left << setw(24) << ("  ParseOBJ (" + to_string(threads) + " threads)") << right << setw(12) << parallel_time
+			<< setw(12) << megabytes / (parallel_time / 1000.0) << "   (" << stream_time / parallel_time << "x)" << endl;
+		//LoadOBJ2 only reads v/t/n faces
+		if (!agree)
+			cout << "  LoadOBJ2 disagrees on this model" << endl;
+		if (!identical)
+			cout << "  the threaded parse differs from the sequential one" << endl;
+		cout.unsetf(ios::floatfield);
+	}
+
+	//draw frames of the scene, stepping it every frame, and return the time in ms
+	double RenderFrames(Scene& scene, PxU32 frame_count)
+	{
+		const PxVec3 eye(0.f, 12.f, 28.f);
+		Clock::time_point start = Clock::now();
+		for (PxU32 i = 0; i < frame_count; i++)
+		{
+			scene.Update(1.f / 60.f);
+			Renderer::Start(eye, (PxVec3(0.f, 2.f, 0.f) - eye).getNormalized());
+			vector<PxActor*> actors = scene.GetAllActors();
+			if (actors.size())
+				Renderer::Render(&actors[0], (PxU32)actors.size());
+			Renderer::Finish();
+		}
+		//the last frames are still being drawn
+		glFinish();
+		return Milliseconds(start);
+	}
+
+	void FrameCapture(const string& directory)
+	{
+		const PxU32 frame_count = 120;
+		const int sizes[][2] = { { 800, 800 }, { 1920, 1080 } };
+
+		if (!Renderer::InitHeadless(sizes[0][0], sizes[0][1]))
+			throw new Exception("Benchmarks::FrameCapture, cannot create an offscreen OpenGL context.");
+		Renderer::BackgroundColor(PxVec3(150.f / 255.f, 150.f / 255.f, 150.f / 255.f));
+		Renderer::Init();
+		if (!CreateDirectories(directory))
+			throw new Exception("Benchmarks::FrameCapture, cannot create the capture directory.");
+
+		//a floor with a grid of coloured boxes and balls falling on it
+		Scene scene;
+		scene.Init();
+		Plane plane;
+		scene.Add(&plane);
+		deque<BoxRigid> boxes;
+		deque<Sphere> spheres;
+		Random random;
+		for (int x = -5; x < 5; x++)
+		{
+			for (int z = -5; z < 5; z++)
+			{
+				PxVec3 color(random.Next(), random.Next(), random.Next());
+				boxes.emplace_back(PxTransform(PxVec3(x * 1.5f, .5f, z * 1.5f)));
+				boxes.back().Color(color);
+				scene.Add(&boxes.back());
+				spheres.emplace_back(PxTransform(PxVec3(x * 1.5f, 3.f + random.Next() * 4.f, z * 1.5f)), .5f);
+				spheres.back().Color(PxVec3(1.f, 1.f, 1.f) - color);
+				scene.Add(&spheres.back());
+			}
+		}
+
+		cout << "Frame capture: " << frame_count << " frames, " << thread::hardware_concurrency() << " hardware threads" << endl;
+		cout << left << setw(14) << "  size" << setw(10) << "capture" << right << setw(10) << "fps" << setw(12) << "ms/frame"
+			<< setw(10) << "written" << setw(10) << "dropped" << endl;
+		cout << fixed << setprecision(1);
+
+		for (PxU32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+		{
+			const int width = sizes[s][0], height = sizes[s][1];
+			if (!Renderer::InitHeadless(width, height))
+				throw new Exception("Benchmarks::FrameCapture, cannot resize the offscreen surface.");
+			const string size = to_string(width) + "x" + to_string(height);
+
+			//warm up the caches and the driver
+			RenderFrames(scene, 10);
+
+			for (PxU32 mode = 0; mode < 3; mode++)
+			{
+				const char* mode_names[] = { "none", "PNG", "YUV" };
+				if (mode == 1)
+					Renderer::StartCapture(directory + "/" + size + "_%05d.png", Renderer::CaptureFormat::PNG);
+				else if ((mode == 2) && !Renderer::StartCapture(directory + "/" + size + ".yuv", Renderer::CaptureFormat::YUV))
+					throw new Exception("Benchmarks::FrameCapture, cannot create the YUV file.");
+
+				Clock::time_point start = Clock::now();
+				RenderFrames(scene, frame_count);
+				//a capture is done when every frame is on disk
+				Renderer::CaptureStats stats = Renderer::StopCapture();
+				double time = Milliseconds(start);
+
+				cout << "  " << left << setw(12) << size << setw(10) << mode_names[mode] << right << setw(10) << frame_count * 1000.0 / time
+					<< setw(12) << time / frame_count;
+				if (mode)
+					cout << setw(10) << stats.written << setw(10) << stats.dropped;
+				cout << endl;
+			}
+		}
+
+		cout.unsetf(ios::floatfield);
+		scene.Get()->release();
+	}
+
+	bool Run(int argc, char** argv)
+	{
+		if (argc < 1)
+		{
+			cerr << "Usage: --bench <cooking|simplify|obj> [model.obj] | --bench capture [directory]" << endl;
+			return false;
+		}
+
+		string name = argv[0];
+		bool known = true;
+
+		PxInit();
+
+		if (name == "cooking")
+			CookingPresets((argc > 1) ? argv[1] : "..//Assets//Models//Course.obj");
+		else if (name == "simplify")
+			Simplification((argc > 1) ? argv[1] : "..//Assets//Models//Course.obj");
+		else if (name == "obj")
+			ObjParsing((argc > 1) ? argv[1] : "..//Assets//Models//Course.obj");
+		else if (name == "capture")
+			FrameCapture((argc > 1) ? argv[1] : "capture");
+		else
+			known = false;
+
+		PxRelease();
+
+		if (!known)
+			cerr << "Unknown benchmark: " << name << endl;
+
+		return known;
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+///Command line benchmarks, run with: Main.exe --bench <name> [arguments]
+namespace Benchmarks
+{
+	///Cook a model with every cooking preset and compare cook time, memory and query cost
+	void CookingPresets(const std::string& path);
+
+	///Simplify a model with a range of tolerances and compare the collision mesh size and contact cost
+	void Simplification(const std::string& path);
+
+	///Parse a model with LoadOBJ2 and the memory-mapped parser on one and on all threads and compare their throughput
+	void ObjParsing(const std::string& path);
+
+	///Render a scene offscreen at 800x800 and 1920x1080 and compare the frame rate without capture,
+	///with PNG capture and with YUV capture into the directory
+	void FrameCapture(const std::string& directory);
+
+	///Run the benchmark named by the first argument, returns false if it is unknown
+	bool Run(int argc, char** argv);
+}
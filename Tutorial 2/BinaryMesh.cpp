@@ -0,0 +1,246 @@
+#include "BinaryMesh.h"
+#include "ObjParser.h"
+#include "MeshWelder.h"
+#include "Model.h"
+#include "Hash.h"
+#include <cstring>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	//'MESH', bump the version when the file layout changes
+	static const PxU32 mesh_file_magic = 0x4853454d;
+	static const PxU32 mesh_file_version = 2;
+	static const PxU64 mesh_block_alignment = 16;
+
+	static_assert(sizeof(BinaryMeshHeader) % mesh_block_alignment == 0, "BinaryMeshHeader has to keep the blocks aligned");
+
+	static PxU64 AlignBlock(PxU64 offset)
+	{
+		return (offset + mesh_block_alignment - 1) & ~(mesh_block_alignment - 1);
+	}
+
+	static void HashBlock(Hasher& hasher, const void* data, size_t size)
+	{
+		hasher.Add((PxU64)size);
+		if (size)
+			hasher.Add(data, size);
+	}
+
+	//is a block of count elements inside the file and aligned?
+	static bool ValidBlock(PxU64 offset, PxU32 count, size_t element_size, size_t file_size)
+	{
+		if (!offset)
+			return count == 0;
+		return (offset % mesh_block_alignment == 0) && (offset <= file_size) && ((PxU64)count * element_size <= file_size - offset);
+	}
+
+	//keep the attributes of the corners the welder kept
+	static void SelectCorners(vector<PxU32>& attribute_indices, const vector<PxU32>& corners)
+	{
+		vector<PxU32> selected(corners.size());
+		for (PxU32 i = 0; i < corners.size(); i++)
+			selected[i] = attribute_indices[corners[i]];
+		attribute_indices.swap(selected);
+	}
+
+	PxU64 HashSourceFile(const void* data, size_t size)
+	{
+		Hasher hasher;
+		HashBlock(hasher, data, size);
+		return hasher.Get();
+	}
+
+	string BinaryMeshPath(const string& model_path)
+	{
+		size_t dot = model_path.find_last_of('.');
+		size_t slash = model_path.find_last_of("/\\");
+		if ((dot == string::npos) || ((slash != string::npos) && (dot < slash)))
+			return model_path + ".mesh";
+		return model_path.substr(0, dot) + ".mesh";
+	}
+
+	bool WriteBinaryMesh(const string& path, const vector<PxVec3>& vertices, const vector<PxU32>& indices,
+		const vector<PxVec3>& normals, const vector<PxVec2>& texcoords, PxReal weld_epsilon, PxU64 source_size, PxU64 source_hash)
+	{
+		BinaryMeshHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = mesh_file_magic;
+		header.version = mesh_file_version;
+		header.vertex_count = (PxU32)vertices.size();
+		header.index_count = (PxU32)indices.size();
+		header.normal_count = (PxU32)normals.size();
+		header.texcoord_count = (PxU32)texcoords.size();
+		header.weld_epsilon = weld_epsilon;
+		header.source_size = source_size;
+		header.source_hash = source_hash;
+
+		//lay the blocks out one after the other
+		PxU64 offset = sizeof(BinaryMeshHeader);
+		PxU64* offsets[] = { &header.vertex_offset, &header.index_offset, &header.normal_offset, &header.texcoord_offset };
+		const void* blocks[] = { vertices.data(), indices.data(), normals.data(), texcoords.data() };
+		size_t sizes[] = { vertices.size() * sizeof(PxVec3), indices.size() * sizeof(PxU32),
+			normals.size() * sizeof(PxVec3), texcoords.size() * sizeof(PxVec2) };
+		for (PxU32 i = 0; i < 4; i++)
+		{
+			if (!sizes[i])
+				continue;
+			*offsets[i] = offset;
+			offset = AlignBlock(offset + sizes[i]);
+		}
+
+		PxBounds3 bounds = PxBounds3::empty();
+		for (PxU32 i = 0; i < vertices.size(); i++)
+			bounds.include(vertices[i]);
+		if (vertices.empty())
+			bounds = PxBounds3(PxVec3(0.f), PxVec3(0.f));
+		header.bounds_min = bounds.minimum;
+		header.bounds_max = bounds.maximum;
+
+		Hasher hasher;
+		for (PxU32 i = 0; i < 4; i++)
+			HashBlock(hasher, blocks[i], sizes[i]);
+		header.content_hash = hasher.Get();
+
+		vector<PxU8> data((size_t)offset, 0);
+		memcpy(&data.front(), &header, sizeof(header));
+		for (PxU32 i = 0; i < 4; i++)
+			if (sizes[i])
+				memcpy(&data[(size_t)*offsets[i]], blocks[i], sizes[i]);
+
+		return WriteFileAtomic(path, &data.front(), data.size());
+	}
+
+	bool ConvertToBinaryMesh(const string& model_path, const string& mesh_path, PxReal weld_epsilon)
+	{
+		MappedFile source;
+		if (!source.Open(model_path))
+			return false;
+		ObjModel obj;
+		ParseOBJ((const char*)source.Data(), source.Size(), obj);
+
+		//the texture coordinates and normals follow the corners the welder keeps
+		if (weld_epsilon >= 0.f)
+		{
+			vector<PxU32> corners;
+			WeldMesh(obj.vertices, obj.indices, weld_epsilon, &corners);
+			SelectCorners(obj.texcoord_indices, corners);
+			SelectCorners(obj.normal_indices, corners);
+		}
+
+		Model model;
+		model.Load(obj);
+		const vector<Vertex>& model_vertices = model.Vertices();
+		vector<PxVec3> vertices(model_vertices.size()), normals(model_vertices.size());
+		vector<PxVec2> texcoords(obj.texcoords.empty() ? 0 : model_vertices.size());
+		for (PxU32 i = 0; i < model_vertices.size(); i++)
+		{
+			vertices[i] = model_vertices[i].position;
+			normals[i] = model_vertices[i].normal;
+			if (!texcoords.empty())
+				texcoords[i] = model_vertices[i].texcoord;
+		}
+		vector<PxU32> indices(model.IndexCount());
+		for (PxU32 i = 0; i < indices.size(); i++)
+			indices[i] = model.Index(i);
+
+		return WriteBinaryMesh(mesh_path, vertices, indices, normals, texcoords, (weld_epsilon >= 0.f) ? weld_epsilon : -1.f,
+			source.Size(), HashSourceFile(source.Data(), source.Size()));
+	}
+
+	///BinaryMesh methods
+
+	bool BinaryMesh::Open(const string& path)
+	{
+		Close();
+
+		if (!file.Open(path))
+			return false;
+
+		const BinaryMeshHeader* file_header = (const BinaryMeshHeader*)file.Data();
+		size_t size = file.Size();
+		if ((size < sizeof(BinaryMeshHeader)) || (file_header->magic != mesh_file_magic) || (file_header->version != mesh_file_version) ||
+			!ValidBlock(file_header->vertex_offset, file_header->vertex_count, sizeof(PxVec3), size) ||
+			!ValidBlock(file_header->index_offset, file_header->index_count, sizeof(PxU32), size) ||
+			!ValidBlock(file_header->normal_offset, file_header->normal_count, sizeof(PxVec3), size) ||
+			!ValidBlock(file_header->texcoord_offset, file_header->texcoord_count, sizeof(PxVec2), size) ||
+			(file_header->index_count % 3))
+		{
+			file.Close();
+			return false;
+		}
+
+		//the indices go straight to the cooking and the draws, one out of range would read past the vertices;
+		//a single pass over them is cheap next to hashing the whole file in Verify
+		const PxU32* indices = (const PxU32*)((const PxU8*)file.Data() + file_header->index_offset);
+		for (PxU32 i = 0; i < file_header->index_count; i++)
+		{
+			if (indices[i] >= file_header->vertex_count)
+			{
+				file.Close();
+				return false;
+			}
+		}
+
+		header = file_header;
+		return true;
+	}
+
+	void BinaryMesh::Close()
+	{
+		header = 0;
+		file.Close();
+	}
+
+	bool BinaryMesh::Verify() const
+	{
+		Hasher hasher;
+		HashBlock(hasher, Vertices(), VertexCount() * sizeof(PxVec3));
+		HashBlock(hasher, Indices(), IndexCount() * sizeof(PxU32));
+		HashBlock(hasher, Normals(), NormalCount() * sizeof(PxVec3));
+		HashBlock(hasher, Texcoords(), TexcoordCount() * sizeof(PxVec2));
+		return hasher.Get() == ContentHash();
+	}
+
+	bool BinaryMesh::Matches(const string& model_path, PxReal weld_epsilon) const
+	{
+		if ((weld_epsilon >= 0.f) ? (WeldEpsilon() != weld_epsilon) : (WeldEpsilon() >= 0.f))
+			return false;
+
+		MappedFile source;
+		if (!source.Open(model_path) || (source.Size() != header->source_size))
+			return false;
+		return HashSourceFile(source.Data(), source.Size()) == header->source_hash;
+	}
+
+	PxTriangleMeshDesc BinaryMesh::TriangleMeshDesc() const
+	{
+		PxTriangleMeshDesc mesh_desc;
+		mesh_desc.points.count = VertexCount();
+		mesh_desc.points.stride = sizeof(PxVec3);
+		mesh_desc.points.data = Vertices();
+		mesh_desc.triangles.count = IndexCount() / 3;
+		mesh_desc.triangles.stride = 3 * sizeof(PxU32);
+		mesh_desc.triangles.data = Indices();
+		return mesh_desc;
+	}
+
+	PxConvexMeshDesc BinaryMesh::ConvexMeshDesc() const
+	{
+		PxConvexMeshDesc mesh_desc;
+		mesh_desc.points.count = VertexCount();
+		mesh_desc.points.stride = sizeof(PxVec3);
+		mesh_desc.points.data = Vertices();
+		mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+		mesh_desc.vertexLimit = 256;
+		return mesh_desc;
+	}
+
+	void BinaryMesh::Read(vector<PxVec3>& vertices, vector<PxU32>& indices) const
+	{
+		vertices.assign(Vertices(), Vertices() + VertexCount());
+		indices.assign(Indices(), Indices() + IndexCount());
+	}
+}
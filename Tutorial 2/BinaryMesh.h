@@ -0,0 +1,115 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include "FileIO.h"
+#include <vector>
+#include <string>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///Header of a binary mesh file (.mesh)
+	///The blocks follow the header, every block starts at a multiple of 16 bytes from the start of the file.
+	///Offsets of missing blocks (no normals or texture coordinates) are 0.
+	struct BinaryMeshHeader
+	{
+		PxU32 magic;
+		PxU32 version;
+		PxU32 vertex_count;
+		PxU32 index_count;
+		PxU32 normal_count;
+		PxU32 texcoord_count;
+		//weld epsilon of the conversion, negative if the model was kept as exported
+		PxReal weld_epsilon;
+		PxU32 reserved;
+		PxU64 vertex_offset;
+		PxU64 index_offset;
+		PxU64 normal_offset;
+		PxU64 texcoord_offset;
+		PxVec3 bounds_min;
+		PxVec3 bounds_max;
+		//FNV-1a hash of the blocks
+		PxU64 content_hash;
+		//size and FNV-1a hash of the model file the mesh was converted from
+		PxU64 source_size;
+		PxU64 source_hash;
+	};
+
+	///Path of the binary mesh converted from a model: the model path with its extension replaced by .mesh
+	string BinaryMeshPath(const string& model_path);
+
+	///Write a binary mesh file, the normals and texture coordinates are optional (empty vectors)
+	///The weld epsilon and the size and hash of the source file are stored for BinaryMesh::Matches.
+	bool WriteBinaryMesh(const string& path, const vector<PxVec3>& vertices, const vector<PxU32>& indices,
+		const vector<PxVec3>& normals, const vector<PxVec2>& texcoords, PxReal weld_epsilon=-1.f, PxU64 source_size=0, PxU64 source_hash=0);
+
+	///Convert an .obj model into a binary mesh, returns false if either file cannot be opened
+	///The model is welded first (see WeldMesh), a negative epsilon keeps it as exported. Every distinct combination of
+	///position, texture coordinate and normal becomes a vertex (see Model), corners without a normal get smooth ones.
+	bool ConvertToBinaryMesh(const string& model_path, const string& mesh_path, PxReal weld_epsilon=1e-5f);
+
+	///Hash of a model file as stored in the binary meshes converted from it
+	PxU64 HashSourceFile(const void* data, size_t size);
+
+	///Memory-mapped binary mesh file
+	///The blocks are used straight from the mapping, the only work done when opening a file is checking its header.
+	class BinaryMesh
+	{
+		MappedFile file;
+		const BinaryMeshHeader* header;
+
+		const void* Block(PxU64 offset) const
+		{
+			return offset ? (const PxU8*)file.Data() + offset : 0;
+		}
+
+	public:
+		BinaryMesh() : header(0) {}
+
+		///Map a binary mesh file, returns false if it cannot be opened, its header is not valid or an index is out of range
+		bool Open(const string& path);
+
+		///Unmap the file
+		void Close();
+
+		///Is a valid file mapped?
+		bool IsOpen() const { return header != 0; }
+
+		PxU32 VertexCount() const { return header->vertex_count; }
+		PxU32 IndexCount() const { return header->index_count; }
+		PxU32 NormalCount() const { return header->normal_count; }
+		PxU32 TexcoordCount() const { return header->texcoord_count; }
+
+		const PxVec3* Vertices() const { return (const PxVec3*)Block(header->vertex_offset); }
+		const PxU32* Indices() const { return (const PxU32*)Block(header->index_offset); }
+		const PxVec3* Normals() const { return (const PxVec3*)Block(header->normal_offset); }
+		const PxVec2* Texcoords() const { return (const PxVec2*)Block(header->texcoord_offset); }
+
+		///Bounds of the vertices, stored in the header
+		PxBounds3 Bounds() const { return PxBounds3(header->bounds_min, header->bounds_max); }
+
+		///Hash of the blocks, stored in the header
+		PxU64 ContentHash() const { return header->content_hash; }
+
+		///Weld epsilon of the conversion, negative if the model was kept as exported
+		PxReal WeldEpsilon() const { return header->weld_epsilon; }
+
+		///Was the mesh converted from the model file as it is now, welded with the given epsilon?
+		///The size of the model is compared first, the whole file is only read and hashed when it matches.
+		///Negative epsilons all mean unwelded.
+		bool Matches(const string& model_path, PxReal weld_epsilon) const;
+
+		///Hash the blocks again and compare with the stored hash (reads the whole file)
+		bool Verify() const;
+
+		///Cooking description pointing into the mapping, valid while the file is open
+		PxTriangleMeshDesc TriangleMeshDesc() const;
+
+		///Cooking description of the convex hull of the vertices, valid while the file is open
+		PxConvexMeshDesc ConvexMeshDesc() const;
+
+		///Copy the vertices and indices into vectors
+		void Read(vector<PxVec3>& vertices, vector<PxU32>& indices) const;
+	};
+}
@@ -0,0 +1,512 @@
+#include "ConvexDecomposition.h"
+#include "MeshCache.h"
+#include "FileIO.h"
+#include "Hash.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	//'HULL', bump the version when the file layout or the algorithm changes
+	static const PxU32 hull_file_magic = 0x4c4c5548;
+	static const PxU32 hull_file_version = 2;
+
+	//solid voxelisation of a triangle mesh, every voxel stores the part it belongs to
+	class VoxelGrid
+	{
+	public:
+		PxU32 size[3];
+		PxVec3 origin;
+		PxReal voxel;
+		//-1 = outside, otherwise the part index
+		vector<PxI32> labels;
+
+		PxU32 Index(PxU32 x, PxU32 y, PxU32 z) const
+		{
+			return (z * size[1] + y) * size[0] + x;
+		}
+
+		void Coords(PxU32 index, PxU32* coords) const
+		{
+			coords[0] = index % size[0];
+			coords[1] = (index / size[0]) % size[1];
+			coords[2] = index / (size[0] * size[1]);
+		}
+
+		PxVec3 Center(PxU32 index) const
+		{
+			PxU32 c[3];
+			Coords(index, c);
+			return origin + PxVec3(c[0] + .5f, c[1] + .5f, c[2] + .5f) * voxel;
+		}
+
+		//voxel containing a point, clamped to the grid
+		PxU32 Cell(const PxVec3& p) const
+		{
+			PxU32 c[3];
+			for (PxU32 a = 0; a < 3; a++)
+			{
+				PxI32 i = (PxI32)PxFloor((p[a] - origin[a]) / voxel);
+				c[a] = (PxU32)PxClamp(i, 0, (PxI32)size[a] - 1);
+			}
+			return Index(c[0], c[1], c[2]);
+		}
+
+		void Voxelize(const vector<PxVec3>& verts, const vector<PxU32>& trigs, PxU32 resolution)
+		{
+			PxBounds3 bounds = PxBounds3::empty();
+			for (PxU32 i = 0; i < verts.size(); i++)
+				bounds.include(verts[i]);
+
+			PxVec3 extents = bounds.getDimensions();
+			voxel = extents.maxElement() / (PxReal)PxMax(resolution, 1u);
+			if (!(voxel > 0.f))
+				throw new Exception("PhysicsEngine::DecomposeConvex, the mesh is empty.");
+
+			for (PxU32 a = 0; a < 3; a++)
+				size[a] = PxMax(1u, (PxU32)PxCeil(extents[a] / voxel));
+			//centre the mesh in the grid
+			origin = bounds.minimum - (PxVec3((PxReal)size[0], (PxReal)size[1], (PxReal)size[2]) * voxel - extents) * .5f;
+			labels.assign(size[0] * size[1] * size[2], -1);
+
+			//interior: cast a ray along y through every column and fill between pairs of crossings
+			//the rays pass just off the column centres (differently in x and z), a model built on the grid would
+			//otherwise send them exactly along edges and diagonals shared by two triangles, where rounding can miss both
+			const PxReal ray_x = .5013f, ray_z = .5029f;
+			vector<vector<PxReal> > crossings(size[0] * size[2]);
+			for (PxU32 t = 0; t + 2 < trigs.size(); t += 3)
+			{
+				const PxVec3& p0 = verts[trigs[t]];
+				const PxVec3& p1 = verts[trigs[t + 1]];
+				const PxVec3& p2 = verts[trigs[t + 2]];
+
+				PxReal area = (p1.x - p0.x) * (p2.z - p0.z) - (p2.x - p0.x) * (p1.z - p0.z);
+				//triangles parallel to the rays never cross them
+				if (PxAbs(area) < 1e-12f)
+					continue;
+
+				PxI32 x0 = PxMax(0, (PxI32)PxFloor((PxMin(p0.x, PxMin(p1.x, p2.x)) - origin.x) / voxel - .5f));
+				PxI32 x1 = PxMin((PxI32)size[0] - 1, (PxI32)PxCeil((PxMax(p0.x, PxMax(p1.x, p2.x)) - origin.x) / voxel - .5f));
+				PxI32 z0 = PxMax(0, (PxI32)PxFloor((PxMin(p0.z, PxMin(p1.z, p2.z)) - origin.z) / voxel - .5f));
+				PxI32 z1 = PxMin((PxI32)size[2] - 1, (PxI32)PxCeil((PxMax(p0.z, PxMax(p1.z, p2.z)) - origin.z) / voxel - .5f));
+
+				for (PxI32 z = z0; z <= z1; z++)
+				{
+					for (PxI32 x = x0; x <= x1; x++)
+					{
+						PxReal cx = origin.x + (x + ray_x) * voxel;
+						PxReal cz = origin.z + (z + ray_z) * voxel;
+						PxReal w0 = ((p1.x - cx) * (p2.z - cz) - (p2.x - cx) * (p1.z - cz)) / area;
+						PxReal w1 = ((p2.x - cx) * (p0.z - cz) - (p0.x - cx) * (p2.z - cz)) / area;
+						PxReal w2 = 1.f - w0 - w1;
+						if ((w0 >= 0.f) && (w1 >= 0.f) && (w2 >= 0.f))
+							crossings[z * size[0] + x].push_back(w0 * p0.y + w1 * p1.y + w2 * p2.y);
+					}
+				}
+			}
+
+			for (PxU32 z = 0; z < size[2]; z++)
+			{
+				for (PxU32 x = 0; x < size[0]; x++)
+				{
+					vector<PxReal>& column = crossings[z * size[0] + x];
+					sort(column.begin(), column.end());
+					//an odd count means the mesh is not closed, the last crossing is ignored
+					for (PxU32 i = 0; i + 1 < column.size(); i += 2)
+					{
+						for (PxU32 y = 0; y < size[1]; y++)
+						{
+							PxReal cy = origin.y + (y + .5f) * voxel;
+							if ((cy >= column[i]) && (cy <= column[i + 1]))
+								labels[Index(x, y, z)] = 0;
+						}
+					}
+				}
+			}
+
+			//surface: sample every triangle densely enough to touch all the voxels it crosses
+			for (PxU32 t = 0; t + 2 < trigs.size(); t += 3)
+			{
+				const PxVec3& p0 = verts[trigs[t]];
+				const PxVec3& p1 = verts[trigs[t + 1]];
+				const PxVec3& p2 = verts[trigs[t + 2]];
+
+				PxReal longest = PxMax((p1 - p0).magnitude(), PxMax((p2 - p1).magnitude(), (p0 - p2).magnitude()));
+				PxU32 steps = PxMax(1u, (PxU32)PxCeil(longest / (voxel * .5f)));
+				for (PxU32 i = 0; i <= steps; i++)
+					for (PxU32 j = 0; i + j <= steps; j++)
+						labels[Cell(p0 + (p1 - p0) * ((PxReal)i / steps) + (p2 - p0) * ((PxReal)j / steps))] = 0;
+			}
+		}
+	};
+
+	//a set of voxels that will become a single hull
+	struct DecompositionPart
+	{
+		vector<PxU32> voxels;
+		PxReal concavity;
+	};
+
+	//volume of the convex hull of a point cloud
+	PxReal HullVolume(const vector<PxVec3>& points)
+	{
+		if (points.size() < 4)
+			return 0.f;
+
+		PxConvexMeshDesc mesh_desc;
+		mesh_desc.points.count = (PxU32)points.size();
+		mesh_desc.points.stride = sizeof(PxVec3);
+		mesh_desc.points.data = &points.front();
+		mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+		mesh_desc.vertexLimit = 256;
+
+		//flat or degenerate sets fail to cook, they have no volume
+		PxConvexMesh* mesh = GetCooking()->createConvexMesh(mesh_desc, GetPhysics()->getPhysicsInsertionCallback());
+		if (!mesh)
+			return 0.f;
+
+		PxReal mass;
+		PxMat33 inertia;
+		PxVec3 center_of_mass;
+		mesh->getMassInformation(mass, inertia, center_of_mass);
+		mesh->release();
+
+		return mass;
+	}
+
+	class Decomposer
+	{
+		const vector<PxVec3>& verts;
+		const vector<PxU32>& trigs;
+		const DecompositionParams& params;
+		VoxelGrid grid;
+		vector<DecompositionPart> parts;
+		PxReal total_volume;
+
+		//is the voxel part of the subset (a whole part, or one side of a cut through it)?
+		bool InSubset(PxI32 x, PxI32 y, PxI32 z, PxI32 label, PxI32 axis, PxI32 cut, bool below) const
+		{
+			if ((x < 0) || (y < 0) || (z < 0) || (x >= (PxI32)grid.size[0]) || (y >= (PxI32)grid.size[1]) || (z >= (PxI32)grid.size[2]))
+				return false;
+			if (grid.labels[grid.Index(x, y, z)] != label)
+				return false;
+			if (axis < 0)
+				return true;
+			PxI32 c[3] = { x, y, z };
+			return (c[axis] < cut) == below;
+		}
+
+		//centres of the voxels on the boundary of the subset, they span its hull
+		void BoundaryPoints(const vector<PxU32>& voxels, PxI32 label, PxI32 axis, PxI32 cut, bool below, vector<PxVec3>& points) const
+		{
+			static const PxI32 neighbours[6][3] = { {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1} };
+
+			for (PxU32 i = 0; i < voxels.size(); i++)
+			{
+				PxU32 c[3];
+				grid.Coords(voxels[i], c);
+				for (PxU32 n = 0; n < 6; n++)
+				{
+					if (!InSubset(c[0] + neighbours[n][0], c[1] + neighbours[n][1], c[2] + neighbours[n][2], label, axis, cut, below))
+					{
+						points.push_back(grid.Center(voxels[i]));
+						break;
+					}
+				}
+			}
+		}
+
+		//corners of the voxel faces on the boundary of the subset, their hull holds the voxels themselves
+		void BoundaryCorners(const vector<PxU32>& voxels, PxI32 label, PxI32 axis, PxI32 cut, bool below, vector<PxVec3>& points) const
+		{
+			static const PxI32 neighbours[6][3] = { {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1} };
+			const PxU32 row = grid.size[0] + 1, layer = row * (grid.size[1] + 1);
+
+			//neighbouring faces share corners, they are indexed in the grid of corners to take each one once
+			vector<PxU32> corners;
+			for (PxU32 i = 0; i < voxels.size(); i++)
+			{
+				PxU32 c[3];
+				grid.Coords(voxels[i], c);
+				for (PxU32 n = 0; n < 6; n++)
+				{
+					if (InSubset(c[0] + neighbours[n][0], c[1] + neighbours[n][1], c[2] + neighbours[n][2], label, axis, cut, below))
+						continue;
+
+					const PxU32 face_axis = n / 2;
+					for (PxU32 k = 0; k < 4; k++)
+					{
+						PxU32 corner[3] = { c[0], c[1], c[2] };
+						corner[face_axis] += (neighbours[n][face_axis] > 0) ? 1 : 0;
+						corner[(face_axis + 1) % 3] += k & 1;
+						corner[(face_axis + 2) % 3] += k >> 1;
+						corners.push_back(corner[2] * layer + corner[1] * row + corner[0]);
+					}
+				}
+			}
+			sort(corners.begin(), corners.end());
+			corners.erase(unique(corners.begin(), corners.end()), corners.end());
+
+			for (PxU32 i = 0; i < corners.size(); i++)
+				points.push_back(grid.origin + PxVec3((PxReal)(corners[i] % row), (PxReal)((corners[i] / row) % (grid.size[1] + 1)), (PxReal)(corners[i] / layer)) * grid.voxel);
+		}
+
+		//the gap between the hull of the subset and its volume, both measured on the outside of the voxels
+		PxReal Concavity(const vector<PxU32>& voxels, PxI32 label, PxI32 axis=-1, PxI32 cut=0, bool below=true) const
+		{
+			vector<PxVec3> points;
+			BoundaryCorners(voxels, label, axis, cut, below, points);
+			PxReal volume = voxels.size() * grid.voxel * grid.voxel * grid.voxel;
+			return PxMax(0.f, HullVolume(points) - volume) / total_volume;
+		}
+
+		//cut a part with the axis aligned plane that leaves the least concavity, returns false if it cannot be cut
+		bool Split(PxU32 index)
+		{
+			const PxU32 candidates_per_axis = 8;
+			PxI32 label = (PxI32)index;
+			const vector<PxU32>& voxels = parts[index].voxels;
+
+			PxU32 lower[3] = { PX_MAX_U32, PX_MAX_U32, PX_MAX_U32 }, upper[3] = { 0, 0, 0 };
+			for (PxU32 i = 0; i < voxels.size(); i++)
+			{
+				PxU32 c[3];
+				grid.Coords(voxels[i], c);
+				for (PxU32 a = 0; a < 3; a++)
+				{
+					lower[a] = PxMin(lower[a], c[a]);
+					upper[a] = PxMax(upper[a], c[a]);
+				}
+			}
+
+			PxReal best_cost = PX_MAX_F32;
+			PxI32 best_axis = -1, best_cut = 0;
+			PxReal best_concavity[2] = { 0.f, 0.f };
+
+			for (PxI32 axis = 0; axis < 3; axis++)
+			{
+				PxU32 span = upper[axis] - lower[axis] + 1;
+				if (span < 2)
+					continue;
+
+				PxI32 last_cut = -1;
+				for (PxU32 k = 1; k <= candidates_per_axis; k++)
+				{
+					PxI32 cut = (PxI32)(lower[axis] + PxMax(1u, span * k / (candidates_per_axis + 1)));
+					if ((cut == last_cut) || (cut > (PxI32)upper[axis]))
+						continue;
+					last_cut = cut;
+
+					vector<PxU32> below, above;
+					for (PxU32 i = 0; i < voxels.size(); i++)
+					{
+						PxU32 c[3];
+						grid.Coords(voxels[i], c);
+						((PxI32)c[axis] < cut ? below : above).push_back(voxels[i]);
+					}
+					if (below.empty() || above.empty())
+						continue;
+
+					PxReal concavity_below = Concavity(below, label, axis, cut, true);
+					PxReal concavity_above = Concavity(above, label, axis, cut, false);
+					PxReal cost = concavity_below + concavity_above;
+					if (cost < best_cost)
+					{
+						best_cost = cost;
+						best_axis = axis;
+						best_cut = cut;
+						best_concavity[0] = concavity_below;
+						best_concavity[1] = concavity_above;
+					}
+				}
+			}
+
+			if (best_axis < 0)
+				return false;
+
+			//the voxels above the cut become a new part
+			DecompositionPart part;
+			PxI32 new_label = (PxI32)parts.size();
+			vector<PxU32> below;
+			for (PxU32 i = 0; i < voxels.size(); i++)
+			{
+				PxU32 c[3];
+				grid.Coords(voxels[i], c);
+				if ((PxI32)c[best_axis] < best_cut)
+				{
+					below.push_back(voxels[i]);
+				}
+				else
+				{
+					part.voxels.push_back(voxels[i]);
+					grid.labels[voxels[i]] = new_label;
+				}
+			}
+			part.concavity = best_concavity[1];
+			parts[index].voxels.swap(below);
+			parts[index].concavity = best_concavity[0];
+			parts.push_back(part);
+
+			return true;
+		}
+
+	public:
+		Decomposer(const vector<PxVec3>& _verts, const vector<PxU32>& _trigs, const DecompositionParams& _params)
+			: verts(_verts), trigs(_trigs), params(_params), total_volume(0.f)
+		{
+		}
+
+		vector<vector<PxVec3> > Run()
+		{
+			grid.Voxelize(verts, trigs, params.resolution);
+
+			DecompositionPart whole;
+			for (PxU32 i = 0; i < grid.labels.size(); i++)
+				if (grid.labels[i] == 0)
+					whole.voxels.push_back(i);
+			total_volume = PxMax(whole.voxels.size() * grid.voxel * grid.voxel * grid.voxel, 1e-12f);
+			whole.concavity = Concavity(whole.voxels, 0);
+			parts.push_back(whole);
+
+			//always split the most concave part first
+			while (parts.size() < PxMax(params.max_hulls, 1u))
+			{
+				PxU32 worst = 0;
+				for (PxU32 i = 1; i < parts.size(); i++)
+					if (parts[i].concavity > parts[worst].concavity)
+						worst = i;
+
+				if (parts[worst].concavity <= params.concavity)
+					break;
+
+				if (!Split(worst))
+					parts[worst].concavity = 0.f;
+			}
+
+			//hull points: the original vertices inside each part plus the part's boundary voxels
+			vector<vector<PxVec3> > hulls(parts.size());
+			for (PxU32 i = 0; i < verts.size(); i++)
+			{
+				PxI32 label = grid.labels[grid.Cell(verts[i])];
+				if (label >= 0)
+					hulls[label].push_back(verts[i]);
+			}
+			for (PxU32 i = 0; i < parts.size(); i++)
+				BoundaryPoints(parts[i].voxels, (PxI32)i, -1, 0, true, hulls[i]);
+
+			//drop flat slivers that cannot be cooked
+			vector<vector<PxVec3> > result;
+			for (PxU32 i = 0; i < hulls.size(); i++)
+				if (HullVolume(hulls[i]) > 0.f)
+					result.push_back(hulls[i]);
+
+			return result;
+		}
+	};
+
+	vector<vector<PxVec3> > DecomposeConvex(const vector<PxVec3>& verts, const vector<PxU32>& trigs, const DecompositionParams& params)
+	{
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+		Decomposer decomposer(verts, trigs, params);
+		vector<vector<PxVec3> > hulls = decomposer.Run();
+
+		cout << "ConvexDecomposition: " << trigs.size() / 3 << " trigs split into " << hulls.size() << " hulls in "
+			<< chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count() << " ms" << endl;
+
+		return hulls;
+	}
+
+	vector<vector<PxVec3> > DecomposeConvexCached(const vector<PxVec3>& verts, const vector<PxU32>& trigs, const DecompositionParams& params)
+	{
+		if (MeshCacheDirectory().empty())
+			return DecomposeConvex(verts, trigs, params);
+
+		Hasher hasher;
+		hasher.Add(hull_file_version);
+		hasher.Add(params.max_hulls);
+		hasher.Add(params.resolution);
+		hasher.Add(params.concavity);
+		if (!verts.empty())
+			hasher.Add(&verts.front(), verts.size() * sizeof(PxVec3));
+		if (!trigs.empty())
+			hasher.Add(&trigs.front(), trigs.size() * sizeof(PxU32));
+		string path = MeshCacheDirectory() + hasher.Hex() + ".hulls";
+
+		//layout: magic, version, hull count, then for every hull its point count and points
+		MappedFile file(path);
+		if (file.IsOpen())
+		{
+			const PxU8* data = (const PxU8*)file.Data();
+			const PxU8* end = data + file.Size();
+			const PxU32* header = (const PxU32*)data;
+			//every hull stores at least its point count, a larger count is a corrupt file and must not be allocated
+			if ((file.Size() >= 3 * sizeof(PxU32)) && (header[0] == hull_file_magic) && (header[1] == hull_file_version) &&
+				(header[2] <= (file.Size() - 3 * sizeof(PxU32)) / sizeof(PxU32)))
+			{
+				vector<vector<PxVec3> > hulls(header[2]);
+				data += 3 * sizeof(PxU32);
+				bool valid = true;
+				for (PxU32 i = 0; valid && (i < hulls.size()); i++)
+				{
+					PxU32 count;
+					valid = (data + sizeof(PxU32) <= end);
+					if (!valid)
+						break;
+					memcpy(&count, data, sizeof(PxU32));
+					data += sizeof(PxU32);
+					valid = ((size_t)(end - data) >= (size_t)count * sizeof(PxVec3));
+					if (!valid)
+						break;
+					hulls[i].resize(count);
+					if (count)
+						memcpy(&hulls[i].front(), data, count * sizeof(PxVec3));
+					data += count * sizeof(PxVec3);
+				}
+				//nothing may follow the last hull
+				if (valid && (data == end))
+					return hulls;
+			}
+			cerr << "ConvexDecomposition: " << path << " is invalid, decomposing again" << endl;
+		}
+
+		vector<vector<PxVec3> > hulls = DecomposeConvex(verts, trigs, params);
+
+		vector<PxU8> buffer;
+		PxU32 header[3] = { hull_file_magic, hull_file_version, (PxU32)hulls.size() };
+		buffer.insert(buffer.end(), (const PxU8*)header, (const PxU8*)(header + 3));
+		for (PxU32 i = 0; i < hulls.size(); i++)
+		{
+			PxU32 count = (PxU32)hulls[i].size();
+			buffer.insert(buffer.end(), (const PxU8*)&count, (const PxU8*)(&count + 1));
+			if (count)
+				buffer.insert(buffer.end(), (const PxU8*)&hulls[i].front(), (const PxU8*)(&hulls[i].front() + count));
+		}
+
+		if (!CreateDirectories(MeshCacheDirectory()) || !WriteFileAtomic(path, &buffer.front(), buffer.size()))
+			cerr << "ConvexDecomposition: could not write " << path << endl;
+
+		return hulls;
+	}
+
+	vector<PxConvexMesh*> CookConvexHulls(const vector<vector<PxVec3> >& hulls, const DecompositionParams& params)
+	{
+		vector<PxConvexMesh*> meshes;
+		for (PxU32 i = 0; i < hulls.size(); i++)
+		{
+			PxConvexMeshDesc mesh_desc;
+			mesh_desc.points.count = (PxU32)hulls[i].size();
+			mesh_desc.points.stride = sizeof(PxVec3);
+			mesh_desc.points.data = &hulls[i].front();
+			mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+			mesh_desc.vertexLimit = params.hull_vertex_limit;
+
+			meshes.push_back(CookConvexMesh(mesh_desc));
+		}
+		return meshes;
+	}
+}
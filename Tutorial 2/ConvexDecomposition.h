@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///Parameters of the approximate convex decomposition
+	struct DecompositionParams
+	{
+		//maximum number of convex hulls
+		PxU32 max_hulls;
+		//number of voxels along the longest side of the mesh
+		PxU32 resolution;
+		//parts are not split further once the gap between their hull and their volume
+		//drops below this fraction of the whole volume
+		PxReal concavity;
+		//vertex limit of every cooked hull
+		PxU16 hull_vertex_limit;
+
+		DecompositionParams(PxU32 _max_hulls=16, PxU32 _resolution=48, PxReal _concavity=.01f, PxU16 _hull_vertex_limit=64)
+			: max_hulls(_max_hulls), resolution(_resolution), concavity(_concavity), hull_vertex_limit(_hull_vertex_limit)
+		{
+		}
+	};
+
+	///Split a concave mesh into convex parts (V-HACD style)
+	///The mesh is voxelised and the most concave part is repeatedly cut by the axis aligned plane
+	///that minimises the concavity of the two halves. Every returned hull is a point cloud
+	///that can be cooked with PxConvexFlag::eCOMPUTE_CONVEX.
+	vector<vector<PxVec3> > DecomposeConvex(const vector<PxVec3>& verts, const vector<PxU32>& trigs,
+		const DecompositionParams& params=DecompositionParams());
+
+	///Same as DecomposeConvex, but the result is stored in (and read back from) the mesh cache directory
+	vector<vector<PxVec3> > DecomposeConvexCached(const vector<PxVec3>& verts, const vector<PxU32>& trigs,
+		const DecompositionParams& params=DecompositionParams());
+
+	///Cook the hulls of a decomposition
+	vector<PxConvexMesh*> CookConvexHulls(const vector<vector<PxVec3> >& hulls, const DecompositionParams& params=DecompositionParams());
+}
@@ -0,0 +1,219 @@
+#include "CourseStreamer.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+#include <chrono>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	CourseStreamer::CourseStreamer(Scene* _scene, const StreamingParams& _params)
+		: scene(_scene), params(_params), filter_group(0), filter_mask(0)
+	{
+	}
+
+	CourseStreamer::~CourseStreamer()
+	{
+		for (PxU32 i = 0; i < chunks.size(); i++)
+		{
+			if (chunks[i]->loading)
+				FinishLoading(chunks[i], false);
+			if (chunks[i]->actor)
+				Unload(chunks[i]);
+			delete chunks[i];
+		}
+	}
+
+	void CourseStreamer::AddLayer(const vector<PxVec3>& vertices, const vector<PxU32>& indices, PxMaterial* material, const PxVec3& color)
+	{
+		PxMaterialTableIndex layer = (PxMaterialTableIndex)materials.size();
+		materials.push_back(material);
+		colors.push_back(color);
+
+		//every triangle goes to the cell of its centre, the chunk bounds grow to cover the whole triangle
+		map<pair<PxI32, PxI32>, vector<PxU32> > cell_trigs;
+		for (PxU32 t = 0; t + 2 < indices.size(); t += 3)
+		{
+			PxVec3 center = (vertices[indices[t]] + vertices[indices[t + 1]] + vertices[indices[t + 2]]) / 3.f;
+			vector<PxU32>& trigs = cell_trigs[make_pair((PxI32)PxFloor(center.x / params.chunk_size), (PxI32)PxFloor(center.z / params.chunk_size))];
+			trigs.insert(trigs.end(), indices.begin() + t, indices.begin() + t + 3);
+		}
+
+		for (map<pair<PxI32, PxI32>, vector<PxU32> >::iterator cell = cell_trigs.begin(); cell != cell_trigs.end(); cell++)
+		{
+			map<pair<PxI32, PxI32>, PxU32>::iterator found = chunk_cells.find(cell->first);
+			if (found == chunk_cells.end())
+			{
+				found = chunk_cells.insert(make_pair(cell->first, (PxU32)chunks.size())).first;
+				chunks.push_back(new Chunk());
+			}
+			Chunk* chunk = chunks[found->second];
+			chunk->mesh.Add(vertices, cell->second, layer);
+			chunk->bounds = chunk->mesh.Bounds();
+		}
+	}
+
+	void CourseStreamer::SetupFiltering(PxU32 _filter_group, PxU32 _filter_mask)
+	{
+		filter_group = _filter_group;
+		filter_mask = _filter_mask;
+	}
+
+	CourseStreamer::CookedChunk CourseStreamer::CookChunk(const StreamingParams* params, const Chunk* chunk)
+	{
+		CookedChunk meshes;
+
+		if (params->collision_tolerance > 0.f)
+		{
+			//the simplified triangles keep their materials, the full detail ones are drawn instead of them
+			MergedMesh collision;
+			SimplifyMesh(chunk->mesh.vertices, chunk->mesh.indices, chunk->mesh.materials, params->collision_tolerance,
+				collision.vertices, collision.indices, collision.materials);
+			meshes.collision_mesh = CookTriangleMesh(collision.Desc(), params->options);
+			shared_ptr<Model> model = make_shared<Model>();
+			model->Load(chunk->mesh.vertices, chunk->mesh.indices, chunk->mesh.materials);
+			meshes.render_model = model;
+		}
+		else
+		{
+			meshes.collision_mesh = CookTriangleMesh(chunk->mesh.Desc(), params->options);
+		}
+
+		return meshes;
+	}
+
+	void CourseStreamer::ReleaseMeshes(CookedChunk& meshes)
+	{
+		if (meshes.collision_mesh)
+			meshes.collision_mesh->release();
+		meshes = CookedChunk();
+	}
+
+	PxReal CourseStreamer::Distance(const Chunk* chunk, const vector<PxVec3>& focus) const
+	{
+		PxReal distance = PX_MAX_F32;
+		for (PxU32 i = 0; i < focus.size(); i++)
+		{
+			PxVec3 closest = focus[i].maximum(chunk->bounds.minimum).minimum(chunk->bounds.maximum);
+			distance = PxMin(distance, (closest - focus[i]).magnitude());
+		}
+		return distance;
+	}
+
+	void CourseStreamer::StartLoading(Chunk* chunk)
+	{
+		const StreamingParams* chunk_params = &params;
+		chunk->job = GetThreadPool().Submit([chunk_params, chunk] { return CookChunk(chunk_params, chunk); });
+		chunk->loading = true;
+	}
+
+	void CourseStreamer::FinishLoading(Chunk* chunk, bool wanted)
+	{
+		chunk->loading = false;
+		chunk->meshes = chunk->job.get();
+
+		//the balls moved away while the chunk was cooking
+		if (!wanted)
+		{
+			ReleaseMeshes(chunk->meshes);
+			return;
+		}
+
+		chunk->actor = new MaterialTriangleMesh(chunk->meshes.collision_mesh, materials, colors);
+		chunk->actor->SetupFiltering(filter_group, filter_mask);
+		chunk->actor->RenderModel(chunk->meshes.render_model);
+		chunk->actor->Name("Course");
+		scene->Add(chunk->actor);
+	}
+
+	void CourseStreamer::Unload(Chunk* chunk)
+	{
+		//the PhysX scene is gone already when the scene is reset
+		PxActor* px_actor = chunk->actor->Get();
+		if (px_actor->getScene())
+			scene->Remove(chunk->actor);
+		delete chunk->actor;
+		px_actor->release();
+		chunk->actor = 0;
+
+		ReleaseMeshes(chunk->meshes);
+	}
+
+	void CourseStreamer::Load(const vector<PxVec3>& focus)
+	{
+		Update(focus);
+		for (PxU32 i = 0; i < chunks.size(); i++)
+			if (chunks[i]->loading)
+				FinishLoading(chunks[i], true);
+	}
+
+	void CourseStreamer::Update(const vector<PxVec3>& focus)
+	{
+		for (PxU32 i = 0; i < chunks.size(); i++)
+		{
+			Chunk* chunk = chunks[i];
+			PxReal distance = Distance(chunk, focus);
+
+			if (chunk->loading)
+			{
+				if (chunk->job.wait_for(chrono::seconds(0)) == future_status::ready)
+					FinishLoading(chunk, distance <= params.unload_radius);
+			}
+			else if (!chunk->actor && (distance <= params.load_radius))
+			{
+				StartLoading(chunk);
+			}
+			else if (chunk->actor && (distance > params.unload_radius))
+			{
+				Unload(chunk);
+			}
+		}
+	}
+
+	vector<PxVec3> CourseStreamer::BallFocus() const
+	{
+		vector<PxVec3> focus;
+		vector<PxActor*> actors = scene->GetAllActors();
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			if (actors[i]->getType() != PxActorType::eRIGID_DYNAMIC)
+#else
+			if (!actors[i]->is<PxRigidDynamic>())
+#endif
+				continue;
+
+			//sleeping balls keep the ground under them, removing it would wake them and drop them through
+			PxRigidDynamic* body = (PxRigidDynamic*)actors[i];
+			PxVec3 position = body->getGlobalPose().p;
+			focus.push_back(position);
+			if (!body->isSleeping())
+				focus.push_back(position + body->getLinearVelocity() * params.look_ahead);
+		}
+		return focus;
+	}
+
+	PxU32 CourseStreamer::ChunkCount() const
+	{
+		return (PxU32)chunks.size();
+	}
+
+	PxU32 CourseStreamer::LoadedChunks() const
+	{
+		PxU32 count = 0;
+		for (PxU32 i = 0; i < chunks.size(); i++)
+			if (chunks[i]->actor)
+				count++;
+		return count;
+	}
+
+	PxU32 CourseStreamer::LoadingChunks() const
+	{
+		PxU32 count = 0;
+		for (PxU32 i = 0; i < chunks.size(); i++)
+			if (chunks[i]->loading)
+				count++;
+		return count;
+	}
+}
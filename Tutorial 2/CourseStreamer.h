@@ -0,0 +1,119 @@
+#pragma once
+
+#include "BasicActors.h"
+#include "ThreadPool.h"
+#include "MergedMesh.h"
+#include "Model.h"
+#include <vector>
+#include <map>
+#include <string>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///Layout of the streamed chunks
+	struct StreamingParams
+	{
+		//side of a grid cell on the XZ plane
+		PxReal chunk_size;
+		//chunks closer than this to a ball are loaded
+		PxReal load_radius;
+		//and only removed again once they are further than this (hysteresis)
+		PxReal unload_radius;
+		//balls also look ahead along their velocity by this many seconds
+		PxReal look_ahead;
+		//cooking of the chunk meshes
+		CookingOptions options;
+		//above 0 the chunks collide with a simplified copy of their triangles (see SimplifyMesh)
+		PxReal collision_tolerance;
+
+		StreamingParams(PxReal _chunk_size=16.f, PxReal _load_radius=20.f, PxReal _unload_radius=28.f, PxReal _look_ahead=.5f,
+			const CookingOptions& _options=CookingOptions(), PxReal _collision_tolerance=0.f)
+			: chunk_size(_chunk_size), load_radius(_load_radius), unload_radius(_unload_radius), look_ahead(_look_ahead),
+			options(_options), collision_tolerance(_collision_tolerance)
+		{
+		}
+	};
+
+	///Splits the static course models into grid chunks and keeps only the chunks around the balls in the scene
+	///The models (layers) of a chunk are merged into one mesh with a material per layer, so every chunk is a single
+	///static actor. Chunks are cooked on the thread pool and added to the scene by Update, which has to be called
+	///from the simulation thread.
+	class CourseStreamer
+	{
+		//meshes cooked by a loading job, the full detail model is only drawn and never cooked
+		struct CookedChunk
+		{
+			PxTriangleMesh* collision_mesh;
+			shared_ptr<const Model> render_model;
+
+			CookedChunk() : collision_mesh(0) {}
+		};
+
+		struct Chunk
+		{
+			PxBounds3 bounds;
+			MergedMesh mesh;
+			MaterialTriangleMesh* actor;
+			CookedChunk meshes;
+			future<CookedChunk> job;
+			bool loading;
+
+			Chunk() : bounds(PxBounds3::empty()), actor(0), loading(false) {}
+		};
+
+		Scene* scene;
+		StreamingParams params;
+		//material table shared by all chunks, one entry per layer
+		vector<PxMaterial*> materials;
+		vector<PxVec3> colors;
+		PxU32 filter_group;
+		PxU32 filter_mask;
+		vector<Chunk*> chunks;
+		map<pair<PxI32, PxI32>, PxU32> chunk_cells;
+
+		static CookedChunk CookChunk(const StreamingParams* params, const Chunk* chunk);
+
+		static void ReleaseMeshes(CookedChunk& meshes);
+
+		PxReal Distance(const Chunk* chunk, const vector<PxVec3>& focus) const;
+
+		void StartLoading(Chunk* chunk);
+
+		void FinishLoading(Chunk* chunk, bool wanted);
+
+		void Unload(Chunk* chunk);
+
+	public:
+		CourseStreamer(Scene* _scene, const StreamingParams& _params=StreamingParams());
+
+		///Waits for the loading jobs and removes all chunks from the scene
+		~CourseStreamer();
+
+		///Split a model into the grid, its triangles use the given material and color
+		///All layers have to be added before the first chunk is loaded.
+		void AddLayer(const vector<PxVec3>& vertices, const vector<PxU32>& indices, PxMaterial* material, const PxVec3& color);
+
+		///Collision filtering of the chunks
+		void SetupFiltering(PxU32 _filter_group, PxU32 _filter_mask);
+
+		///Load the chunks around the focus points and wait until they are in the scene
+		void Load(const vector<PxVec3>& focus);
+
+		///Add finished chunks, start loading the chunks near the focus points and remove the far ones
+		void Update(const vector<PxVec3>& focus);
+
+		///Focus points of the balls: every dynamic actor, asleep or not, and the look ahead of the awake ones
+		vector<PxVec3> BallFocus() const;
+
+		///Number of chunks in the grid
+		PxU32 ChunkCount() const;
+
+		///Number of chunks in the scene
+		PxU32 LoadedChunks() const;
+
+		///Number of chunks being cooked
+		PxU32 LoadingChunks() const;
+	};
+}
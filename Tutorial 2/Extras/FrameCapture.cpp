@@ -0,0 +1,294 @@
+#include "FrameCapture.h"
+#include "ImageWriter.h"
+#include "GLExtensions.h"
+#include <GL/glut.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExt;
+
+		//frames read into pixel buffers before the oldest one is mapped, the driver has two frames to finish a read
+		static const PxU32 PIXEL_BUFFER_COUNT = 3;
+		//memory for frames waiting for the writers, about 60 frames at 1080p, past it frames are dropped
+		static const size_t QUEUE_MEMORY = 512 * 1024 * 1024;
+
+		//pixels of a frame waiting for a writer
+		struct CaptureImage
+		{
+			vector<PxU8> pixels;
+			PxU32 width;
+			PxU32 height;
+			PxU32 index;
+		};
+
+		//read by the simulation thread for the HUD
+		static atomic<bool> capturing(false);
+		static string capture_path;
+		static CaptureFormat::Enum capture_format = CaptureFormat::PNG;
+		static ofstream capture_file;
+		static CaptureStats capture_stats;
+
+		//readback ring, a slot is pending from its glReadPixels until it is mapped
+		static bool use_pixel_buffers = false;
+		static GLuint pixel_buffers[PIXEL_BUFFER_COUNT] = { 0 };
+		static PxU32 pending_index[PIXEL_BUFFER_COUNT];
+		static PxU32 pending_count = 0;
+		static PxU32 next_buffer = 0;
+		static int buffer_width = 0;
+		static int buffer_height = 0;
+
+		//writers, the images are reused and bounded so a slow disk drops frames instead of filling the memory
+		static vector<thread> writers;
+		static vector<CaptureImage*> images;
+		static vector<CaptureImage*> free_images;
+		static deque<CaptureImage*> queued_images;
+		static mutex capture_mutex;
+		static condition_variable images_queued;
+		static bool writers_stopping = false;
+
+		static void Write()
+		{
+			for (;;)
+			{
+				CaptureImage* image;
+				{
+					unique_lock<mutex> lock(capture_mutex);
+					images_queued.wait(lock, [] { return writers_stopping || !queued_images.empty(); });
+					if (writers_stopping && queued_images.empty())
+						return;
+					image = queued_images.front();
+					queued_images.pop_front();
+				}
+
+				bool written;
+				if (capture_format == CaptureFormat::PNG)
+				{
+					char path[1024];
+					snprintf(path, sizeof(path), capture_path.c_str(), image->index);
+					written = WritePNG(path, &image->pixels.front(), image->width, image->height, true);
+				}
+				else
+				{
+					//a single writer, the frames arrive in order
+					written = WriteYUV(capture_file, &image->pixels.front(), image->width, image->height, true);
+				}
+
+				lock_guard<mutex> lock(capture_mutex);
+				if (written)
+					capture_stats.written++;
+				else
+					capture_stats.dropped++;
+				free_images.push_back(image);
+			}
+		}
+
+		//hand the pixels of a frame to the writers, or drop it if too many are waiting
+		static void QueueImage(const void* pixels, int width, int height, PxU32 index)
+		{
+			CaptureImage* image = 0;
+			{
+				lock_guard<mutex> lock(capture_mutex);
+				if (!free_images.empty())
+				{
+					image = free_images.back();
+					free_images.pop_back();
+				}
+				else if ((images.size() + 1) * width * height * 4 <= QUEUE_MEMORY)
+				{
+					image = new CaptureImage();
+					images.push_back(image);
+				}
+				else
+				{
+					capture_stats.dropped++;
+					return;
+				}
+			}
+
+			image->pixels.resize((size_t)width * height * 4);
+			memcpy(&image->pixels.front(), pixels, image->pixels.size());
+			image->width = (PxU32)width;
+			image->height = (PxU32)height;
+			image->index = index;
+
+			{
+				lock_guard<mutex> lock(capture_mutex);
+				queued_images.push_back(image);
+			}
+			images_queued.notify_one();
+		}
+
+		//map the oldest pending slot, its read has had the most time to finish
+		static void ReadOldestBuffer()
+		{
+			const PxU32 slot = (next_buffer + PIXEL_BUFFER_COUNT - pending_count) % PIXEL_BUFFER_COUNT;
+			BindBuffer(PIXEL_PACK_BUFFER, pixel_buffers[slot]);
+			const void* pixels = MapBuffer(PIXEL_PACK_BUFFER, READ_ONLY);
+			if (pixels)
+			{
+				QueueImage(pixels, buffer_width, buffer_height, pending_index[slot]);
+				UnmapBuffer(PIXEL_PACK_BUFFER);
+			}
+			else
+			{
+				lock_guard<mutex> lock(capture_mutex);
+				capture_stats.dropped++;
+			}
+			BindBuffer(PIXEL_PACK_BUFFER, 0);
+			pending_count--;
+		}
+
+		static void DrainPixelBuffers()
+		{
+			while (pending_count)
+				ReadOldestBuffer();
+		}
+
+		static void ReleasePixelBuffers()
+		{
+			DrainPixelBuffers();
+			if (pixel_buffers[0])
+				DeleteBuffers(PIXEL_BUFFER_COUNT, pixel_buffers);
+			memset(pixel_buffers, 0, sizeof(pixel_buffers));
+			next_buffer = 0;
+			buffer_width = 0;
+			buffer_height = 0;
+		}
+
+		bool StartCapture(const string& path, CaptureFormat::Enum format)
+		{
+			if (capturing)
+				return false;
+
+			if (format == CaptureFormat::YUV)
+			{
+				capture_file.open(path.c_str(), ios::out | ios::binary | ios::trunc);
+				if (!capture_file)
+				{
+					capture_file.clear();
+					return false;
+				}
+			}
+
+			{
+				lock_guard<mutex> lock(capture_mutex);
+				capture_stats = CaptureStats();
+			}
+			capturing = true;
+			capture_path = path;
+			capture_format = format;
+			use_pixel_buffers = PixelBuffersSupported();
+
+			//every core but the one drawing encodes PNGs, appending to a single file needs one writer
+			PxU32 writer_count = 1;
+			if (format == CaptureFormat::PNG)
+				writer_count = PxMax(thread::hardware_concurrency(), 2u) - 1;
+
+			writers_stopping = false;
+			for (PxU32 i = 0; i < writer_count; i++)
+				writers.push_back(thread(Write));
+
+			return true;
+		}
+
+		void CaptureFrame(int width, int height)
+		{
+			if (!capturing || (width <= 0) || (height <= 0))
+				return;
+
+			PxU32 index;
+			{
+				lock_guard<mutex> lock(capture_mutex);
+				index = capture_stats.captured++;
+			}
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+			if (!use_pixel_buffers)
+			{
+				//wait for the frame to finish and copy it
+				vector<PxU8> pixels((size_t)width * height * 4);
+				glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels.front());
+				QueueImage(&pixels.front(), width, height, index);
+				return;
+			}
+
+			//the ring holds frames of one size
+			if ((width != buffer_width) || (height != buffer_height))
+			{
+				ReleasePixelBuffers();
+				GenBuffers(PIXEL_BUFFER_COUNT, pixel_buffers);
+				for (PxU32 i = 0; i < PIXEL_BUFFER_COUNT; i++)
+				{
+					BindBuffer(PIXEL_PACK_BUFFER, pixel_buffers[i]);
+					BufferData(PIXEL_PACK_BUFFER, (ptrdiff_t)width * height * 4, 0, STREAM_READ);
+				}
+				BindBuffer(PIXEL_PACK_BUFFER, 0);
+				buffer_width = width;
+				buffer_height = height;
+			}
+
+			//the read into a pixel buffer returns at once
+			BindBuffer(PIXEL_PACK_BUFFER, pixel_buffers[next_buffer]);
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+			BindBuffer(PIXEL_PACK_BUFFER, 0);
+			pending_index[next_buffer] = index;
+			next_buffer = (next_buffer + 1) % PIXEL_BUFFER_COUNT;
+			pending_count++;
+
+			if (pending_count == PIXEL_BUFFER_COUNT)
+				ReadOldestBuffer();
+		}
+
+		CaptureStats StopCapture()
+		{
+			if (!capturing)
+				return capture_stats;
+
+			ReleasePixelBuffers();
+
+			{
+				lock_guard<mutex> lock(capture_mutex);
+				writers_stopping = true;
+			}
+			images_queued.notify_all();
+			for (PxU32 i = 0; i < writers.size(); i++)
+				writers[i].join();
+			writers.clear();
+
+			for (PxU32 i = 0; i < images.size(); i++)
+				delete images[i];
+			images.clear();
+			free_images.clear();
+
+			if (capture_format == CaptureFormat::YUV)
+				capture_file.close();
+
+			capturing = false;
+			return capture_stats;
+		}
+
+		bool Capturing()
+		{
+			return capturing;
+		}
+
+		CaptureStats GetCaptureStats()
+		{
+			lock_guard<mutex> lock(capture_mutex);
+			return capture_stats;
+		}
+	}
+}
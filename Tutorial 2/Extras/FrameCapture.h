@@ -0,0 +1,56 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///How the captured frames are stored
+		struct CaptureFormat
+		{
+			enum Enum
+			{
+				//one PNG file per frame
+				PNG,
+				//every frame appended to a single raw I420 file, for a video encoder
+				YUV
+			};
+		};
+
+		///Frame counts of the running or last capture
+		struct CaptureStats
+		{
+			//frames read back
+			PxU32 captured;
+			//frames stored
+			PxU32 written;
+			//frames skipped because the writers were behind, or which failed to be stored
+			PxU32 dropped;
+
+			CaptureStats() : captured(0), written(0), dropped(0) {}
+		};
+
+		///Start capturing every frame finished with Renderer::Finish, needs the OpenGL context current
+		///For PNG the path is a printf pattern for the frame number like "capture/frame%05d.png",
+		///for YUV the path of the file. Frames are read back through a ring of pixel buffer objects,
+		///so the read of one frame completes while the next ones are drawn, and stored on background threads.
+		///Returns false if a capture is running or the YUV file can not be created.
+		bool StartCapture(const std::string& path, CaptureFormat::Enum format);
+
+		///Read back the frame drawn, called by Renderer::Finish before the buffers are swapped
+		void CaptureFrame(int width, int height);
+
+		///Read back the frames in flight, wait until every frame is stored and stop the writers
+		CaptureStats StopCapture();
+
+		///Is a capture running?
+		bool Capturing();
+
+		///Frame counts of the running or last capture
+		CaptureStats GetCaptureStats();
+	}
+}
@@ -0,0 +1,113 @@
+#include "Frustum.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		//plane through point with an inward normal
+		static PxVec4 Plane(const PxVec3& normal, const PxVec3& point)
+		{
+			PxVec3 n = normal.getNormalized();
+			return PxVec4(n, -n.dot(point));
+		}
+
+		Frustum Frustum::Perspective(const PxVec3& eye, const PxVec3& dir, const PxVec3& up, PxReal fovy, PxReal aspect, PxReal near_distance, PxReal far_distance)
+		{
+			PxVec3 forward = dir.getNormalized();
+			PxVec3 right = forward.cross(up).getNormalized();
+			PxVec3 camera_up = right.cross(forward);
+			PxReal tan_y = PxTan(fovy * .5f);
+			PxReal tan_x = tan_y * aspect;
+
+			Frustum frustum;
+			frustum.planes[0] = Plane(forward, eye + forward * near_distance);
+			frustum.planes[1] = Plane(-forward, eye + forward * far_distance);
+			//the side planes contain the eye and an edge of the view
+			frustum.planes[2] = Plane((forward - right * tan_x).cross(camera_up), eye);
+			frustum.planes[3] = Plane(camera_up.cross(forward + right * tan_x), eye);
+			frustum.planes[4] = Plane(right.cross(forward - camera_up * tan_y), eye);
+			frustum.planes[5] = Plane((forward + camera_up * tan_y).cross(right), eye);
+			return frustum;
+		}
+
+		void BoundsBatch::Clear()
+		{
+			for (PxU32 i = 0; i < 6; i++)
+				values[i].clear();
+			count = 0;
+		}
+
+		void BoundsBatch::Add(const PxBounds3& bounds)
+		{
+			//grow four boxes at a time, the padding is tested but never reported
+			if ((count & 3) == 0)
+				for (PxU32 i = 0; i < 6; i++)
+					values[i].resize(count + 4, 0.f);
+
+			PxVec3 center = bounds.getCenter();
+			PxVec3 extents = bounds.getExtents();
+			values[0][count] = center.x;
+			values[1][count] = center.y;
+			values[2][count] = center.z;
+			values[3][count] = extents.x;
+			values[4][count] = extents.y;
+			values[5][count] = extents.z;
+			count++;
+		}
+
+		void BoundsBatch::Test(const Frustum& frustum, std::vector<PxU8>& visible) const
+		{
+			visible.resize(count);
+			if (!count)
+				return;
+
+			const float* cx = &values[0].front();
+			const float* cy = &values[1].front();
+			const float* cz = &values[2].front();
+			const float* ex = &values[3].front();
+			const float* ey = &values[4].front();
+			const float* ez = &values[5].front();
+
+			//a box is outside when it is behind any plane even with its extents towards the plane
+			for (PxU32 i = 0; i < count; i += 4)
+			{
+#ifdef FRUSTUM_SSE
+				__m128 x = _mm_loadu_ps(cx + i), y = _mm_loadu_ps(cy + i), z = _mm_loadu_ps(cz + i);
+				__m128 sx = _mm_loadu_ps(ex + i), sy = _mm_loadu_ps(ey + i), sz = _mm_loadu_ps(ez + i);
+				__m128 outside = _mm_setzero_ps();
+				for (PxU32 p = 0; p < 6; p++)
+				{
+					const PxVec4& plane = frustum.planes[p];
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+						_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), z), _mm_set1_ps(plane.w)));
+					__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(PxAbs(plane.x)), sx), _mm_mul_ps(_mm_set1_ps(PxAbs(plane.y)), sy)),
+						_mm_mul_ps(_mm_set1_ps(PxAbs(plane.z)), sz));
+					outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+				}
+				int mask = _mm_movemask_ps(outside);
+				for (PxU32 k = 0; (k < 4) && (i + k < count); k++)
+					visible[i + k] = ((mask >> k) & 1) ? 0 : 1;
+#else
+				for (PxU32 k = 0; (k < 4) && (i + k < count); k++)
+				{
+					PxU32 j = i + k;
+					bool inside = true;
+					for (PxU32 p = 0; (p < 6) && inside; p++)
+					{
+						const PxVec4& plane = frustum.planes[p];
+						PxReal distance = plane.x * cx[j] + plane.y * cy[j] + plane.z * cz[j] + plane.w;
+						PxReal radius = PxAbs(plane.x) * ex[j] + PxAbs(plane.y) * ey[j] + PxAbs(plane.z) * ez[j];
+						inside = (distance + radius >= 0.f);
+					}
+					visible[j] = inside ? 1 : 0;
+				}
+#endif
+			}
+		}
+	}
+}
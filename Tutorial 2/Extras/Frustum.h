@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <vector>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///View volume of a perspective camera as six planes facing inwards
+		///A point p is inside a plane when n.dot(p) + d >= 0, the normal n is in xyz and d in w.
+		struct Frustum
+		{
+			PxVec4 planes[6];
+
+			///Frustum of a camera looking along dir, fovy is the vertical field of view in radians
+			static Frustum Perspective(const PxVec3& eye, const PxVec3& dir, const PxVec3& up, PxReal fovy, PxReal aspect, PxReal near_distance, PxReal far_distance);
+		};
+
+		///Axis aligned boxes stored as centers and extents in separate arrays, padded to a multiple of 4 for the batch test
+		class BoundsBatch
+		{
+			std::vector<float> values[6];
+			PxU32 count;
+
+		public:
+			BoundsBatch() : count(0) {}
+
+			void Clear();
+
+			void Add(const PxBounds3& bounds);
+
+			PxU32 Size() const { return count; }
+
+			///Test every box against the frustum, visible gets 1 for the boxes touching it and 0 for the others
+			///Four boxes are tested at a time with SSE where it is available.
+			void Test(const Frustum& frustum, std::vector<PxU8>& visible) const;
+		};
+	}
+}
@@ -0,0 +1,181 @@
+#include "GLExtensions.h"
+#include "HeadlessContext.h"
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+#include <cstring>
+#include <cstdlib>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		namespace GLExt
+		{
+			GenBuffersProc GenBuffers = 0;
+			DeleteBuffersProc DeleteBuffers = 0;
+			BindBufferProc BindBuffer = 0;
+			BufferDataProc BufferData = 0;
+			MapBufferProc MapBuffer = 0;
+			UnmapBufferProc UnmapBuffer = 0;
+
+			CreateShaderProc CreateShader = 0;
+			DeleteShaderProc DeleteShader = 0;
+			ShaderSourceProc ShaderSource = 0;
+			CompileShaderProc CompileShader = 0;
+			GetShaderivProc GetShaderiv = 0;
+			GetShaderInfoLogProc GetShaderInfoLog = 0;
+			CreateProgramProc CreateProgram = 0;
+			DeleteProgramProc DeleteProgram = 0;
+			AttachShaderProc AttachShader = 0;
+			BindAttribLocationProc BindAttribLocation = 0;
+			LinkProgramProc LinkProgram = 0;
+			GetProgramivProc GetProgramiv = 0;
+			GetProgramInfoLogProc GetProgramInfoLog = 0;
+			UseProgramProc UseProgram = 0;
+			GetUniformLocationProc GetUniformLocation = 0;
+			Uniform1iProc Uniform1i = 0;
+			UniformMatrix4fvProc UniformMatrix4fv = 0;
+			EnableVertexAttribArrayProc EnableVertexAttribArray = 0;
+			DisableVertexAttribArrayProc DisableVertexAttribArray = 0;
+			VertexAttribPointerProc VertexAttribPointer = 0;
+
+			VertexAttribDivisorProc VertexAttribDivisor = 0;
+			DrawElementsInstancedProc DrawElementsInstanced = 0;
+
+			ActiveTextureProc ActiveTexture = 0;
+
+			GenFramebuffersProc GenFramebuffers = 0;
+			DeleteFramebuffersProc DeleteFramebuffers = 0;
+			BindFramebufferProc BindFramebuffer = 0;
+			FramebufferTexture2DProc FramebufferTexture2D = 0;
+			CheckFramebufferStatusProc CheckFramebufferStatus = 0;
+		}
+
+		using namespace GLExt;
+
+		static void* GetGLProc(const char* name)
+		{
+			if (HeadlessContextCurrent())
+				return HeadlessProcAddress(name);
+#ifdef _WIN32
+			return (void*)wglGetProcAddress(name);
+#else
+			return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+		}
+
+		//the core name first, then the ARB extension of older drivers
+		static void* GetGLProc(const char* name, const char* arb_name)
+		{
+			void* proc = GetGLProc(name);
+			return proc ? proc : GetGLProc(arb_name);
+		}
+
+		void LoadGLExtensions()
+		{
+			GenBuffers = (GenBuffersProc)GetGLProc("glGenBuffers", "glGenBuffersARB");
+			DeleteBuffers = (DeleteBuffersProc)GetGLProc("glDeleteBuffers", "glDeleteBuffersARB");
+			BindBuffer = (BindBufferProc)GetGLProc("glBindBuffer", "glBindBufferARB");
+			BufferData = (BufferDataProc)GetGLProc("glBufferData", "glBufferDataARB");
+			MapBuffer = (MapBufferProc)GetGLProc("glMapBuffer", "glMapBufferARB");
+			UnmapBuffer = (UnmapBufferProc)GetGLProc("glUnmapBuffer", "glUnmapBufferARB");
+
+			CreateShader = (CreateShaderProc)GetGLProc("glCreateShader");
+			DeleteShader = (DeleteShaderProc)GetGLProc("glDeleteShader");
+			ShaderSource = (ShaderSourceProc)GetGLProc("glShaderSource");
+			CompileShader = (CompileShaderProc)GetGLProc("glCompileShader");
+			GetShaderiv = (GetShaderivProc)GetGLProc("glGetShaderiv");
+			GetShaderInfoLog = (GetShaderInfoLogProc)GetGLProc("glGetShaderInfoLog");
+			CreateProgram = (CreateProgramProc)GetGLProc("glCreateProgram");
+			DeleteProgram = (DeleteProgramProc)GetGLProc("glDeleteProgram");
+			AttachShader = (AttachShaderProc)GetGLProc("glAttachShader");
+			BindAttribLocation = (BindAttribLocationProc)GetGLProc("glBindAttribLocation");
+			LinkProgram = (LinkProgramProc)GetGLProc("glLinkProgram");
+			GetProgramiv = (GetProgramivProc)GetGLProc("glGetProgramiv");
+			GetProgramInfoLog = (GetProgramInfoLogProc)GetGLProc("glGetProgramInfoLog");
+			UseProgram = (UseProgramProc)GetGLProc("glUseProgram");
+			GetUniformLocation = (GetUniformLocationProc)GetGLProc("glGetUniformLocation");
+			Uniform1i = (Uniform1iProc)GetGLProc("glUniform1i");
+			UniformMatrix4fv = (UniformMatrix4fvProc)GetGLProc("glUniformMatrix4fv");
+			EnableVertexAttribArray = (EnableVertexAttribArrayProc)GetGLProc("glEnableVertexAttribArray");
+			DisableVertexAttribArray = (DisableVertexAttribArrayProc)GetGLProc("glDisableVertexAttribArray");
+			VertexAttribPointer = (VertexAttribPointerProc)GetGLProc("glVertexAttribPointer");
+
+			VertexAttribDivisor = (VertexAttribDivisorProc)GetGLProc("glVertexAttribDivisor", "glVertexAttribDivisorARB");
+			DrawElementsInstanced = (DrawElementsInstancedProc)GetGLProc("glDrawElementsInstanced", "glDrawElementsInstancedARB");
+
+			ActiveTexture = (ActiveTextureProc)GetGLProc("glActiveTexture", "glActiveTextureARB");
+
+			GenFramebuffers = (GenFramebuffersProc)GetGLProc("glGenFramebuffers", "glGenFramebuffersEXT");
+			DeleteFramebuffers = (DeleteFramebuffersProc)GetGLProc("glDeleteFramebuffers", "glDeleteFramebuffersEXT");
+			BindFramebuffer = (BindFramebufferProc)GetGLProc("glBindFramebuffer", "glBindFramebufferEXT");
+			FramebufferTexture2D = (FramebufferTexture2DProc)GetGLProc("glFramebufferTexture2D", "glFramebufferTexture2DEXT");
+			CheckFramebufferStatus = (CheckFramebufferStatusProc)GetGLProc("glCheckFramebufferStatus", "glCheckFramebufferStatusEXT");
+		}
+
+		bool HasGLVersion(int major, int minor)
+		{
+			//"<major>.<minor>" followed by vendor information
+			const char* version = (const char*)glGetString(GL_VERSION);
+			if (!version)
+				return false;
+			char* end;
+			long context_major = strtol(version, &end, 10);
+			if ((end == version) || (*end != '.'))
+				return false;
+			const char* minor_version = end + 1;
+			long context_minor = strtol(minor_version, &end, 10);
+			if (end == minor_version)
+				return false;
+			return (context_major > major) || ((context_major == major) && (context_minor >= minor));
+		}
+
+		bool HasGLExtension(const char* name)
+		{
+			const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+			if (!extensions)
+				return false;
+
+			//whole words only, GL_ARB_shadow is a prefix of GL_ARB_shadow_ambient
+			size_t length = strlen(name);
+			for (const char* found = strstr(extensions, name); found; found = strstr(found + length, name))
+			{
+				if (((found == extensions) || (found[-1] == ' ')) && ((found[length] == ' ') || (found[length] == 0)))
+					return true;
+			}
+			return false;
+		}
+
+		//some loaders hand out stubs for every name, so the version or extension decides
+		bool BuffersSupported()
+		{
+			return (HasGLVersion(1, 5) || HasGLExtension("GL_ARB_vertex_buffer_object")) && GenBuffers && DeleteBuffers && BindBuffer && BufferData;
+		}
+
+		bool PixelBuffersSupported()
+		{
+			return BuffersSupported() && (HasGLVersion(2, 1) || HasGLExtension("GL_ARB_pixel_buffer_object")) && MapBuffer && UnmapBuffer;
+		}
+
+		bool ShadersSupported()
+		{
+			return HasGLVersion(2, 0) && CreateShader && ShaderSource && CompileShader && CreateProgram && LinkProgram && UseProgram &&
+				VertexAttribPointer && EnableVertexAttribArray;
+		}
+
+		bool InstancingSupported()
+		{
+			return BuffersSupported() && ShadersSupported() &&
+				(HasGLVersion(3, 3) || (HasGLExtension("GL_ARB_draw_instanced") && HasGLExtension("GL_ARB_instanced_arrays"))) &&
+				VertexAttribDivisor && DrawElementsInstanced;
+		}
+
+		bool DepthTexturesSupported()
+		{
+			return (HasGLVersion(1, 4) || (HasGLExtension("GL_ARB_depth_texture") && HasGLExtension("GL_ARB_shadow"))) &&
+				(HasGLVersion(3, 0) || HasGLExtension("GL_ARB_framebuffer_object") || HasGLExtension("GL_EXT_framebuffer_object")) &&
+				ActiveTexture && GenFramebuffers && DeleteFramebuffers && BindFramebuffer && FramebufferTexture2D && CheckFramebufferStatus;
+		}
+	}
+}
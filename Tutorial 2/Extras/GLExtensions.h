@@ -0,0 +1,154 @@
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/glut.h>
+#include <cstddef>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		///OpenGL entry points beyond 1.1
+		///The Windows headers stop at OpenGL 1.1, so everything newer is loaded at runtime by LoadGLExtensions.
+		///An entry point the driver does not provide stays null.
+		namespace GLExt
+		{
+			static const GLenum ARRAY_BUFFER = 0x8892;
+			static const GLenum ELEMENT_ARRAY_BUFFER = 0x8893;
+			static const GLenum STREAM_DRAW = 0x88E0;
+			static const GLenum STATIC_DRAW = 0x88E4;
+			static const GLenum STREAM_READ = 0x88E1;
+			static const GLenum PIXEL_PACK_BUFFER = 0x88EB;
+			static const GLenum READ_ONLY = 0x88B8;
+			static const GLenum VERTEX_SHADER = 0x8B31;
+			static const GLenum FRAGMENT_SHADER = 0x8B30;
+			static const GLenum COMPILE_STATUS = 0x8B81;
+			static const GLenum LINK_STATUS = 0x8B82;
+			static const GLenum INFO_LOG_LENGTH = 0x8B84;
+			static const GLenum TEXTURE0 = 0x84C0;
+			static const GLenum CLAMP_TO_BORDER = 0x812D;
+			static const GLenum DEPTH_COMPONENT24 = 0x81A6;
+			static const GLenum TEXTURE_COMPARE_MODE = 0x884C;
+			static const GLenum TEXTURE_COMPARE_FUNC = 0x884D;
+			static const GLenum COMPARE_REF_TO_TEXTURE = 0x884E;
+			static const GLenum FRAMEBUFFER = 0x8D40;
+			static const GLenum DEPTH_ATTACHMENT = 0x8D00;
+			static const GLenum FRAMEBUFFER_COMPLETE = 0x8CD5;
+
+			typedef char GLchar;
+
+			typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+			typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+			typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+			typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+			typedef void* (APIENTRY *MapBufferProc)(GLenum target, GLenum access);
+			typedef GLboolean (APIENTRY *UnmapBufferProc)(GLenum target);
+
+			typedef GLuint (APIENTRY *CreateShaderProc)(GLenum type);
+			typedef void (APIENTRY *DeleteShaderProc)(GLuint shader);
+			typedef void (APIENTRY *ShaderSourceProc)(GLuint shader, GLsizei count, const GLchar* const* source, const GLint* length);
+			typedef void (APIENTRY *CompileShaderProc)(GLuint shader);
+			typedef void (APIENTRY *GetShaderivProc)(GLuint shader, GLenum name, GLint* value);
+			typedef void (APIENTRY *GetShaderInfoLogProc)(GLuint shader, GLsizei size, GLsizei* length, GLchar* log);
+			typedef GLuint (APIENTRY *CreateProgramProc)();
+			typedef void (APIENTRY *DeleteProgramProc)(GLuint program);
+			typedef void (APIENTRY *AttachShaderProc)(GLuint program, GLuint shader);
+			typedef void (APIENTRY *BindAttribLocationProc)(GLuint program, GLuint index, const GLchar* name);
+			typedef void (APIENTRY *LinkProgramProc)(GLuint program);
+			typedef void (APIENTRY *GetProgramivProc)(GLuint program, GLenum name, GLint* value);
+			typedef void (APIENTRY *GetProgramInfoLogProc)(GLuint program, GLsizei size, GLsizei* length, GLchar* log);
+			typedef void (APIENTRY *UseProgramProc)(GLuint program);
+			typedef GLint (APIENTRY *GetUniformLocationProc)(GLuint program, const GLchar* name);
+			typedef void (APIENTRY *Uniform1iProc)(GLint location, GLint value);
+			typedef void (APIENTRY *UniformMatrix4fvProc)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+			typedef void (APIENTRY *EnableVertexAttribArrayProc)(GLuint index);
+			typedef void (APIENTRY *DisableVertexAttribArrayProc)(GLuint index);
+			typedef void (APIENTRY *VertexAttribPointerProc)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+
+			typedef void (APIENTRY *VertexAttribDivisorProc)(GLuint index, GLuint divisor);
+			typedef void (APIENTRY *DrawElementsInstancedProc)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances);
+
+			typedef void (APIENTRY *ActiveTextureProc)(GLenum texture);
+
+			typedef void (APIENTRY *GenFramebuffersProc)(GLsizei n, GLuint* framebuffers);
+			typedef void (APIENTRY *DeleteFramebuffersProc)(GLsizei n, const GLuint* framebuffers);
+			typedef void (APIENTRY *BindFramebufferProc)(GLenum target, GLuint framebuffer);
+			typedef void (APIENTRY *FramebufferTexture2DProc)(GLenum target, GLenum attachment, GLenum texture_target, GLuint texture, GLint level);
+			typedef GLenum (APIENTRY *CheckFramebufferStatusProc)(GLenum target);
+
+			//OpenGL 1.5 buffer objects
+			extern GenBuffersProc GenBuffers;
+			extern DeleteBuffersProc DeleteBuffers;
+			extern BindBufferProc BindBuffer;
+			extern BufferDataProc BufferData;
+			extern MapBufferProc MapBuffer;
+			extern UnmapBufferProc UnmapBuffer;
+
+			//OpenGL 2.0 shaders
+			extern CreateShaderProc CreateShader;
+			extern DeleteShaderProc DeleteShader;
+			extern ShaderSourceProc ShaderSource;
+			extern CompileShaderProc CompileShader;
+			extern GetShaderivProc GetShaderiv;
+			extern GetShaderInfoLogProc GetShaderInfoLog;
+			extern CreateProgramProc CreateProgram;
+			extern DeleteProgramProc DeleteProgram;
+			extern AttachShaderProc AttachShader;
+			extern BindAttribLocationProc BindAttribLocation;
+			extern LinkProgramProc LinkProgram;
+			extern GetProgramivProc GetProgramiv;
+			extern GetProgramInfoLogProc GetProgramInfoLog;
+			extern UseProgramProc UseProgram;
+			extern GetUniformLocationProc GetUniformLocation;
+			extern Uniform1iProc Uniform1i;
+			extern UniformMatrix4fvProc UniformMatrix4fv;
+			extern EnableVertexAttribArrayProc EnableVertexAttribArray;
+			extern DisableVertexAttribArrayProc DisableVertexAttribArray;
+			extern VertexAttribPointerProc VertexAttribPointer;
+
+			//GL_ARB_instanced_arrays and GL_ARB_draw_instanced
+			extern VertexAttribDivisorProc VertexAttribDivisor;
+			extern DrawElementsInstancedProc DrawElementsInstanced;
+
+			//OpenGL 1.3 multitexture
+			extern ActiveTextureProc ActiveTexture;
+
+			//OpenGL 3.0 or GL_EXT_framebuffer_object framebuffers
+			extern GenFramebuffersProc GenFramebuffers;
+			extern DeleteFramebuffersProc DeleteFramebuffers;
+			extern BindFramebufferProc BindFramebuffer;
+			extern FramebufferTexture2DProc FramebufferTexture2D;
+			extern CheckFramebufferStatusProc CheckFramebufferStatus;
+		}
+
+		///Load the entry points, needs a current OpenGL context
+		void LoadGLExtensions();
+
+		///Is the OpenGL version of the context at least major.minor?
+		bool HasGLVersion(int major, int minor);
+
+		///Is an extension in the extension string of the context?
+		bool HasGLExtension(const char* name);
+
+		///Are buffer objects available?
+		bool BuffersSupported();
+
+		///Can pixels be read back into buffer objects without waiting for them?
+		bool PixelBuffersSupported();
+
+		///Are shaders available?
+		bool ShadersSupported();
+
+		///Are instanced draws with per instance attributes available?
+		bool InstancingSupported();
+
+		///Can depth textures be rendered to with framebuffer objects and sampled with depth comparison?
+		bool DepthTexturesSupported();
+	}
+}
@@ -0,0 +1,256 @@
+#include "HeadlessContext.h"
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+#ifndef _WIN32
+		static EGLDisplay headless_display = EGL_NO_DISPLAY;
+		static EGLSurface headless_surface = EGL_NO_SURFACE;
+		static EGLContext headless_context = EGL_NO_CONTEXT;
+		static EGLConfig headless_config;
+
+		//Mesa renders without X or a GPU on its surfaceless platform, other drivers get the default display
+		static EGLDisplay GetHeadlessDisplay()
+		{
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+			PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+			if (get_platform_display)
+			{
+				EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+				if (display != EGL_NO_DISPLAY)
+					return display;
+			}
+#endif
+			return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+
+		bool CreateHeadlessContext(int width, int height)
+		{
+			const EGLint surface_attributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+
+			//a new surface for the context, its textures and buffers stay
+			if (headless_context != EGL_NO_CONTEXT)
+			{
+				EGLSurface surface = eglCreatePbufferSurface(headless_display, headless_config, surface_attributes);
+				if ((surface == EGL_NO_SURFACE) || !eglMakeCurrent(headless_display, surface, surface, headless_context))
+				{
+					if (surface != EGL_NO_SURFACE)
+						eglDestroySurface(headless_display, surface);
+					return false;
+				}
+				eglDestroySurface(headless_display, headless_surface);
+				headless_surface = surface;
+				return true;
+			}
+
+			headless_display = GetHeadlessDisplay();
+			EGLint major, minor;
+			if ((headless_display == EGL_NO_DISPLAY) || !eglInitialize(headless_display, &major, &minor))
+			{
+				headless_display = EGL_NO_DISPLAY;
+				return false;
+			}
+
+			//the same buffers as the GLUT window
+			const EGLint config_attributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+				EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_NONE };
+			EGLint config_count = 0;
+			if (eglChooseConfig(headless_display, config_attributes, &headless_config, 1, &config_count) && config_count &&
+				eglBindAPI(EGL_OPENGL_API))
+			{
+				headless_surface = eglCreatePbufferSurface(headless_display, headless_config, surface_attributes);
+				headless_context = eglCreateContext(headless_display, headless_config, EGL_NO_CONTEXT, 0);
+				if ((headless_surface != EGL_NO_SURFACE) && (headless_context != EGL_NO_CONTEXT) &&
+					eglMakeCurrent(headless_display, headless_surface, headless_surface, headless_context))
+					return true;
+			}
+
+			ReleaseHeadlessContext();
+			return false;
+		}
+
+		void ReleaseHeadlessContext()
+		{
+			if (headless_display == EGL_NO_DISPLAY)
+				return;
+
+			eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (headless_context != EGL_NO_CONTEXT)
+				eglDestroyContext(headless_display, headless_context);
+			if (headless_surface != EGL_NO_SURFACE)
+				eglDestroySurface(headless_display, headless_surface);
+			eglTerminate(headless_display);
+			headless_display = EGL_NO_DISPLAY;
+			headless_surface = EGL_NO_SURFACE;
+			headless_context = EGL_NO_CONTEXT;
+		}
+
+		bool HeadlessContextCurrent()
+		{
+			return (headless_context != EGL_NO_CONTEXT) && (eglGetCurrentContext() == headless_context);
+		}
+
+		void* HeadlessProcAddress(const char* name)
+		{
+			return (void*)eglGetProcAddress(name);
+		}
+#else
+		//WGL_ARB_pixel_format and WGL_ARB_pbuffer, declared here like the other entry points (see GLExtensions.h)
+		static const int WGL_DRAW_TO_PBUFFER_ARB = 0x202D;
+		static const int WGL_SUPPORT_OPENGL_ARB = 0x2010;
+		static const int WGL_PIXEL_TYPE_ARB = 0x2013;
+		static const int WGL_TYPE_RGBA_ARB = 0x202B;
+		static const int WGL_COLOR_BITS_ARB = 0x2014;
+		static const int WGL_ALPHA_BITS_ARB = 0x201B;
+		static const int WGL_DEPTH_BITS_ARB = 0x2022;
+
+		DECLARE_HANDLE(HPBUFFERARB);
+		typedef BOOL (WINAPI *ChoosePixelFormatARBProc)(HDC dc, const int* int_attributes, const FLOAT* float_attributes, UINT max_formats, int* formats, UINT* format_count);
+		typedef HPBUFFERARB (WINAPI *CreatePbufferARBProc)(HDC dc, int format, int width, int height, const int* attributes);
+		typedef HDC (WINAPI *GetPbufferDCARBProc)(HPBUFFERARB pbuffer);
+		typedef int (WINAPI *ReleasePbufferDCARBProc)(HPBUFFERARB pbuffer, HDC dc);
+		typedef BOOL (WINAPI *DestroyPbufferARBProc)(HPBUFFERARB pbuffer);
+
+		static CreatePbufferARBProc CreatePbufferARB = 0;
+		static GetPbufferDCARBProc GetPbufferDCARB = 0;
+		static ReleasePbufferDCARBProc ReleasePbufferDCARB = 0;
+		static DestroyPbufferARBProc DestroyPbufferARB = 0;
+
+		//the pbuffer formats are chosen on the DC of a window that is never shown
+		static HWND headless_window = 0;
+		static HDC headless_window_dc = 0;
+		static int headless_format = 0;
+		static HPBUFFERARB headless_pbuffer = 0;
+		static HDC headless_dc = 0;
+		static HGLRC headless_context = 0;
+
+		//a pbuffer of the chosen format and its DC
+		static bool CreatePbuffer(int width, int height, HPBUFFERARB& pbuffer, HDC& dc)
+		{
+			const int attributes[] = { 0 };
+			pbuffer = CreatePbufferARB(headless_window_dc, headless_format, width, height, attributes);
+			dc = pbuffer ? GetPbufferDCARB(pbuffer) : 0;
+			if (dc)
+				return true;
+			if (pbuffer)
+				DestroyPbufferARB(pbuffer);
+			pbuffer = 0;
+			return false;
+		}
+
+		static void DestroyPbuffer(HPBUFFERARB pbuffer, HDC dc)
+		{
+			ReleasePbufferDCARB(pbuffer, dc);
+			DestroyPbufferARB(pbuffer);
+		}
+
+		bool CreateHeadlessContext(int width, int height)
+		{
+			//a new pbuffer for the context, a context draws into any DC of its pixel format and keeps its objects
+			if (headless_context)
+			{
+				HPBUFFERARB pbuffer;
+				HDC dc;
+				if (!CreatePbuffer(width, height, pbuffer, dc))
+					return false;
+				if (!wglMakeCurrent(dc, headless_context))
+				{
+					DestroyPbuffer(pbuffer, dc);
+					return false;
+				}
+				DestroyPbuffer(headless_pbuffer, headless_dc);
+				headless_pbuffer = pbuffer;
+				headless_dc = dc;
+				return true;
+			}
+
+			//the WGL extensions are only found with a context current, a legacy one on the hidden window
+			headless_window = CreateWindowA("STATIC", "", WS_POPUP, 0, 0, 1, 1, 0, 0, GetModuleHandleA(0), 0);
+			headless_window_dc = headless_window ? GetDC(headless_window) : 0;
+			if (!headless_window_dc)
+			{
+				ReleaseHeadlessContext();
+				return false;
+			}
+			PIXELFORMATDESCRIPTOR descriptor = { sizeof(PIXELFORMATDESCRIPTOR), 1, PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL, PFD_TYPE_RGBA, 32 };
+			descriptor.cDepthBits = 24;
+			int window_format = ChoosePixelFormat(headless_window_dc, &descriptor);
+			HGLRC window_context = 0;
+			if (window_format && SetPixelFormat(headless_window_dc, window_format, &descriptor))
+				window_context = wglCreateContext(headless_window_dc);
+			if (!window_context || !wglMakeCurrent(headless_window_dc, window_context))
+			{
+				if (window_context)
+					wglDeleteContext(window_context);
+				ReleaseHeadlessContext();
+				return false;
+			}
+
+			ChoosePixelFormatARBProc ChoosePixelFormatARB = (ChoosePixelFormatARBProc)wglGetProcAddress("wglChoosePixelFormatARB");
+			CreatePbufferARB = (CreatePbufferARBProc)wglGetProcAddress("wglCreatePbufferARB");
+			GetPbufferDCARB = (GetPbufferDCARBProc)wglGetProcAddress("wglGetPbufferDCARB");
+			ReleasePbufferDCARB = (ReleasePbufferDCARBProc)wglGetProcAddress("wglReleasePbufferDCARB");
+			DestroyPbufferARB = (DestroyPbufferARBProc)wglGetProcAddress("wglDestroyPbufferARB");
+
+			//the same buffers as the GLUT window
+			const int format_attributes[] = { WGL_DRAW_TO_PBUFFER_ARB, TRUE, WGL_SUPPORT_OPENGL_ARB, TRUE, WGL_PIXEL_TYPE_ARB, WGL_TYPE_RGBA_ARB,
+				WGL_COLOR_BITS_ARB, 24, WGL_ALPHA_BITS_ARB, 8, WGL_DEPTH_BITS_ARB, 24, 0 };
+			UINT format_count = 0;
+			bool created = ChoosePixelFormatARB && CreatePbufferARB && GetPbufferDCARB && ReleasePbufferDCARB && DestroyPbufferARB &&
+				ChoosePixelFormatARB(headless_window_dc, format_attributes, 0, 1, &headless_format, &format_count) && format_count &&
+				CreatePbuffer(width, height, headless_pbuffer, headless_dc);
+			if (created)
+				headless_context = wglCreateContext(headless_dc);
+
+			wglMakeCurrent(0, 0);
+			wglDeleteContext(window_context);
+			if (headless_context && wglMakeCurrent(headless_dc, headless_context))
+				return true;
+
+			ReleaseHeadlessContext();
+			return false;
+		}
+
+		void ReleaseHeadlessContext()
+		{
+			if (headless_context)
+			{
+				if (wglGetCurrentContext() == headless_context)
+					wglMakeCurrent(0, 0);
+				wglDeleteContext(headless_context);
+			}
+			if (headless_pbuffer)
+				DestroyPbuffer(headless_pbuffer, headless_dc);
+			if (headless_window_dc)
+				ReleaseDC(headless_window, headless_window_dc);
+			if (headless_window)
+				DestroyWindow(headless_window);
+			headless_window = 0;
+			headless_window_dc = 0;
+			headless_format = 0;
+			headless_pbuffer = 0;
+			headless_dc = 0;
+			headless_context = 0;
+		}
+
+		bool HeadlessContextCurrent()
+		{
+			return headless_context && (wglGetCurrentContext() == headless_context);
+		}
+
+		void* HeadlessProcAddress(const char* name)
+		{
+			return (void*)wglGetProcAddress(name);
+		}
+#endif
+	}
+}
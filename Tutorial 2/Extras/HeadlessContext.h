@@ -0,0 +1,23 @@
+#pragma once
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		///Create an OpenGL context drawing into an offscreen surface and make it current
+		///Uses an EGL pbuffer surface, with Mesa through its surfaceless platform so no display server is needed,
+		///and on Windows a WGL_ARB_pbuffer set up through a window that is never shown.
+		///Called again, the context keeps its objects and only gets a surface of the new size.
+		///Returns false where EGL, the WGL pbuffer extensions or a pbuffer configuration are not available.
+		bool CreateHeadlessContext(int width, int height);
+
+		///Release the context and its surface
+		void ReleaseHeadlessContext();
+
+		///Is the headless context the current one?
+		bool HeadlessContextCurrent();
+
+		///Get an OpenGL entry point through EGL or WGL
+		void* HeadlessProcAddress(const char* name);
+	}
+}
@@ -0,0 +1,342 @@
+#include "ImageWriter.h"
+#include <fstream>
+#include <cstdlib>
+
+using namespace std;
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		//the fixed Huffman codes of deflate (RFC 1951, 3.2.6), stored bit reversed as they are written LSB first
+		struct DeflateTables
+		{
+			PxU16 literal_codes[288];
+			PxU8 literal_lengths[288];
+			PxU16 length_symbols[259];
+			PxU8 distance_symbols[512];
+
+			static const PxU16 length_base[29];
+			static const PxU8 length_extra[29];
+			static const PxU16 distance_base[30];
+			static const PxU8 distance_extra[30];
+
+			static PxU32 Reverse(PxU32 code, PxU32 bits)
+			{
+				PxU32 reversed = 0;
+				for (PxU32 i = 0; i < bits; i++, code >>= 1)
+					reversed = (reversed << 1) | (code & 1);
+				return reversed;
+			}
+
+			DeflateTables()
+			{
+				for (PxU32 i = 0; i < 288; i++)
+				{
+					PxU32 code, bits;
+					if (i < 144) { code = 0x30 + i; bits = 8; }
+					else if (i < 256) { code = 0x190 + (i - 144); bits = 9; }
+					else if (i < 280) { code = i - 256; bits = 7; }
+					else { code = 0xc0 + (i - 280); bits = 8; }
+					literal_codes[i] = (PxU16)Reverse(code, bits);
+					literal_lengths[i] = (PxU8)bits;
+				}
+				for (PxU32 s = 0; s < 29; s++)
+					for (PxU32 length = length_base[s]; (length < length_base[s] + (1u << length_extra[s])) && (length <= 258); length++)
+						length_symbols[length] = (PxU16)s;
+				//258 has a symbol of its own
+				length_symbols[258] = 28;
+				//distances up to 256 map directly, longer ones by their multiple of 128 like zlib
+				for (PxU32 s = 0; s < 30; s++)
+					for (PxU32 d = distance_base[s] - 1; d < distance_base[s] - 1 + (1u << distance_extra[s]); d++)
+						distance_symbols[(d < 256) ? d : 256 + (d >> 7)] = (PxU8)s;
+			}
+
+			PxU32 DistanceSymbol(PxU32 distance) const
+			{
+				PxU32 d = distance - 1;
+				return distance_symbols[(d < 256) ? d : 256 + (d >> 7)];
+			}
+		};
+
+		const PxU16 DeflateTables::length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		const PxU8 DeflateTables::length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const PxU16 DeflateTables::distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		const PxU8 DeflateTables::distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		class BitWriter
+		{
+			vector<PxU8>& out;
+			PxU64 bits;
+			PxU32 count;
+
+		public:
+			BitWriter(vector<PxU8>& output) : out(output), bits(0), count(0) {}
+
+			void Write(PxU32 value, PxU32 length)
+			{
+				bits |= (PxU64)value << count;
+				count += length;
+				while (count >= 8)
+				{
+					out.push_back((PxU8)bits);
+					bits >>= 8;
+					count -= 8;
+				}
+			}
+
+			void Flush()
+			{
+				if (count)
+					out.push_back((PxU8)bits);
+				bits = 0;
+				count = 0;
+			}
+		};
+
+		static PxU32 Hash3(const PxU8* data)
+		{
+			return ((((PxU32)data[0] << 16) | ((PxU32)data[1] << 8) | data[2]) * 2654435761u) >> (32 - 15);
+		}
+
+		//zlib stream of a single fixed Huffman block, each position is matched against the last one with the same three bytes
+		static void Deflate(const vector<PxU8>& data, vector<PxU8>& out)
+		{
+			static const DeflateTables tables;
+			const PxU32 window = 32768;
+			const PxU32 size = (PxU32)data.size();
+			const PxU8* bytes = data.empty() ? 0 : &data.front();
+
+			//deflate without a preset dictionary and a 32K window
+			out.push_back(0x78);
+			out.push_back(0x01);
+
+			BitWriter writer(out);
+			writer.Write(1, 1);
+			writer.Write(1, 2);
+
+			vector<PxI32> head(1 << 15, -1);
+			for (PxU32 i = 0; i < size;)
+			{
+				PxU32 match_length = 0, match_distance = 0;
+				if (i + 3 <= size)
+				{
+					PxU32 hash = Hash3(bytes + i);
+					PxI32 candidate = head[hash];
+					head[hash] = (PxI32)i;
+					if ((candidate >= 0) && (i - (PxU32)candidate <= window))
+					{
+						const PxU8* a = bytes + candidate;
+						const PxU8* b = bytes + i;
+						PxU32 max_length = PxMin(258u, size - i);
+						PxU32 length = 0;
+						while ((length < max_length) && (a[length] == b[length]))
+							length++;
+						if (length >= 3)
+						{
+							match_length = length;
+							match_distance = i - (PxU32)candidate;
+						}
+					}
+				}
+
+				if (!match_length)
+				{
+					writer.Write(tables.literal_codes[bytes[i]], tables.literal_lengths[bytes[i]]);
+					i++;
+					continue;
+				}
+
+				PxU32 length_symbol = tables.length_symbols[match_length];
+				writer.Write(tables.literal_codes[257 + length_symbol], tables.literal_lengths[257 + length_symbol]);
+				writer.Write(match_length - DeflateTables::length_base[length_symbol], DeflateTables::length_extra[length_symbol]);
+				PxU32 distance_symbol = tables.DistanceSymbol(match_distance);
+				writer.Write(DeflateTables::Reverse(distance_symbol, 5), 5);
+				writer.Write(match_distance - DeflateTables::distance_base[distance_symbol], DeflateTables::distance_extra[distance_symbol]);
+
+				for (PxU32 k = 1; (k < match_length) && (i + k + 3 <= size); k++)
+					head[Hash3(bytes + i + k)] = (PxI32)(i + k);
+				i += match_length;
+			}
+			writer.Write(tables.literal_codes[256], tables.literal_lengths[256]);
+			writer.Flush();
+
+			//the sums can not overflow within 5552 bytes, so the modulo is only taken once per block
+			PxU32 a = 1, b = 0;
+			for (PxU32 start = 0; start < size; start += 5552)
+			{
+				PxU32 end = PxMin(start + 5552, size);
+				for (PxU32 i = start; i < end; i++)
+				{
+					a += bytes[i];
+					b += a;
+				}
+				a %= 65521;
+				b %= 65521;
+			}
+			PxU32 adler = (b << 16) | a;
+			for (PxI32 shift = 24; shift >= 0; shift -= 8)
+				out.push_back((PxU8)(adler >> shift));
+		}
+
+		static PxU32 Crc32(const PxU8* data, size_t size, PxU32 crc)
+		{
+			struct Table
+			{
+				PxU32 values[256];
+
+				Table()
+				{
+					for (PxU32 i = 0; i < 256; i++)
+					{
+						PxU32 c = i;
+						for (PxU32 k = 0; k < 8; k++)
+							c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+						values[i] = c;
+					}
+				}
+			};
+			static const Table table;
+
+			crc = ~crc;
+			for (size_t i = 0; i < size; i++)
+				crc = table.values[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+			return ~crc;
+		}
+
+		static void PutU32(vector<PxU8>& out, PxU32 value)
+		{
+			for (PxI32 shift = 24; shift >= 0; shift -= 8)
+				out.push_back((PxU8)(value >> shift));
+		}
+
+		static void PutChunk(vector<PxU8>& png, const char* type, const vector<PxU8>& data)
+		{
+			PutU32(png, (PxU32)data.size());
+			size_t start = png.size();
+			png.insert(png.end(), type, type + 4);
+			png.insert(png.end(), data.begin(), data.end());
+			PutU32(png, Crc32(&png[start], png.size() - start, 0));
+		}
+
+		static PxU8 Paeth(PxU8 a, PxU8 b, PxU8 c)
+		{
+			int p = (int)a + b - c;
+			int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+			return ((pa <= pb) && (pa <= pc)) ? a : ((pb <= pc) ? b : c);
+		}
+
+		void EncodePNG(const PxU8* rgba, PxU32 width, PxU32 height, bool bottom_up, vector<PxU8>& png)
+		{
+			const PxU32 row_size = width * 3;
+			vector<PxU8> filtered;
+			filtered.reserve((size_t)(row_size + 1) * height);
+
+			//every row takes the filter with the smallest sum of signed residuals
+			vector<PxU8> previous(row_size, 0), current(row_size), candidates[4];
+			for (PxU32 f = 0; f < 4; f++)
+				candidates[f].resize(row_size);
+			for (PxU32 y = 0; y < height; y++)
+			{
+				const PxU8* source = rgba + (size_t)(bottom_up ? (height - 1 - y) : y) * width * 4;
+				for (PxU32 x = 0; x < width; x++)
+				{
+					current[x * 3] = source[x * 4];
+					current[x * 3 + 1] = source[x * 4 + 1];
+					current[x * 3 + 2] = source[x * 4 + 2];
+				}
+
+				PxU32 costs[4] = { 0, 0, 0, 0 };
+				for (PxU32 i = 0; i < row_size; i++)
+				{
+					PxU8 left = (i >= 3) ? current[i - 3] : 0;
+					PxU8 up_left = (i >= 3) ? previous[i - 3] : 0;
+					candidates[0][i] = current[i];
+					candidates[1][i] = (PxU8)(current[i] - left);
+					candidates[2][i] = (PxU8)(current[i] - previous[i]);
+					candidates[3][i] = (PxU8)(current[i] - Paeth(left, previous[i], up_left));
+					for (PxU32 f = 0; f < 4; f++)
+						costs[f] += (PxU32)abs((int)(signed char)candidates[f][i]);
+				}
+				PxU32 best = 0;
+				for (PxU32 f = 1; f < 4; f++)
+					if (costs[f] < costs[best])
+						best = f;
+
+				//None, Sub, Up and Paeth are filter types 0, 1, 2 and 4
+				filtered.push_back((PxU8)((best == 3) ? 4 : best));
+				filtered.insert(filtered.end(), candidates[best].begin(), candidates[best].end());
+				previous.swap(current);
+			}
+
+			png.clear();
+			static const PxU8 signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+			png.insert(png.end(), signature, signature + 8);
+
+			vector<PxU8> header;
+			PutU32(header, width);
+			PutU32(header, height);
+			//8 bits per channel RGB, deflate, adaptive filters, no interlace
+			const PxU8 format[5] = { 8, 2, 0, 0, 0 };
+			header.insert(header.end(), format, format + 5);
+			PutChunk(png, "IHDR", header);
+
+			vector<PxU8> compressed;
+			compressed.reserve(filtered.size() / 2);
+			Deflate(filtered, compressed);
+			PutChunk(png, "IDAT", compressed);
+			PutChunk(png, "IEND", vector<PxU8>());
+		}
+
+		bool WritePNG(const string& path, const PxU8* rgba, PxU32 width, PxU32 height, bool bottom_up)
+		{
+			vector<PxU8> png;
+			EncodePNG(rgba, width, height, bottom_up, png);
+
+			ofstream out(path.c_str(), ios::out | ios::binary | ios::trunc);
+			out.write((const char*)&png.front(), png.size());
+			return out.good();
+		}
+
+		bool WriteYUV(ostream& stream, const PxU8* rgba, PxU32 width, PxU32 height, bool bottom_up)
+		{
+			const PxU32 chroma_width = (width + 1) / 2;
+			const PxU32 chroma_height = (height + 1) / 2;
+			vector<PxU8> frame((size_t)width * height + (size_t)chroma_width * chroma_height * 2);
+			PxU8* luma = &frame.front();
+			PxU8* u = luma + (size_t)width * height;
+			PxU8* v = u + (size_t)chroma_width * chroma_height;
+
+			for (PxU32 y = 0; y < height; y++)
+			{
+				const PxU8* source = rgba + (size_t)(bottom_up ? (height - 1 - y) : y) * width * 4;
+				for (PxU32 x = 0; x < width; x++)
+				{
+					const PxU8* p = source + x * 4;
+					luma[(size_t)y * width + x] = (PxU8)(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+				}
+			}
+
+			//chroma of the average of every 2x2 block, the last row and column repeat on odd sizes
+			for (PxU32 cy = 0; cy < chroma_height; cy++)
+			{
+				PxU32 y0 = cy * 2, y1 = PxMin(cy * 2 + 1, height - 1);
+				const PxU8* row0 = rgba + (size_t)(bottom_up ? (height - 1 - y0) : y0) * width * 4;
+				const PxU8* row1 = rgba + (size_t)(bottom_up ? (height - 1 - y1) : y1) * width * 4;
+				for (PxU32 cx = 0; cx < chroma_width; cx++)
+				{
+					PxU32 x0 = cx * 8, x1 = PxMin(cx * 2 + 1, width - 1) * 4;
+					int r = (row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2;
+					int g = (row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1] + 2) >> 2;
+					int b = (row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2] + 2) >> 2;
+					//offset by 128 << 8 so the sums stay positive before the shift
+					u[(size_t)cy * chroma_width + cx] = (PxU8)((-38 * r - 74 * g + 112 * b + 32896) >> 8);
+					v[(size_t)cy * chroma_width + cx] = (PxU8)((112 * r - 94 * g - 18 * b + 32896) >> 8);
+				}
+			}
+
+			stream.write((const char*)&frame.front(), frame.size());
+			return stream.good();
+		}
+	}
+}
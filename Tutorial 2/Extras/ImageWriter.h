@@ -0,0 +1,27 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///Encode RGBA pixels as an RGB PNG, the alpha channel is dropped
+		///Rows are filtered and compressed with a fast single pass deflate using the fixed Huffman codes,
+		///bottom_up takes the rows in the order glReadPixels returns them.
+		void EncodePNG(const PxU8* rgba, PxU32 width, PxU32 height, bool bottom_up, std::vector<PxU8>& png);
+
+		///Write RGBA pixels to a PNG file, returns false if the file can not be written
+		bool WritePNG(const std::string& path, const PxU8* rgba, PxU32 width, PxU32 height, bool bottom_up);
+
+		///Append RGBA pixels to a stream as a planar YUV 4:2:0 (I420) frame
+		///BT.601 with limited range, the format raw video encoders expect by default.
+		///Odd sizes get their chroma planes rounded up.
+		bool WriteYUV(std::ostream& stream, const PxU8* rgba, PxU32 width, PxU32 height, bool bottom_up);
+	}
+}
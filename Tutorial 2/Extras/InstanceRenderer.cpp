@@ -0,0 +1,241 @@
+#include "InstanceRenderer.h"
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExt;
+
+		//first generic attribute of the instances, the transform takes four;
+		//the shader reads gl_Vertex, gl_Normal and gl_Color, which NVIDIA aliases to attributes 0, 2 and 3,
+		//so the instances start at 8 where only the texture coordinates alias
+		static const GLuint INSTANCE_ATTRIBUTE = 8;
+		static const GLuint INSTANCE_ATTRIBUTE_COUNT = 5;
+		static const GLuint SHADOW_TEXTURE_UNIT = 1;
+
+		//the fixed function transform and lighting of a single directional light, with the model matrix and color per instance
+		//the light is split into the part every surface gets and the part a shadow takes away
+		static const char* instance_vertex_shader =
+			"#version 120\n"
+			"attribute vec4 instance_column0;\n"
+			"attribute vec4 instance_column1;\n"
+			"attribute vec4 instance_column2;\n"
+			"attribute vec4 instance_column3;\n"
+			"attribute vec4 instance_color;\n"
+			"uniform bool use_instance_color;\n"
+			"uniform bool lighting;\n"
+			"uniform mat4 shadow_matrix;\n"
+			"varying vec4 ambient_color;\n"
+			"varying vec3 light_color;\n"
+			"varying vec4 shadow_coord;\n"
+			"void main()\n"
+			"{\n"
+			"	mat4 model = mat4(instance_column0, instance_column1, instance_column2, instance_column3);\n"
+			"	vec4 world = model * gl_Vertex;\n"
+			"	gl_Position = gl_ModelViewProjectionMatrix * world;\n"
+			"	shadow_coord = shadow_matrix * world;\n"
+			"	vec4 base = use_instance_color ? instance_color : gl_Color;\n"
+			"	if (!lighting)\n"
+			"	{\n"
+			"		//unlit surfaces lose a tenth of their color in a shadow, as with the planar shadows\n"
+			"		ambient_color = vec4(base.rgb * 0.9, base.a);\n"
+			"		light_color = base.rgb * 0.1;\n"
+			"		return;\n"
+			"	}\n"
+			"	//a scaled rotation transforms normals with its rotation divided by the scale\n"
+			"	vec3 scale2 = vec3(dot(model[0].xyz, model[0].xyz), dot(model[1].xyz, model[1].xyz), dot(model[2].xyz, model[2].xyz));\n"
+			"	vec3 normal = normalize(gl_NormalMatrix * (mat3(model[0].xyz, model[1].xyz, model[2].xyz) * (gl_Normal / scale2)));\n"
+			"	float diffuse = max(dot(normal, normalize(gl_LightSource[0].position.xyz)), 0.0);\n"
+			"	float specular = (diffuse > 0.0) ? pow(max(dot(normal, normalize(gl_LightSource[0].halfVector.xyz)), 0.0), gl_FrontMaterial.shininess) : 0.0;\n"
+			"	ambient_color = vec4(base.rgb * (gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb), base.a);\n"
+			"	light_color = base.rgb * gl_LightSource[0].diffuse.rgb * diffuse + gl_FrontMaterial.specular.rgb * gl_LightSource[0].specular.rgb * specular;\n"
+			"}\n";
+
+		static const char* instance_fragment_shader =
+			"#version 120\n"
+			"uniform bool receive_shadows;\n"
+			"uniform sampler2DShadow static_shadow_map;\n"
+			"uniform sampler2DShadow dynamic_shadow_map;\n"
+			"varying vec4 ambient_color;\n"
+			"varying vec3 light_color;\n"
+			"varying vec4 shadow_coord;\n"
+			"void main()\n"
+			"{\n"
+			"	float light = 1.0;\n"
+			"	if (receive_shadows)\n"
+			"	{\n"
+			"		//beyond the far side of the maps is lit like the border\n"
+			"		vec3 coord = vec3(shadow_coord.xy, min(shadow_coord.z, 1.0));\n"
+			"		light = shadow2D(static_shadow_map, coord).r * shadow2D(dynamic_shadow_map, coord).r;\n"
+			"	}\n"
+			"	gl_FragColor = vec4(ambient_color.rgb + light_color * light, ambient_color.a);\n"
+			"}\n";
+
+		static GLuint instance_program = 0;
+		static GLuint instance_buffer = 0;
+		static GLint use_instance_color_location = -1;
+		static GLint lighting_location = -1;
+		static GLint receive_shadows_location = -1;
+		static GLint shadow_matrix_location = -1;
+		static bool receive_shadows = false;
+
+		//the compiler or linker messages of a shader or program, empty if the driver gives none
+		template <typename GetivProc, typename GetInfoLogProc>
+		static std::string InfoLog(GLuint object, GetivProc get_iv, GetInfoLogProc get_info_log)
+		{
+			GLint length = 0;
+			if (get_info_log)
+				get_iv(object, INFO_LOG_LENGTH, &length);
+			if (length <= 1)
+				return std::string();
+			std::vector<GLchar> log(length);
+			get_info_log(object, length, 0, &log[0]);
+			return std::string(&log[0]);
+		}
+
+		static GLuint BuildShader(GLenum type, const char* source)
+		{
+			GLuint shader = CreateShader(type);
+			ShaderSource(shader, 1, &source, 0);
+			CompileShader(shader);
+			GLint compiled = 0;
+			GetShaderiv(shader, COMPILE_STATUS, &compiled);
+			if (!compiled)
+			{
+				std::cerr << "InstanceRenderer: shader not compiled, drawing without instancing" << std::endl << InfoLog(shader, GetShaderiv, GetShaderInfoLog);
+				DeleteShader(shader);
+				return 0;
+			}
+			return shader;
+		}
+
+		void InitInstancing()
+		{
+			if (!InstancingSupported())
+				return;
+
+			GLuint vertex_shader = BuildShader(VERTEX_SHADER, instance_vertex_shader);
+			GLuint fragment_shader = BuildShader(FRAGMENT_SHADER, instance_fragment_shader);
+			if (vertex_shader && fragment_shader)
+			{
+				instance_program = CreateProgram();
+				AttachShader(instance_program, vertex_shader);
+				AttachShader(instance_program, fragment_shader);
+				BindAttribLocation(instance_program, INSTANCE_ATTRIBUTE, "instance_column0");
+				BindAttribLocation(instance_program, INSTANCE_ATTRIBUTE + 1, "instance_column1");
+				BindAttribLocation(instance_program, INSTANCE_ATTRIBUTE + 2, "instance_column2");
+				BindAttribLocation(instance_program, INSTANCE_ATTRIBUTE + 3, "instance_column3");
+				BindAttribLocation(instance_program, INSTANCE_ATTRIBUTE + 4, "instance_color");
+				LinkProgram(instance_program);
+
+				GLint linked = 0;
+				GetProgramiv(instance_program, LINK_STATUS, &linked);
+				if (linked)
+				{
+					use_instance_color_location = GetUniformLocation(instance_program, "use_instance_color");
+					lighting_location = GetUniformLocation(instance_program, "lighting");
+					receive_shadows_location = GetUniformLocation(instance_program, "receive_shadows");
+					shadow_matrix_location = GetUniformLocation(instance_program, "shadow_matrix");
+
+					//the shadow maps stay on the texture units after the first one
+					UseProgram(instance_program);
+					Uniform1i(GetUniformLocation(instance_program, "static_shadow_map"), SHADOW_TEXTURE_UNIT + ShadowLayer::STATIC);
+					Uniform1i(GetUniformLocation(instance_program, "dynamic_shadow_map"), SHADOW_TEXTURE_UNIT + ShadowLayer::DYNAMIC);
+					UseProgram(0);
+					GenBuffers(1, &instance_buffer);
+				}
+				else
+				{
+					//the fallback draws every instance on its own, without the shadow maps
+					std::cerr << "InstanceRenderer: shaders not linked, drawing without instancing" << std::endl << InfoLog(instance_program, GetProgramiv, GetProgramInfoLog);
+					DeleteProgram(instance_program);
+					instance_program = 0;
+				}
+			}
+			//the program keeps the shaders alive
+			if (vertex_shader)
+				DeleteShader(vertex_shader);
+			if (fragment_shader)
+				DeleteShader(fragment_shader);
+		}
+
+		bool InstancedDraws()
+		{
+			return instance_program != 0;
+		}
+
+		void ReceiveShadows(bool value)
+		{
+			receive_shadows = value && instance_program && ShadowMapsReady();
+			if (!receive_shadows)
+				return;
+
+			for (GLuint i = 0; i < ShadowLayer::COUNT; i++)
+			{
+				ActiveTexture(TEXTURE0 + SHADOW_TEXTURE_UNIT + i);
+				glBindTexture(GL_TEXTURE_2D, ShadowTexture((ShadowLayer::Enum)i));
+			}
+			ActiveTexture(TEXTURE0);
+		}
+
+		void DrawInstances(const RenderMesh& mesh, const Instance* instances, PxU32 count, InstanceColor::Enum color)
+		{
+			if (!count || !mesh.index_count)
+				return;
+
+			bool vertex_colors = (color == InstanceColor::VERTEX);
+
+			//display lists are only used without buffer objects, so never with instancing
+			if (instance_program && !mesh.display_list)
+			{
+				UseProgram(instance_program);
+				Uniform1i(use_instance_color_location, color == InstanceColor::INSTANCE);
+				Uniform1i(lighting_location, glIsEnabled(GL_LIGHTING));
+				Uniform1i(receive_shadows_location, receive_shadows);
+				if (receive_shadows)
+					UniformMatrix4fv(shadow_matrix_location, 1, GL_FALSE, ShadowMatrix().front());
+
+				//a new store every draw, the driver keeps the one of the previous draw until it is done with it
+				BindBuffer(GLExt::ARRAY_BUFFER, instance_buffer);
+				BufferData(GLExt::ARRAY_BUFFER, count * sizeof(Instance), instances, GLExt::STREAM_DRAW);
+				for (GLuint i = 0; i < 4; i++)
+				{
+					EnableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+					VertexAttribPointer(INSTANCE_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (const void*)(offsetof(Instance, transform) + i * sizeof(PxVec4)));
+					VertexAttribDivisor(INSTANCE_ATTRIBUTE + i, 1);
+				}
+				EnableVertexAttribArray(INSTANCE_ATTRIBUTE + 4);
+				VertexAttribPointer(INSTANCE_ATTRIBUTE + 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance), (const void*)offsetof(Instance, color));
+				VertexAttribDivisor(INSTANCE_ATTRIBUTE + 4, 1);
+
+				BindRenderMesh(mesh, vertex_colors);
+				DrawElementsInstanced(GL_TRIANGLES, mesh.index_count, mesh.index_type, 0, (GLsizei)count);
+				UnbindRenderMesh(mesh);
+
+				for (GLuint i = 0; i < INSTANCE_ATTRIBUTE_COUNT; i++)
+				{
+					VertexAttribDivisor(INSTANCE_ATTRIBUTE + i, 0);
+					DisableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+				}
+				UseProgram(0);
+				return;
+			}
+
+			BindRenderMesh(mesh, vertex_colors);
+			for (PxU32 i = 0; i < count; i++)
+			{
+				glPushMatrix();
+				glMultMatrixf(instances[i].transform.front());
+				if (color == InstanceColor::INSTANCE)
+					glColor4ubv(instances[i].color);
+				DrawBoundRenderMesh(mesh, vertex_colors);
+				glPopMatrix();
+			}
+			UnbindRenderMesh(mesh);
+		}
+	}
+}
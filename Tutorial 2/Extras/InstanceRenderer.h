@@ -0,0 +1,48 @@
+#pragma once
+
+#include "RenderCache.h"
+#include "ShadowMap.h"
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///Placement and color of one shape drawn from shared geometry
+		struct Instance
+		{
+			PxMat44 transform;
+			GLubyte color[4];
+		};
+
+		///Where the color of the instances comes from
+		struct InstanceColor
+		{
+			enum Enum
+			{
+				//the color of every instance
+				INSTANCE,
+				//the vertex colors of the geometry
+				VERTEX,
+				//the current OpenGL color
+				CURRENT
+			};
+		};
+
+		///Compile the instancing shader if the driver supports instanced draws, call after LoadGLExtensions
+		void InitInstancing();
+
+		///Are the instances of a mesh drawn with a single instanced draw?
+		bool InstancedDraws();
+
+		///Darken the instances drawn from now on where the shadow maps are in front of them
+		///Only instanced draws receive shadows, the shadow maps are bound to the texture units after the first one.
+		void ReceiveShadows(bool value);
+
+		///Draw a mesh once per instance, on top of the current modelview matrix
+		///With instancing the transforms and colors are streamed into an instance buffer and drawn in one call,
+		///otherwise the vertex arrays of the mesh are set up once and the instances are drawn one after the other.
+		void DrawInstances(const RenderMesh& mesh, const Instance* instances, PxU32 count, InstanceColor::Enum color);
+	}
+}
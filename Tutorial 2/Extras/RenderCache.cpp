@@ -0,0 +1,460 @@
+#include "RenderCache.h"
+#include "GLExtensions.h"
+#include "..\Model.h"
+#include <unordered_map>
+
+using namespace std;
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExt;
+
+		//buffer objects or display lists, decided once the context is up
+		static bool use_buffers = false;
+
+		static ReleaseListener release_listener;
+		static unordered_map<const PxBase*, RenderMesh> render_meshes;
+
+		//geometry of a model, the model is watched without keeping it alive
+		struct ModelMesh
+		{
+			weak_ptr<const PhysicsEngine::Model> model;
+			RenderMesh mesh;
+		};
+
+		static unordered_map<const PhysicsEngine::Model*, ModelMesh> model_meshes;
+		static RenderMesh primitive_meshes[PrimitiveType::COUNT][PRIMITIVE_LOD_COUNT];
+		static PxU32 primitive_detail = 10;
+
+		static void SetArrays(const RenderVertex* vertices, bool colors)
+		{
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(RenderVertex), &vertices->position);
+			glNormalPointer(GL_FLOAT, sizeof(RenderVertex), &vertices->normal);
+			if (colors)
+			{
+				glEnableClientState(GL_COLOR_ARRAY);
+				glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(RenderVertex), &vertices->color);
+			}
+		}
+
+		static void ClearArrays()
+		{
+			glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+		}
+
+		void InitRenderCache()
+		{
+			use_buffers = BuffersSupported();
+
+			release_listener.Register();
+		}
+
+		RenderMesh CreateRenderMesh(const vector<RenderVertex>& vertices, const vector<PxU32>& indices, bool has_colors)
+		{
+			RenderMesh mesh;
+			mesh.has_colors = has_colors;
+			if (vertices.empty() || indices.empty())
+				return mesh;
+
+			mesh.index_count = (GLsizei)indices.size();
+			vector<GLushort> short_indices;
+			const void* index_data = &indices.front();
+			size_t index_size = sizeof(PxU32);
+			if (vertices.size() <= 0xffff)
+			{
+				short_indices.assign(indices.begin(), indices.end());
+				index_data = &short_indices.front();
+				index_size = sizeof(GLushort);
+				mesh.index_type = GL_UNSIGNED_SHORT;
+			}
+
+			if (use_buffers)
+			{
+				GenBuffers(1, &mesh.vertex_buffer);
+				BindBuffer(GLExt::ARRAY_BUFFER, mesh.vertex_buffer);
+				BufferData(GLExt::ARRAY_BUFFER, vertices.size() * sizeof(RenderVertex), &vertices.front(), GLExt::STATIC_DRAW);
+				BindBuffer(GLExt::ARRAY_BUFFER, 0);
+
+				GenBuffers(1, &mesh.index_buffer);
+				BindBuffer(GLExt::ELEMENT_ARRAY_BUFFER, mesh.index_buffer);
+				BufferData(GLExt::ELEMENT_ARRAY_BUFFER, indices.size() * index_size, index_data, GLExt::STATIC_DRAW);
+				BindBuffer(GLExt::ELEMENT_ARRAY_BUFFER, 0);
+			}
+			else
+			{
+				//the arrays are read when the lists are compiled, the second list leaves the color to the caller
+				mesh.display_list = glGenLists(2);
+				for (GLuint i = 0; i < 2; i++)
+				{
+					SetArrays(&vertices.front(), (i == 0) && has_colors);
+					glNewList(mesh.display_list + i, GL_COMPILE);
+					glDrawElements(GL_TRIANGLES, mesh.index_count, mesh.index_type, index_data);
+					glEndList();
+					ClearArrays();
+				}
+			}
+
+			return mesh;
+		}
+
+		void ReleaseRenderMesh(RenderMesh& mesh)
+		{
+			if (mesh.vertex_buffer)
+				DeleteBuffers(1, &mesh.vertex_buffer);
+			if (mesh.index_buffer)
+				DeleteBuffers(1, &mesh.index_buffer);
+			if (mesh.display_list)
+				glDeleteLists(mesh.display_list, 2);
+			mesh = RenderMesh();
+		}
+
+		void BindRenderMesh(const RenderMesh& mesh, bool colors)
+		{
+			if (mesh.display_list)
+				return;
+			BindBuffer(GLExt::ARRAY_BUFFER, mesh.vertex_buffer);
+			BindBuffer(GLExt::ELEMENT_ARRAY_BUFFER, mesh.index_buffer);
+			SetArrays(0, colors && mesh.has_colors);
+		}
+
+		void DrawBoundRenderMesh(const RenderMesh& mesh, bool colors)
+		{
+			if (mesh.display_list)
+				glCallList((colors && mesh.has_colors) ? mesh.display_list : mesh.display_list + 1);
+			else if (mesh.index_count)
+				glDrawElements(GL_TRIANGLES, mesh.index_count, mesh.index_type, 0);
+		}
+
+		void UnbindRenderMesh(const RenderMesh& mesh)
+		{
+			if (mesh.display_list)
+				return;
+			ClearArrays();
+			BindBuffer(GLExt::ELEMENT_ARRAY_BUFFER, 0);
+			BindBuffer(GLExt::ARRAY_BUFFER, 0);
+		}
+
+		void DrawRenderMesh(const RenderMesh& mesh, bool colors)
+		{
+			if (!mesh.index_count)
+				return;
+
+			BindRenderMesh(mesh, colors);
+			DrawBoundRenderMesh(mesh, colors);
+			UnbindRenderMesh(mesh);
+		}
+
+		static RenderMesh BuildModelMesh(const PhysicsEngine::Model& model, const PxVec3* material_colors)
+		{
+			const vector<PhysicsEngine::Vertex>& model_vertices = model.Vertices();
+			const vector<PxMaterialTableIndex>& materials = model.Materials();
+			bool colors = material_colors && !materials.empty();
+
+			vector<RenderVertex> vertices(model_vertices.size());
+			for (PxU32 i = 0; i < vertices.size(); i++)
+			{
+				vertices[i].position = model_vertices[i].position;
+				vertices[i].normal = model_vertices[i].normal;
+				vertices[i].color[0] = vertices[i].color[1] = vertices[i].color[2] = vertices[i].color[3] = 255;
+			}
+
+			vector<PxU32> indices(model.IndexCount());
+			for (PxU32 i = 0; i < indices.size(); i++)
+				indices[i] = model.Index(i);
+
+			//the corners of triangles with different materials are separate vertices (see Model::Load)
+			if (colors)
+			{
+				for (PxU32 i = 0; i < indices.size(); i++)
+				{
+					PxVec3 c = material_colors[materials[i / 3]];
+					RenderVertex& vertex = vertices[indices[i]];
+					vertex.color[0] = (GLubyte)(PxClamp(c.x, 0.f, 1.f) * 255.f + .5f);
+					vertex.color[1] = (GLubyte)(PxClamp(c.y, 0.f, 1.f) * 255.f + .5f);
+					vertex.color[2] = (GLubyte)(PxClamp(c.z, 0.f, 1.f) * 255.f + .5f);
+				}
+			}
+
+			return CreateRenderMesh(vertices, indices, colors);
+		}
+
+		//flat shaded like the chunks of the course, through the same Model
+		static RenderMesh BuildTriangleMesh(const PxTriangleMesh* mesh, const PxVec3* material_colors)
+		{
+			const bool has_16bit_indices = mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::e16_BIT_INDICES;
+			const void* trigs = mesh->getTriangles();
+			const PxU32 num_trigs = mesh->getNbTriangles();
+
+			vector<PxVec3> positions(mesh->getVertices(), mesh->getVertices() + mesh->getNbVertices());
+			vector<PxU32> triangles(num_trigs * 3);
+			for (PxU32 i = 0; i < triangles.size(); i++)
+				triangles[i] = has_16bit_indices ? ((const PxU16*)trigs)[i] : ((const PxU32*)trigs)[i];
+			vector<PxMaterialTableIndex> materials;
+			if (material_colors)
+			{
+				//a mesh without a material table has the first material everywhere
+				materials.resize(num_trigs);
+				for (PxU32 i = 0; i < num_trigs; i++)
+				{
+					PxMaterialTableIndex material = mesh->getTriangleMaterialIndex(i);
+					materials[i] = (material == 0xffff) ? 0 : material;
+				}
+			}
+
+			PhysicsEngine::Model model;
+			model.Load(positions, triangles, materials);
+			return BuildModelMesh(model, material_colors);
+		}
+
+		const RenderMesh& GetRenderMesh(const PxTriangleMesh* mesh, const PxVec3* material_colors)
+		{
+			pair<unordered_map<const PxBase*, RenderMesh>::iterator, bool> found = render_meshes.insert(make_pair(mesh, RenderMesh()));
+			RenderMesh& render_mesh = found.first->second;
+			//built for the shadow pass before the mesh was drawn with its colors
+			if (!found.second && material_colors && !render_mesh.has_colors)
+				ReleaseRenderMesh(render_mesh);
+			if (!render_mesh.index_count)
+				render_mesh = BuildTriangleMesh(mesh, material_colors);
+			return render_mesh;
+		}
+
+		const RenderMesh& GetRenderMesh(const shared_ptr<const PhysicsEngine::Model>& model, const PxVec3* material_colors)
+		{
+			pair<unordered_map<const PhysicsEngine::Model*, ModelMesh>::iterator, bool> found = model_meshes.insert(make_pair(model.get(), ModelMesh()));
+			ModelMesh& model_mesh = found.first->second;
+			//a model dropped since the last flush left its geometry at the address of the new one,
+			//or the geometry was built for the shadow pass before the model was drawn with its colors
+			if (!found.second && (model_mesh.model.expired() || (material_colors && !model_mesh.mesh.has_colors && !model->Materials().empty())))
+				ReleaseRenderMesh(model_mesh.mesh);
+			if (!model_mesh.mesh.index_count)
+			{
+				model_mesh.model = model;
+				model_mesh.mesh = BuildModelMesh(*model, material_colors);
+			}
+			return model_mesh.mesh;
+		}
+
+		static RenderMesh BuildConvexMesh(const PxConvexMesh* mesh)
+		{
+			const PxVec3* verts = mesh->getVertices();
+			const PxU8* polygon_indices = mesh->getIndexBuffer();
+
+			//polygons do not share corners, each one has its own normal
+			vector<RenderVertex> vertices;
+			vector<PxU32> indices;
+			for (PxU32 i = 0; i < mesh->getNbPolygons(); i++)
+			{
+				PxHullPolygon face;
+				if (!mesh->getPolygonData(i, face) || (face.mNbVerts < 3))
+					continue;
+
+				PxU32 first = (PxU32)vertices.size();
+				for (PxU32 j = 0; j < face.mNbVerts; j++)
+				{
+					RenderVertex vertex;
+					vertex.position = verts[polygon_indices[face.mIndexBase + j]];
+					vertex.normal = PxVec3(face.mPlane[0], face.mPlane[1], face.mPlane[2]);
+					vertex.color[0] = vertex.color[1] = vertex.color[2] = vertex.color[3] = 255;
+					vertices.push_back(vertex);
+				}
+				for (PxU32 j = 2; j < face.mNbVerts; j++)
+				{
+					indices.push_back(first);
+					indices.push_back(first + j - 1);
+					indices.push_back(first + j);
+				}
+			}
+
+			return CreateRenderMesh(vertices, indices, false);
+		}
+
+		const RenderMesh& GetRenderMesh(const PxConvexMesh* mesh)
+		{
+			RenderMesh& render_mesh = render_meshes[mesh];
+			if (!render_mesh.index_count)
+				render_mesh = BuildConvexMesh(mesh);
+			return render_mesh;
+		}
+
+		static RenderVertex PrimitiveVertex(const PxVec3& position, const PxVec3& normal)
+		{
+			RenderVertex vertex;
+			vertex.position = position;
+			vertex.normal = normal;
+			vertex.color[0] = vertex.color[1] = vertex.color[2] = vertex.color[3] = 255;
+			return vertex;
+		}
+
+		//a grid of rings around the x axis, ring r at angle polar_angle*r/rings from +x, the quads are wound counter-clockwise from outside
+		static void AddRings(vector<RenderVertex>& vertices, vector<PxU32>& indices, PxU32 slices, PxU32 rings, PxReal polar_angle)
+		{
+			PxU32 first = (PxU32)vertices.size();
+			for (PxU32 r = 0; r <= rings; r++)
+			{
+				PxReal theta = polar_angle * r / rings;
+				for (PxU32 s = 0; s <= slices; s++)
+				{
+					PxReal phi = PxTwoPi * s / slices;
+					PxVec3 n(PxCos(theta), PxSin(theta) * PxCos(phi), PxSin(theta) * PxSin(phi));
+					vertices.push_back(PrimitiveVertex(n, n));
+				}
+			}
+			for (PxU32 r = 0; r < rings; r++)
+			{
+				for (PxU32 s = 0; s < slices; s++)
+				{
+					PxU32 i0 = first + r * (slices + 1) + s;
+					PxU32 i1 = i0 + slices + 1;
+					//the quads touching the pole are triangles
+					if (r != 0)
+					{
+						indices.push_back(i0);
+						indices.push_back(i1);
+						indices.push_back(i0 + 1);
+					}
+					if ((r != rings - 1) || (polar_angle < PxPi))
+					{
+						indices.push_back(i0 + 1);
+						indices.push_back(i1);
+						indices.push_back(i1 + 1);
+					}
+				}
+			}
+		}
+
+		static RenderMesh BuildPrimitiveMesh(PrimitiveType::Enum type, PxU32 lod)
+		{
+			PxU32 slices = PxMax(primitive_detail >> lod, 6u);
+			vector<RenderVertex> vertices;
+			vector<PxU32> indices;
+
+			switch (type)
+			{
+			case PrimitiveType::SPHERE:
+				AddRings(vertices, indices, slices, PxMax(slices / 2, 3u), PxPi);
+				break;
+			case PrimitiveType::HEMISPHERE:
+				AddRings(vertices, indices, slices, PxMax(slices / 4, 2u), PxHalfPi);
+				break;
+			case PrimitiveType::CYLINDER:
+				for (PxU32 s = 0; s <= slices; s++)
+				{
+					PxReal phi = PxTwoPi * s / slices;
+					PxVec3 n(0.f, PxCos(phi), PxSin(phi));
+					vertices.push_back(PrimitiveVertex(n + PxVec3(1.f, 0.f, 0.f), n));
+					vertices.push_back(PrimitiveVertex(n - PxVec3(1.f, 0.f, 0.f), n));
+				}
+				for (PxU32 s = 0; s < slices; s++)
+				{
+					PxU32 i0 = s * 2;
+					indices.push_back(i0);
+					indices.push_back(i0 + 1);
+					indices.push_back(i0 + 2);
+					indices.push_back(i0 + 2);
+					indices.push_back(i0 + 1);
+					indices.push_back(i0 + 3);
+				}
+				break;
+			case PrimitiveType::BOX:
+				//four corners per face for flat normals
+				for (PxU32 axis = 0; axis < 3; axis++)
+				{
+					for (PxReal side = -1.f; side <= 1.f; side += 2.f)
+					{
+						PxVec3 n(0.f), u(0.f), v(0.f);
+						n[axis] = side;
+						u[(axis + 1) % 3] = 1.f;
+						v[(axis + 2) % 3] = side;
+						PxU32 first = (PxU32)vertices.size();
+						vertices.push_back(PrimitiveVertex(n - u - v, n));
+						vertices.push_back(PrimitiveVertex(n + u - v, n));
+						vertices.push_back(PrimitiveVertex(n + u + v, n));
+						vertices.push_back(PrimitiveVertex(n - u + v, n));
+						indices.push_back(first);
+						indices.push_back(first + 1);
+						indices.push_back(first + 2);
+						indices.push_back(first);
+						indices.push_back(first + 2);
+						indices.push_back(first + 3);
+					}
+				}
+				break;
+			case PrimitiveType::PLANE:
+				vertices.push_back(PrimitiveVertex(PxVec3(-1.f, 0.f, -1.f), PxVec3(0.f, 1.f, 0.f)));
+				vertices.push_back(PrimitiveVertex(PxVec3(-1.f, 0.f, 1.f), PxVec3(0.f, 1.f, 0.f)));
+				vertices.push_back(PrimitiveVertex(PxVec3(1.f, 0.f, 1.f), PxVec3(0.f, 1.f, 0.f)));
+				vertices.push_back(PrimitiveVertex(PxVec3(1.f, 0.f, -1.f), PxVec3(0.f, 1.f, 0.f)));
+				indices.push_back(0);
+				indices.push_back(1);
+				indices.push_back(2);
+				indices.push_back(2);
+				indices.push_back(3);
+				indices.push_back(0);
+				break;
+			default:
+				break;
+			}
+
+			return CreateRenderMesh(vertices, indices, false);
+		}
+
+		const RenderMesh& GetPrimitiveMesh(PrimitiveType::Enum type, PxU32 lod)
+		{
+			//the box and the plane are flat, one level is enough
+			if ((type == PrimitiveType::BOX) || (type == PrimitiveType::PLANE))
+				lod = 0;
+			lod = PxMin(lod, PRIMITIVE_LOD_COUNT - 1);
+			RenderMesh& mesh = primitive_meshes[type][lod];
+			if (!mesh.index_count)
+				mesh = BuildPrimitiveMesh(type, lod);
+			return mesh;
+		}
+
+		void SetPrimitiveDetail(PxU32 segments)
+		{
+			if (segments == primitive_detail)
+				return;
+			primitive_detail = segments;
+			for (PxU32 i = 0; i < PrimitiveType::COUNT; i++)
+				for (PxU32 lod = 0; lod < PRIMITIVE_LOD_COUNT; lod++)
+					if (primitive_meshes[i][lod].index_count)
+						ReleaseRenderMesh(primitive_meshes[i][lod]);
+		}
+
+		void FlushRenderCache()
+		{
+			vector<const PxBase*> released;
+			release_listener.Take(released);
+			for (PxU32 i = 0; i < released.size(); i++)
+			{
+				unordered_map<const PxBase*, RenderMesh>::iterator found = render_meshes.find(released[i]);
+				if (found == render_meshes.end())
+					continue;
+				ReleaseRenderMesh(found->second);
+				render_meshes.erase(found);
+			}
+
+			for (unordered_map<const PhysicsEngine::Model*, ModelMesh>::iterator it = model_meshes.begin(); it != model_meshes.end();)
+			{
+				if (!it->second.model.expired())
+				{
+					it++;
+					continue;
+				}
+				ReleaseRenderMesh(it->second.mesh);
+				it = model_meshes.erase(it);
+			}
+		}
+
+		PxU32 RenderCacheSize()
+		{
+			return (PxU32)(render_meshes.size() + model_meshes.size());
+		}
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "GLExtensions.h"
+#include "UserData.h"
+#include <vector>
+#include <mutex>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///Interleaved vertex of the cached geometry
+		struct RenderVertex
+		{
+			PxVec3 position;
+			PxVec3 normal;
+			//RGBA, used when a mesh is drawn with its material colors
+			GLubyte color[4];
+		};
+
+		///Geometry uploaded once and drawn with a single glDrawElements
+		///The vertices and indices live in buffer objects when the driver supports OpenGL 1.5,
+		///otherwise they are compiled into two display lists, with and without the vertex colors.
+		struct RenderMesh
+		{
+			GLuint vertex_buffer;
+			GLuint index_buffer;
+			GLuint display_list;
+			GLenum index_type;
+			GLsizei index_count;
+			bool has_colors;
+
+			RenderMesh() : vertex_buffer(0), index_buffer(0), display_list(0), index_type(GL_UNSIGNED_INT), index_count(0), has_colors(false) {}
+		};
+
+		///Collects the objects PhysX frees, on whichever thread releases them
+		///Caches keyed by PhysX pointers evict these before a new object can reuse the address.
+		class ReleaseListener : public PxDeletionListener
+		{
+			std::mutex released_mutex;
+			std::vector<const PxBase*> released;
+
+		public:
+			///Start listening, needs an initialised PhysX SDK
+			void Register()
+			{
+				PxGetPhysics().registerDeletionListener(*this, PxDeletionEventFlag::eMEMORY_RELEASE);
+			}
+
+			virtual void onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent)
+			{
+				std::lock_guard<std::mutex> lock(released_mutex);
+				released.push_back(observed);
+			}
+
+			///Get the objects released since the last call
+			void Take(std::vector<const PxBase*>& objects)
+			{
+				std::lock_guard<std::mutex> lock(released_mutex);
+				objects.clear();
+				objects.swap(released);
+			}
+		};
+
+		///Unit shapes tessellated once and scaled into place
+		struct PrimitiveType
+		{
+			enum Enum
+			{
+				//radius 1
+				SPHERE,
+				//radius 1, the dome points along +x, two of them cap a capsule
+				HEMISPHERE,
+				//radius 1 around the x axis from -1 to 1, without caps
+				CYLINDER,
+				//half extents 1
+				BOX,
+				//the square from -1 to 1 in x and z, facing +y
+				PLANE,
+				COUNT
+			};
+		};
+
+		///Number of levels of detail of the curved primitives, level 0 is the finest
+		static const PxU32 PRIMITIVE_LOD_COUNT = 4;
+
+		///Choose buffer objects or display lists and start tracking the meshes released by PhysX
+		///Needs the OpenGL extensions loaded (see LoadGLExtensions) and an initialised PhysX SDK.
+		void InitRenderCache();
+
+		///Upload triangles, indices are 16-bit when there are at most 65535 vertices
+		RenderMesh CreateRenderMesh(const std::vector<RenderVertex>& vertices, const std::vector<PxU32>& indices, bool has_colors);
+
+		///Free the buffers or display lists of uploaded geometry
+		void ReleaseRenderMesh(RenderMesh& mesh);
+
+		///Draw uploaded geometry with the colors of its vertices or with the current color
+		void DrawRenderMesh(const RenderMesh& mesh, bool colors);
+
+		///Set up the vertex arrays of uploaded geometry for several draws
+		void BindRenderMesh(const RenderMesh& mesh, bool colors);
+
+		///Draw geometry set up with BindRenderMesh
+		void DrawBoundRenderMesh(const RenderMesh& mesh, bool colors);
+
+		///Reset the vertex arrays set up with BindRenderMesh
+		void UnbindRenderMesh(const RenderMesh& mesh);
+
+		///Get the geometry of a triangle mesh, uploaded on its first use
+		///Triangles are flat shaded, colored from the material colors by their material index if given.
+		const RenderMesh& GetRenderMesh(const PxTriangleMesh* mesh, const PxVec3* material_colors=0);
+
+		///Get the geometry of a model, uploaded on its first use with the normals of its vertices
+		///Triangles are colored from the material colors by the material indices of the model if given.
+		///The cache keeps no reference, the geometry is freed once the last owner drops the model.
+		const RenderMesh& GetRenderMesh(const std::shared_ptr<const PhysicsEngine::Model>& model, const PxVec3* material_colors=0);
+
+		///Get the geometry of a convex mesh, uploaded on its first use
+		///Every hull polygon is triangulated into a fan with the normal of its plane.
+		const RenderMesh& GetRenderMesh(const PxConvexMesh* mesh);
+
+		///Get a unit primitive at a level of detail, uploaded on its first use
+		///The finest level has the segments set with SetPrimitiveDetail around its axis, every further level halves them.
+		const RenderMesh& GetPrimitiveMesh(PrimitiveType::Enum type, PxU32 lod);
+
+		///Set the segments of the finest level of detail, the primitives are tessellated again on their next use
+		void SetPrimitiveDetail(PxU32 segments);
+
+		///Free the geometry of the meshes PhysX released and of the models dropped since the last call, call once per frame
+		void FlushRenderCache();
+
+		///Number of meshes and models with cached geometry
+		PxU32 RenderCacheSize();
+	}
+}
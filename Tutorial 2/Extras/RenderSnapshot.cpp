@@ -0,0 +1,194 @@
+#include "RenderSnapshot.h"
+#include "RenderCache.h"
+#include "UserData.h"
+#include <unordered_map>
+
+using namespace std;
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		//a shape as the last snapshot it was in saw it
+		struct ShapeState
+		{
+			PxTransform pose;
+			//world bounds, static and sleeping shapes keep theirs from the step they were last seen moving
+			PxBounds3 bounds;
+			//the snapshot, counted by snapshot_count
+			PxU32 snapshot;
+		};
+
+		//only used by the thread taking the snapshots
+		static unordered_map<const PxShape*, ShapeState> shape_states;
+		static PxU32 snapshot_count = 0;
+		static ReleaseListener shape_release_listener;
+		static bool listener_registered = false;
+
+		//the pose and bounds of the shape at this snapshot and the one before
+		static void TakeShapeState(SnapshotShape& snapshot_shape, const PxRigidActor* actor, bool moving)
+		{
+			const PxShape* shape = snapshot_shape.shape;
+			snapshot_shape.step_pose = PxShapeExt::getGlobalPose(*shape, *actor);
+			snapshot_shape.previous_pose = snapshot_shape.step_pose;
+			snapshot_shape.pose = snapshot_shape.step_pose;
+			//planes are unbounded
+			bool is_plane = snapshot_shape.geometry.getType() == PxGeometryType::ePLANE;
+
+			pair<unordered_map<const PxShape*, ShapeState>::iterator, bool> inserted = shape_states.insert(make_pair(shape, ShapeState()));
+			ShapeState& state = inserted.first->second;
+			//a shape missing from the last snapshot, or just created, starts where it is
+			bool seen = !inserted.second && (state.snapshot + 1 == snapshot_count);
+			PxBounds3 previous_bounds = state.bounds;
+
+			if (inserted.second || moving)
+				state.bounds = is_plane ? PxBounds3::empty() : PxShapeExt::getWorldBounds(*shape, *actor);
+			snapshot_shape.bounds = state.bounds;
+
+			if (seen && !snapshot_shape.is_static)
+			{
+				snapshot_shape.previous_pose = state.pose;
+				//the rotation in between can stick out of both a little, too little to matter for culling
+				if (moving)
+					snapshot_shape.bounds.include(previous_bounds);
+			}
+
+			state.pose = snapshot_shape.step_pose;
+			state.snapshot = snapshot_count;
+		}
+
+		static void FlushShapeStates()
+		{
+			if (!listener_registered)
+			{
+				shape_release_listener.Register();
+				listener_registered = true;
+			}
+
+			vector<const PxBase*> released;
+			shape_release_listener.Take(released);
+			for (PxU32 i = 0; i < released.size(); i++)
+				shape_states.erase((const PxShape*)released[i]);
+		}
+
+		//spherical interpolation along the shorter arc
+		static PxQuat Slerp(const PxQuat& from, const PxQuat& to, PxReal t)
+		{
+			PxReal cosine = from.dot(to);
+			//q and -q are the same rotation
+			PxQuat target = (cosine < 0) ? -to : to;
+			cosine = PxAbs(cosine);
+
+			PxReal from_weight = 1.f - t;
+			PxReal to_weight = t;
+			//for nearly equal rotations the sine vanishes and a normalized linear blend is as good
+			if (cosine < 0.9995f)
+			{
+				PxReal angle = PxAcos(cosine);
+				PxReal sine = PxSin(angle);
+				from_weight = PxSin(from_weight * angle) / sine;
+				to_weight = PxSin(to_weight * angle) / sine;
+			}
+			return (from * from_weight + target * to_weight).getNormalized();
+		}
+
+		void DebugSnapshot::Take(const PxRenderBuffer& data)
+		{
+			points.assign(data.getPoints(), data.getPoints() + data.getNbPoints());
+			lines.assign(data.getLines(), data.getLines() + data.getNbLines());
+			triangles.assign(data.getTriangles(), data.getTriangles() + data.getNbTriangles());
+		}
+
+		void DebugSnapshot::Clear()
+		{
+			points.clear();
+			lines.clear();
+			triangles.clear();
+		}
+
+		void RenderSnapshot::Take(PxActor** actors, PxU32 count)
+		{
+			//the shapes of the last snapshot taken in this one are not seen by the renderer any more
+			Clear();
+			FlushShapeStates();
+			snapshot_count++;
+
+			vector<PxShape*> actor_shapes;
+			for (PxU32 i = 0; i < count; i++)
+			{
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+				if (!actors[i]->isRigidActor())
+					continue;
+				bool is_static = actors[i]->isRigidStatic() != 0;
+				bool moving = actors[i]->isRigidDynamic() && !((const PxRigidDynamic*)actors[i])->isSleeping();
+#else
+				if (!actors[i]->is<PxRigidActor>())
+					continue;
+				bool is_static = actors[i]->is<PxRigidStatic>() != 0;
+				bool moving = actors[i]->is<PxRigidDynamic>() && !((const PxRigidDynamic*)actors[i])->isSleeping();
+#endif
+				bool visible = actors[i]->getActorFlags() & PxActorFlag::eVISUALIZATION;
+				PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
+				actor_shapes.resize(rigid_actor->getNbShapes());
+				if (actor_shapes.empty())
+					continue;
+				rigid_actor->getShapes(&actor_shapes.front(), (PxU32)actor_shapes.size());
+
+				for (PxU32 j = 0; j < actor_shapes.size(); j++)
+				{
+					PxShape* shape = actor_shapes[j];
+					shape->acquireReference();
+
+					SnapshotShape snapshot_shape;
+					snapshot_shape.shape = shape;
+					snapshot_shape.geometry = shape->getGeometry();
+					snapshot_shape.is_static = is_static;
+					TakeShapeState(snapshot_shape, rigid_actor, moving);
+					snapshot_shape.color = PxVec3(.8f, .8f, .8f);
+					snapshot_shape.material_colors = (PxU32)-1;
+					snapshot_shape.visible = visible;
+
+					//the user data goes away with its actor, copy what is drawn
+					const UserData* user_data = (const UserData*)shape->userData;
+					if (user_data)
+					{
+						if (user_data->color)
+							snapshot_shape.color = *user_data->color;
+						snapshot_shape.render_model = user_data->render_model;
+						if (user_data->material_colors)
+						{
+							snapshot_shape.material_colors = (PxU32)material_colors.size();
+							material_colors.insert(material_colors.end(), user_data->material_colors, user_data->material_colors + user_data->material_count);
+						}
+					}
+
+					shapes.push_back(snapshot_shape);
+				}
+			}
+		}
+
+		void RenderSnapshot::Clear()
+		{
+			for (PxU32 i = 0; i < shapes.size(); i++)
+			{
+				((PxShape*)shapes[i].shape)->release();
+			}
+			shapes.clear();
+			material_colors.clear();
+			debug.Clear();
+		}
+
+		void RenderSnapshot::Interpolate(PxReal alpha)
+		{
+			alpha = PxClamp(alpha, 0.f, 1.f);
+			for (PxU32 i = 0; i < shapes.size(); i++)
+			{
+				SnapshotShape& shape = shapes[i];
+				if (shape.is_static)
+					continue;
+				shape.pose.p = shape.previous_pose.p + (shape.step_pose.p - shape.previous_pose.p) * alpha;
+				shape.pose.q = Slerp(shape.previous_pose.q, shape.step_pose.q, alpha);
+			}
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "UserData.h"
+#include <vector>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///A shape as a simulation step left it, with everything the renderer reads from it
+		struct SnapshotShape
+		{
+			//identity for the render caches, the geometry is copied below
+			const PxShape* shape;
+			PxGeometryHolder geometry;
+			//the pose drawn, the one of the step until RenderSnapshot::Interpolate moves it
+			PxTransform pose;
+			PxTransform step_pose;
+			//the pose at the step before, the step pose for static shapes and shapes new to the snapshots
+			PxTransform previous_pose;
+			//covers the shape at both poses
+			PxBounds3 bounds;
+			PxVec3 color;
+			//full detail model drawn instead of the collision mesh, or empty
+			std::shared_ptr<const PhysicsEngine::Model> render_model;
+			//first material color of a mesh with a material table in RenderSnapshot::material_colors, or -1
+			PxU32 material_colors;
+			bool is_static;
+			//actors with PxActorFlag::eVISUALIZATION cleared are hidden
+			bool visible;
+		};
+
+		///Debug visualisation copied from a PxRenderBuffer, with the same accessors
+		class DebugSnapshot
+		{
+			std::vector<PxDebugPoint> points;
+			std::vector<PxDebugLine> lines;
+			std::vector<PxDebugTriangle> triangles;
+
+		public:
+			///Copy the points, lines and triangles of the buffer
+			void Take(const PxRenderBuffer& data);
+
+			void Clear();
+
+			PxU32 getNbPoints() const { return (PxU32)points.size(); }
+			const PxDebugPoint* getPoints() const { return points.empty() ? 0 : &points.front(); }
+			PxU32 getNbLines() const { return (PxU32)lines.size(); }
+			const PxDebugLine* getLines() const { return lines.empty() ? 0 : &lines.front(); }
+			PxU32 getNbTriangles() const { return (PxU32)triangles.size(); }
+			const PxDebugTriangle* getTriangles() const { return triangles.empty() ? 0 : &triangles.front(); }
+		};
+
+		///The drawable state of the rigid actors of a scene, taken by the simulation thread after fetchResults
+		///and drawn by the render thread while the next steps run. The snapshot holds a reference on its shapes
+		///and render models, so they outlive the actors and meshes the simulation releases meanwhile;
+		///the references are dropped by the next Take or by Clear, on the thread taking the snapshots.
+		class RenderSnapshot
+		{
+			RenderSnapshot(const RenderSnapshot&);
+			RenderSnapshot& operator=(const RenderSnapshot&);
+
+		public:
+			std::vector<SnapshotShape> shapes;
+			//material colors of the meshes with a material table, see SnapshotShape
+			std::vector<PxVec3> material_colors;
+			DebugSnapshot debug;
+
+			RenderSnapshot() {}
+
+			~RenderSnapshot()
+			{
+				Clear();
+			}
+
+			///Take the shapes of the actors in place of the previous ones, needs the scene not to be simulating
+			void Take(PxActor** actors, PxU32 count);
+
+			///Drop the shapes and the debug visualisation
+			void Clear();
+
+			///Draw the dynamic shapes alpha of the way from their previous pose to the one of the step,
+			///so a frame drawn between two steps does not stutter when the frame rate differs from the step rate
+			void Interpolate(PxReal alpha);
+		};
+	}
+}
@@ -2,6 +2,15 @@
 #include <iostream>
 #include <vector>
 #include "UserData.h"
+#include "RenderCache.h"
+#include "InstanceRenderer.h"
+#include "Frustum.h"
+#include "ShadowMap.h"
+#include "HeadlessContext.h"
+#include "FrameCapture.h"
+#include "RenderSnapshot.h"
+#include <map>
+#include <atomic>
 
 using namespace std;
 
@@ -11,151 +20,281 @@ namespace VisualDebugger
 	{
 		PxVec3 default_color = PxVec3(0.8f, 0.8f, 0.8f);
 		PxVec3 background_color = PxVec3(0.f,0.f,0.f);
-		int render_detail = 10;
+		//camera position and pixels per unit at distance 1, for the levels of detail
+		PxVec3 camera_eye = PxVec3(0.f, 0.f, 0.f);
+		PxReal lod_scale = 1.f;
 		bool show_shadows = true;
+		//size of the window or of the offscreen surface
+		int window_width = 1;
+		int window_height = 1;
+		//drawing into an offscreen surface, without GLUT
+		bool headless = false;
+		//direction the shadow casting light shines in
+		PxVec3 shadow_direction = PxVec3(-0.7071067f, -0.7071067f, -0.7071067f);
+		//view volume of the current frame, set in Start
+		Frustum view_frustum;
+		//shapes drawn and culled in the last frame
+		//read by the simulation thread for the HUD
+		atomic<PxU32> drawn_shapes(0);
+		atomic<PxU32> culled_shapes(0);
+
+		//level of detail of a shape from the screen size of its radius, the finest when it covers more than 64 pixels
+		PxU32 SelectLod(PxReal radius, const PxVec3& position)
+		{
+			PxReal pixels = radius * lod_scale / PxMax((position - camera_eye).magnitude(), 1e-3f);
+			if (pixels >= 64.f)
+				return 0;
+			if (pixels >= 24.f)
+				return 1;
+			if (pixels >= 8.f)
+				return 2;
+			return 3;
+		}
 
-		static float gPlaneData[]={
-			-1.f, 0.f, -1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f, 1.f, 0.f,
-			1.f, 0.f, 1.f, 0.f, 1.f, 0.f, -1.f, 0.f, -1.f, 0.f, 1.f, 0.f,
-			1.f, 0.f, 1.f, 0.f, 1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f
-		};
+		//shapes drawn from the same geometry with the same color source, collected by Render
+		typedef map<pair<const RenderMesh*, InstanceColor::Enum>, vector<Instance> > InstanceGroups;
+		InstanceGroups instance_groups;
+		//planes, drawn without lighting
+		InstanceGroups plane_groups;
+		//shadow casters, the static ones are only collected when their shadow map is drawn again
+		InstanceGroups static_casters;
+		InstanceGroups dynamic_casters;
+		//casters flattened onto the ground without shadow maps
+		InstanceGroups planar_casters;
+
+		void AddInstance(InstanceGroups& groups, const RenderMesh& mesh, InstanceColor::Enum color_source, const PxMat44& transform, const PxVec3& color)
+		{
+			Instance instance;
+			instance.transform = transform;
+			instance.color[0] = (GLubyte)(PxClamp(color.x, 0.f, 1.f) * 255.f + .5f);
+			instance.color[1] = (GLubyte)(PxClamp(color.y, 0.f, 1.f) * 255.f + .5f);
+			instance.color[2] = (GLubyte)(PxClamp(color.z, 0.f, 1.f) * 255.f + .5f);
+			instance.color[3] = 255;
+			groups[make_pair(&mesh, color_source)].push_back(instance);
+		}
 
-		void DrawPlane()
+		//a pose scaling the unit primitives into place
+		PxMat44 ScaledPose(const PxTransform& pose, const PxVec3& scale)
 		{
-			glScalef(10240,0,10240);
-			glEnableClientState(GL_VERTEX_ARRAY);
-			glEnableClientState(GL_NORMAL_ARRAY);
-			glVertexPointer(3, GL_FLOAT, 2*3*sizeof(float), gPlaneData);
-			glNormalPointer(GL_FLOAT, 2*3*sizeof(float), gPlaneData+3);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-			glDisableClientState(GL_VERTEX_ARRAY);
-			glDisableClientState(GL_NORMAL_ARRAY);
+			PxMat44 transform(pose);
+			transform.column0 = transform.column0 * scale.x;
+			transform.column1 = transform.column1 * scale.y;
+			transform.column2 = transform.column2 * scale.z;
+			return transform;
 		}
 
-		void DrawSphere(const PxGeometryHolder& geometry)
+		void AddSphere(InstanceGroups& groups, const PxGeometryHolder& geometry, const PxTransform& pose, const PxVec3& color)
 		{
-			glutSolidSphere(geometry.sphere().radius, render_detail, render_detail);
+			const PxF32 radius = geometry.sphere().radius;
+			AddInstance(groups, GetPrimitiveMesh(PrimitiveType::SPHERE, SelectLod(radius, pose.p)), InstanceColor::INSTANCE, ScaledPose(pose, PxVec3(radius)), color);
 		}
 
-		void DrawBox(const PxGeometryHolder& geometry)
+		void AddBox(InstanceGroups& groups, const PxGeometryHolder& geometry, const PxTransform& pose, const PxVec3& color)
 		{
-			PxVec3 half_size = geometry.box().halfExtents;
-			glScalef(half_size.x, half_size.y, half_size.z);
-			glutSolidCube(2.f);		
+			AddInstance(groups, GetPrimitiveMesh(PrimitiveType::BOX, 0), InstanceColor::INSTANCE, ScaledPose(pose, geometry.box().halfExtents), color);
 		}
 
-		void DrawCapsule(const PxGeometryHolder& geometry)
+		void AddCapsule(InstanceGroups& groups, const PxGeometryHolder& geometry, const PxTransform& pose, const PxVec3& color)
 		{
 			const PxF32 radius = geometry.capsule().radius;
 			const PxF32 halfHeight = geometry.capsule().halfHeight;
+			const PxU32 lod = SelectLod(radius, pose.p);
 
-			//Sphere
-			glPushMatrix();
-			glTranslatef(halfHeight,0.f, 0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
-			glPopMatrix();
-
-			//Sphere
-			glPushMatrix();
-			glTranslatef(-halfHeight,0.f,0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
-			glPopMatrix();
+			//Caps, the second one turned around to face -x
+			const RenderMesh& cap = GetPrimitiveMesh(PrimitiveType::HEMISPHERE, lod);
+			AddInstance(groups, cap, InstanceColor::INSTANCE, ScaledPose(pose * PxTransform(PxVec3(halfHeight, 0.f, 0.f)), PxVec3(radius)), color);
+			AddInstance(groups, cap, InstanceColor::INSTANCE, ScaledPose(pose * PxTransform(PxVec3(-halfHeight, 0.f, 0.f), PxQuat(PxPi, PxVec3(0.f, 1.f, 0.f))), PxVec3(radius)), color);
 
 			//Cylinder
-			glPushMatrix();
-			glTranslatef(-halfHeight,0.f,0.f);
-			glRotatef(90.f,0.f,1.f,0.f);
-
-			GLUquadric* qobj = gluNewQuadric();
-			gluQuadricNormals(qobj, GLU_SMOOTH);
-			gluCylinder(qobj, radius, radius, halfHeight*2.f, render_detail, render_detail);
-			gluDeleteQuadric(qobj);
-			glPopMatrix();
+			AddInstance(groups, GetPrimitiveMesh(PrimitiveType::CYLINDER, lod), InstanceColor::INSTANCE, ScaledPose(pose, PxVec3(halfHeight, radius, radius)), color);
 		}
 
-		void DrawConvexMesh(const PxGeometryHolder& geometry)
+		void AddConvexMesh(InstanceGroups& groups, const PxGeometryHolder& geometry, const PxTransform& pose, const PxVec3& color)
 		{
-			PxConvexMesh* mesh = geometry.convexMesh().convexMesh;
-			PxU32 num_polys = mesh->getNbPolygons();
-			const PxVec3* verts = mesh->getVertices();
-			const PxU8* indicies = mesh->getIndexBuffer();
-
-			for (PxU32 i = 0; i < num_polys; i++)
-			{
-				PxHullPolygon face;
-				if (mesh->getPolygonData(i,face))
-				{
-					glBegin(GL_POLYGON);
-					glNormal3f(face.mPlane[0],face.mPlane[1],face.mPlane[2]);
-					const PxU8* faceIdx = indicies + face.mIndexBase;
-					for (PxU32 j = 0; j < face.mNbVerts; j++)
-					{
-						PxVec3 v = verts[faceIdx[j]];
-						glVertex3f(v.x,v.y,v.z);
-					}
-					glEnd();
-				}
-			}
+			//triangulated once, see RenderCache
+			AddInstance(groups, GetRenderMesh(geometry.convexMesh().convexMesh), InstanceColor::INSTANCE, PxMat44(pose), color);
 		}
 
-		void DrawTriangleMesh(const PxGeometryHolder& geometry)
+		void AddTriangleMesh(InstanceGroups& groups, const PxTriangleMesh* mesh, const PxTransform& pose, const PxVec3& color, const PxVec3* material_colors=0)
 		{
-			PxTriangleMesh* mesh = geometry.triangleMesh().triangleMesh;
-			const PxVec3* verts = mesh->getVertices();
-			PxU16* trigs = (PxU16*)mesh->getTriangles();
-			const PxU32 num_trigs = mesh->getNbTriangles();
+			//uploaded on the first draw, see RenderCache
+			AddInstance(groups, GetRenderMesh(mesh, material_colors), material_colors ? InstanceColor::VERTEX : InstanceColor::INSTANCE, PxMat44(pose), color);
+		}
 
-			for (PxU32 i = 0; i < num_trigs*3; i+=3)
-			{
-				PxVec3 v0 = verts[trigs[i]];
-				PxVec3 v1 = verts[trigs[i+1]];
-				PxVec3 v2 = verts[trigs[i+2]];
-				PxVec3 n = (v1-v0).cross(v2-v0);
-				n.normalize();
-				glBegin(GL_POLYGON);
-				glNormal3f(n.x, n.y, n.z);
-				glVertex3f(v0.x, v0.y, v0.z);
-				glVertex3f(v1.x, v1.y, v1.z);
-				glVertex3f(v2.x, v2.y, v2.z);
-				glEnd();
-			}
+		void AddModel(InstanceGroups& groups, const shared_ptr<const PhysicsEngine::Model>& model, const PxTransform& pose, const PxVec3& color, const PxVec3* material_colors=0)
+		{
+			//uploaded on the first draw, see RenderCache, models without materials take the shape color
+			const RenderMesh& mesh = GetRenderMesh(model, material_colors);
+			AddInstance(groups, mesh, mesh.has_colors ? InstanceColor::VERTEX : InstanceColor::INSTANCE, PxMat44(pose), color);
 		}
 
-		void DrawHeightField(const PxGeometryHolder& geometry)
+		void AddHeightField(InstanceGroups& groups, const PxGeometryHolder& geometry, const PxTransform& pose, const PxVec3& color)
 		{
 			//TODO
 		}
 
-		void RenderGeometry(const PxGeometryHolder& geometry)
+		void AddGeometry(InstanceGroups& groups, const RenderSnapshot& snapshot, const SnapshotShape& shape, const PxVec3& color)
 		{
+			const PxGeometryHolder& geometry = shape.geometry;
+			const PxTransform& pose = shape.pose;
+			const PxVec3* material_colors = (shape.material_colors != (PxU32)-1) ? &snapshot.material_colors[shape.material_colors] : 0;
 			switch(geometry.getType())
 			{
-			case PxGeometryType::ePLANE:
-				DrawPlane();
-				break;
 			case PxGeometryType::eSPHERE:
-				DrawSphere(geometry);
+				AddSphere(groups, geometry, pose, color);
 				break;
-			case PxGeometryType::eBOX:			
-				DrawBox(geometry);
+			case PxGeometryType::eBOX:
+				AddBox(groups, geometry, pose, color);
 				break;
 			case PxGeometryType::eCAPSULE:
-				DrawCapsule(geometry);
+				AddCapsule(groups, geometry, pose, color);
 				break;
 			case PxGeometryType::eCONVEXMESH:
-				DrawConvexMesh(geometry);
+				AddConvexMesh(groups, geometry, pose, color);
 				break;
 			case PxGeometryType::eTRIANGLEMESH:
-				DrawTriangleMesh(geometry);
+				//a simplified collision mesh is drawn with its full detail model
+				if (shape.render_model)
+					AddModel(groups, shape.render_model, pose, color, material_colors);
+				else
+					AddTriangleMesh(groups, geometry.triangleMesh().triangleMesh, pose, color, material_colors);
 				break;
 			case PxGeometryType::eHEIGHTFIELD:
-				DrawHeightField(geometry);
+				AddHeightField(groups, geometry, pose, color);
 				break;
 			default:
 				break;
 			}
 		}
 
+		void AddPlane(InstanceGroups& groups, const PxTransform& pose, const PxVec3& color)
+		{
+			//a large square turned to face the plane normal, moved slightly down to avoid visual artefacts
+			PxTransform square_pose = pose;
+			square_pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
+			square_pose.p += PxVec3(0.f, -0.01f, 0.f);
+			AddInstance(groups, GetPrimitiveMesh(PrimitiveType::PLANE, 0), InstanceColor::INSTANCE, ScaledPose(square_pose, PxVec3(10240.f, 1.f, 10240.f)), color);
+		}
+
+		//one draw per group, the shadow passes draw everything in the current color
+		void DrawInstanceGroups(const InstanceGroups& groups, bool current_color)
+		{
+			for (InstanceGroups::const_iterator it = groups.begin(); it != groups.end(); it++)
+			{
+				if (!it->second.empty())
+					DrawInstances(*it->first.first, &it->second.front(), (PxU32)it->second.size(), current_color ? InstanceColor::CURRENT : it->first.second);
+			}
+		}
+
+		//keep the instance arrays of the groups drawn this frame, the others belong to meshes which went away
+		void ClearInstanceGroups(InstanceGroups& groups)
+		{
+			for (InstanceGroups::iterator it = groups.begin(); it != groups.end();)
+			{
+				if (it->second.empty())
+				{
+					it = groups.erase(it);
+					continue;
+				}
+				it->second.clear();
+				it++;
+			}
+		}
+
+		//shapes released since the last frame, a new shape can take the address of a released static caster
+		static ReleaseListener shape_release_listener;
+
+		//shapes tested against the view frustum, with their bounds in the same order
+		static vector<const SnapshotShape*> cull_shapes;
+		static BoundsBatch cull_bounds;
+		static vector<PxU8> cull_visible;
+		//the same shapes with their flattened shadows, which can be in the view while the shape is not
+		static BoundsBatch planar_shadow_bounds;
+		static vector<PxU8> planar_shadow_visible;
+
+		//shadow casters of the current frame, static ones with their bounds and the order independent sum of their hashes
+		static vector<const SnapshotShape*> static_shapes;
+		static vector<const SnapshotShape*> dynamic_shapes;
+		static PxBounds3 static_bounds = PxBounds3::empty();
+		static PxU64 static_signature = 0;
+		//the static shadow map holds the casters with this signature, until one of them is released
+		static PxU64 static_map_signature = 0;
+		static bool static_map_valid = false;
+		bool use_shadow_maps = false;
+
+		void FlushReleasedShapes()
+		{
+			vector<const PxBase*> released;
+			shape_release_listener.Take(released);
+			//a new shape can take the address of a released one without changing the signature
+			if (!released.empty())
+				static_map_valid = false;
+		}
+
+		//the bounds of a shape together with its shadow flattened onto the ground along the light
+		PxBounds3 PlanarShadowBounds(const PxBounds3& bounds)
+		{
+			const PxReal slope_x = shadow_direction.x / shadow_direction.y;
+			const PxReal slope_z = shadow_direction.z / shadow_direction.y;
+			const PxReal low = bounds.minimum.y, high = bounds.maximum.y;
+
+			PxBounds3 shadow_bounds = bounds;
+			shadow_bounds.include(PxVec3(bounds.minimum.x - PxMax(slope_x*low, slope_x*high), 0, bounds.minimum.z - PxMax(slope_z*low, slope_z*high)));
+			shadow_bounds.include(PxVec3(bounds.maximum.x - PxMin(slope_x*low, slope_x*high), 0, bounds.maximum.z - PxMin(slope_z*low, slope_z*high)));
+			return shadow_bounds;
+		}
+
+		void AddShadowCaster(const SnapshotShape& caster)
+		{
+			if (!caster.is_static)
+			{
+				dynamic_shapes.push_back(&caster);
+				return;
+			}
+			static_shapes.push_back(&caster);
+			static_bounds.include(caster.bounds);
+			static_signature += ((PxU64)(size_t)caster.shape ^ 0x9E3779B97F4A7C15ULL) * 0xBF58476D1CE4E5B9ULL;
+		}
+
+		void AddShadowCasters(InstanceGroups& groups, const RenderSnapshot& snapshot, vector<const SnapshotShape*>& casters)
+		{
+			for (PxU32 i = 0; i < casters.size(); i++)
+				AddGeometry(groups, snapshot, *casters[i], default_color);
+			casters.clear();
+		}
+
+		//draw the depth of the casters from the light, the static casters only when they or the light changed
+		bool DrawShadowMaps(const RenderSnapshot& snapshot)
+		{
+			bool drawn = !static_bounds.isEmpty();
+			if (drawn)
+			{
+				bool light_moved = SetShadowLight(shadow_direction, static_bounds);
+				if (light_moved || !static_map_valid || (static_signature != static_map_signature))
+				{
+					AddShadowCasters(static_casters, snapshot, static_shapes);
+					BeginShadowMap(ShadowLayer::STATIC);
+					DrawInstanceGroups(static_casters, true);
+					EndShadowMap();
+					ClearInstanceGroups(static_casters);
+					static_map_signature = static_signature;
+					static_map_valid = true;
+				}
+
+				AddShadowCasters(dynamic_casters, snapshot, dynamic_shapes);
+				BeginShadowMap(ShadowLayer::DYNAMIC);
+				DrawInstanceGroups(dynamic_casters, true);
+				EndShadowMap();
+				ClearInstanceGroups(dynamic_casters);
+			}
+
+			static_shapes.clear();
+			dynamic_shapes.clear();
+			static_bounds = PxBounds3::empty();
+			static_signature = 0;
+			return drawn;
+		}
+
 		void RenderCloth(const PxCloth* cloth)
 		{
 			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
@@ -220,18 +359,19 @@ namespace VisualDebugger
 		void reshapeCallback(int width, int height)
 		{
 			glViewport(0, 0, width, height);
+			window_width = PxMax(width, 1);
+			window_height = PxMax(height, 1);
 		}
 
 		void idleCallback()
 		{
-			glClearColor(background_color.x, background_color.y, background_color.z, 1.f);
 			glutPostRedisplay();
 		}
 
 		void InitWindow(const char *name, int width, int height)
 		{
 			char* namestr = new char[strlen(name)+1];
-			strcpy_s(namestr, strlen(name)+1, name);
+			memcpy(namestr, name, strlen(name)+1);
 			int argc = 1;
 			char* argv[1] = { namestr };
 
@@ -242,10 +382,22 @@ namespace VisualDebugger
 			glutSetWindow(glutCreateWindow(name));
 			glutReshapeFunc(reshapeCallback);
 			glutIdleFunc(idleCallback);
+			window_width = width;
+			window_height = height;
 
 			delete[] namestr;
 		}
 
+		bool InitHeadless(int width, int height)
+		{
+			if (!CreateHeadlessContext(width, height))
+				return false;
+
+			headless = true;
+			reshapeCallback(width, height);
+			return true;
+		}
+
 		void Init()
 		{
 			// Setup default render states
@@ -265,16 +417,36 @@ namespace VisualDebugger
 			glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseColor);
 			glLightfv(GL_LIGHT0, GL_POSITION, position);
 			glEnable(GL_LIGHT0);
+
+			//the unit primitives are scaled into place
+			glEnable(GL_NORMALIZE);
+
+			LoadGLExtensions();
+			InitRenderCache();
+			InitInstancing();
+			shape_release_listener.Register();
+
+			//the shadow maps are sampled by the instancing shader, otherwise the shadows are projected onto the ground
+			use_shadow_maps = InstancedDraws() && InitShadowMaps(2048);
 		}
 
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir)
 		{
+			glClearColor(background_color.x, background_color.y, background_color.z, 1.f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+			//drop the buffers of the meshes released since the last frame
+			FlushRenderCache();
+			FlushReleasedShapes();
+
 			// Setup camera
 			glMatrixMode(GL_PROJECTION);
 			glLoadIdentity();
-			gluPerspective(60.f, (float)glutGet(GLUT_WINDOW_WIDTH)/(float)glutGet(GLUT_WINDOW_HEIGHT), 1.f, 10000.f);
+			const PxReal aspect = (float)window_width/(float)window_height;
+			gluPerspective(60.f, aspect, 1.f, 10000.f);
+			camera_eye = cameraEye;
+			view_frustum = Frustum::Perspective(cameraEye, cameraDir, PxVec3(0.f, 1.f, 0.f), PxPi / 3.f, aspect, 1.f, 10000.f);
+			lod_scale = (float)window_height / (2.f * PxTan(PxPi / 6.f));
 
 			glMatrixMode(GL_MODELVIEW);
 			glLoadIdentity();
@@ -286,9 +458,11 @@ namespace VisualDebugger
 			background_color = color;
 		}
 
+		//the actors drawn directly, kept between frames for its storage
+		static RenderSnapshot actor_snapshot;
+
 		void Render(PxActor** actors, const PxU32 numActors)
 		{
-			PxVec3 shadow_color = default_color*0.9;
 			for(PxU32 i=0;i<numActors;i++) {
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
 				if (actors[i]->isCloth()) {
@@ -297,82 +471,140 @@ namespace VisualDebugger
 #endif
 					RenderCloth((PxCloth*)actors[i]);
 				}
-#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
-				else if (actors[i]->isRigidActor()) {
-#else
-				else if (actors[i]->is<PxRigidActor>()) {
-#endif
-					PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
-					std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
-					rigid_actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
-
-					for(PxU32 j = 0; j < shapes.size(); j++)
-					{
-						const PxShape* shape = shapes[j];
-						PxTransform pose = PxShapeExt::getGlobalPose(*shape, *shape->getActor());
-						PxGeometryHolder h = shape->getGeometry();
-						//move the plane slightly down to avoid visual artefacts
-						if (h.getType() == PxGeometryType::ePLANE)
-						{
-							pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
-							pose.p += PxVec3(0,-0.01,0);
-						}
-
-						PxMat44 shapePose(pose);
-						// render object
-						glPushMatrix();						
-						glMultMatrixf((float*)&shapePose);
-
-						PxVec3 shape_color = default_color;
-
-						if (shape->userData)
-						{
-							shape_color = *(((UserData*)shape->userData)->color);
-							if (h.getType() == PxGeometryType::ePLANE)
-							{
-								shadow_color = shape_color*0.9;
-							}
-						}
-
-						if (h.getType() == PxGeometryType::ePLANE)
-							glDisable(GL_LIGHTING);
-
-						glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
-
-						RenderGeometry(h);
-
-						if (h.getType() == PxGeometryType::ePLANE)
-							glEnable(GL_LIGHTING);
-
-						glPopMatrix();
-
-						if(show_shadows && (h.getType() != PxGeometryType::ePLANE))
-						{
-							const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
-							const PxReal shadowMat[]={ 1,0,0,0, -shadowDir.x/shadowDir.y,0,-shadowDir.z/shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
-							glPushMatrix();						
-							glMultMatrixf(shadowMat);
-							glMultMatrixf((float*)&shapePose);
-							glDisable(GL_LIGHTING);
-							glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
-							RenderGeometry(h);
-							glEnable(GL_LIGHTING);
-							glPopMatrix();
-						}
-					}
+			}
+
+			actor_snapshot.Take(actors, numActors);
+			Render(actor_snapshot);
+			//the references would outlive the scene otherwise
+			actor_snapshot.Clear();
+		}
+
+		void Render(const RenderSnapshot& snapshot)
+		{
+			PxVec3 shadow_color = default_color*0.9;
+			bool shadow_maps = use_shadow_maps && show_shadows;
+			bool planar_shadows = !use_shadow_maps && show_shadows;
+			for (PxU32 i = 0; i < snapshot.shapes.size(); i++)
+			{
+				const SnapshotShape& shape = snapshot.shapes[i];
+				if (!shape.visible)
+					continue;
+
+				//the other shapes are culled against the view and drawn in groups sharing their geometry below
+				if (shape.geometry.getType() != PxGeometryType::ePLANE)
+				{
+					cull_shapes.push_back(&shape);
+					cull_bounds.Add(shape.bounds);
+					//shapes outside of the view still cast shadows into it
+					if (shadow_maps)
+						AddShadowCaster(shape);
+					else if (planar_shadows)
+						planar_shadow_bounds.Add(PlanarShadowBounds(shape.bounds));
+					continue;
 				}
 
+				shadow_color = shape.color*0.9;
+
+				//planes are unbounded and always drawn
+				AddPlane(plane_groups, shape.pose, shape.color);
 			}
+
+			if (shadow_maps)
+				shadow_maps = DrawShadowMaps(snapshot);
+			else
+				static_map_valid = false;
+
+			cull_bounds.Test(view_frustum, cull_visible);
+			PxU32 drawn = 0;
+			for (PxU32 i = 0; i < cull_shapes.size(); i++)
+			{
+				if (!cull_visible[i])
+					continue;
+				AddGeometry(instance_groups, snapshot, *cull_shapes[i], cull_shapes[i]->color);
+				drawn++;
+			}
+			drawn_shapes = drawn;
+			culled_shapes = (PxU32)cull_shapes.size() - drawn;
+
+			if (planar_shadows)
+			{
+				planar_shadow_bounds.Test(view_frustum, planar_shadow_visible);
+				for (PxU32 i = 0; i < cull_shapes.size(); i++)
+				{
+					if (planar_shadow_visible[i])
+						AddGeometry(planar_casters, snapshot, *cull_shapes[i], default_color);
+				}
+				planar_shadow_bounds.Clear();
+			}
+
+			cull_shapes.clear();
+			cull_bounds.Clear();
+
+			//draw calls scale with the number of distinct meshes, not with the number of shapes
+			ReceiveShadows(shadow_maps);
+			DrawInstanceGroups(instance_groups, false);
+			glDisable(GL_LIGHTING);
+			DrawInstanceGroups(plane_groups, false);
+			glEnable(GL_LIGHTING);
+			ReceiveShadows(false);
+
+			//without shadow maps the shapes with a shadow in the view are flattened onto the ground
+			if (planar_shadows)
+			{
+				const PxReal shadowMat[]={ 1,0,0,0, -shadow_direction.x/shadow_direction.y,0,-shadow_direction.z/shadow_direction.y,0, 0,0,1,0, 0,0,0,1 };
+				glPushMatrix();
+				glMultMatrixf(shadowMat);
+				glDisable(GL_LIGHTING);
+				glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
+				DrawInstanceGroups(planar_casters, true);
+				glEnable(GL_LIGHTING);
+				glPopMatrix();
+				ClearInstanceGroups(planar_casters);
+			}
+
+			ClearInstanceGroups(instance_groups);
+			ClearInstanceGroups(plane_groups);
 		}
 
 		void Finish()
 		{
-			glutSwapBuffers();
+			CaptureFrame(window_width, window_height);
+
+			//the offscreen surface has no front buffer to show
+			if (headless)
+				glFlush();
+			else
+				glutSwapBuffers();
+		}
+
+		void Finish(GLubyte* pixels)
+		{
+			//read before the swap, the back buffer is undefined after it
+			const size_t row_size = (size_t)window_width * 4;
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glReadPixels(0, 0, window_width, window_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+			//OpenGL reads from the bottom up
+			std::vector<GLubyte> row(row_size);
+			for (int top = 0, bottom = window_height - 1; top < bottom; top++, bottom--)
+			{
+				memcpy(&row.front(), pixels + top * row_size, row_size);
+				memcpy(pixels + top * row_size, pixels + bottom * row_size, row_size);
+				memcpy(pixels + bottom * row_size, &row.front(), row_size);
+			}
+
+			Finish();
+		}
+
+		void WindowSize(int& width, int& height)
+		{
+			width = window_width;
+			height = window_height;
 		}
 
 		void SetRenderDetail(int value)
 		{
-			render_detail = value;
+			SetPrimitiveDetail((PxU32)PxMax(value, 1));
 		}
 
 		void ShowShadows(bool value)
@@ -382,6 +614,10 @@ namespace VisualDebugger
 
 		bool ShowShadows() { return show_shadows; }
 
+		PxU32 DrawnShapes() { return drawn_shapes; }
+
+		PxU32 CulledShapes() { return culled_shapes; }
+
 		void RenderBuffer(float* pVertList, float* pColorList, int type, int num)
 		{
 			glEnableClientState(GL_VERTEX_ARRAY);
@@ -393,9 +629,10 @@ namespace VisualDebugger
 			glDisableClientState(GL_VERTEX_ARRAY);
 		}
 
-		///Render PxRenderBuffer
+		///Render PxRenderBuffer or a copy of one
 		///TODO: support text data
-		void Render(const PxRenderBuffer& data, PxReal line_width)
+		template<class DebugBuffer>
+		void RenderDebug(const DebugBuffer& data, PxReal line_width)
 		{
 			glLineWidth(line_width);
 
@@ -506,11 +743,21 @@ namespace VisualDebugger
 			//TODO: render texts ?
 		}
 
+		void Render(const PxRenderBuffer& data, PxReal line_width)
+		{
+			RenderDebug(data, line_width);
+		}
+
+		void Render(const DebugSnapshot& data, PxReal line_width)
+		{
+			RenderDebug(data, line_width);
+		}
+
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
 			const PxVec3& color, PxReal size)
 		{
 			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
-			GLFontRenderer::setScreenResolution(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+			GLFontRenderer::setScreenResolution(window_width, window_height);
 			GLFontRenderer::print(location.x, location.y, size, text.c_str());
 		}
 	}
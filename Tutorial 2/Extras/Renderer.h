@@ -2,6 +2,7 @@
 
 #include "PxPhysicsAPI.h"
 #include "GLFontRenderer.h"
+#include "RenderSnapshot.h"
 #include <GL/glut.h>
 #include <string>
 
@@ -14,6 +15,11 @@ namespace VisualDebugger
 		///Init rendering window
 		void InitWindow(const char *name, int width, int height);
 
+		///Init rendering into an offscreen surface of the given size instead of a window
+		///Needs no display server, returns false if the platform or driver can not render offscreen.
+		///Call it again to change the size of the surface.
+		bool InitHeadless(int width, int height);
+
 		///Init renderer
 		void Init();
 
@@ -23,9 +29,15 @@ namespace VisualDebugger
 		///Render actors
 		void Render(PxActor** actors, const PxU32 numActors);
 
+		///Render the actors of a snapshot, possibly taken on another thread (see RenderSnapshot)
+		void Render(const RenderSnapshot& snapshot);
+
 		///Render debug information
 		void Render(const PxRenderBuffer& data, PxReal line_width=1.f);
 
+		///Render debug information copied into a snapshot
+		void Render(const DebugSnapshot& data, PxReal line_width=1.f);
+
 		///Render text
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
 			const PxVec3& color, PxReal size);
@@ -36,7 +48,14 @@ namespace VisualDebugger
 		///Finish rendering a single frame
 		void Finish();
 
-		///Set rendering detail for spheres and capsules.
+		///Finish rendering a single frame and read it back
+		///pixels holds width * height RGBA pixels of the window or offscreen surface, the top row first.
+		void Finish(GLubyte* pixels);
+
+		///Get the size of the window or offscreen surface
+		void WindowSize(int& width, int& height);
+
+		///Set rendering detail for spheres and capsules, the segments of their closest level of detail.
 		void SetRenderDetail(int value);
 
 		///Set show shadows
@@ -44,5 +63,11 @@ namespace VisualDebugger
 
 		///Get show shadows
 		bool ShowShadows();
+
+		///Number of shapes drawn in the last frame
+		PxU32 DrawnShapes();
+
+		///Number of shapes outside the view in the last frame, planes are never culled
+		PxU32 CulledShapes();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "ShadowMap.h"
+#include <cstring>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExt;
+
+		static PxU32 shadow_map_size = 0;
+		static GLuint shadow_textures[ShadowLayer::COUNT] = { 0, 0 };
+		static GLuint shadow_framebuffers[ShadowLayer::COUNT] = { 0, 0 };
+		//view and projection of the light for drawing the casters, and the same mapped to texture coordinates for sampling
+		static PxMat44 light_matrix(PxIdentity);
+		static PxMat44 shadow_matrix(PxIdentity);
+		static GLint window_viewport[4];
+
+		bool InitShadowMaps(PxU32 size)
+		{
+			if (!DepthTexturesSupported())
+				return false;
+
+			glGenTextures(ShadowLayer::COUNT, shadow_textures);
+			GenFramebuffers(ShadowLayer::COUNT, shadow_framebuffers);
+
+			bool complete = true;
+			const GLfloat border[] = { 1.f, 1.f, 1.f, 1.f };
+			for (PxU32 i = 0; i < ShadowLayer::COUNT; i++)
+			{
+				glBindTexture(GL_TEXTURE_2D, shadow_textures[i]);
+				glTexImage2D(GL_TEXTURE_2D, 0, DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
+				//most drivers filter the comparisons of neighbouring texels, softening the edges
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				//everything outside of the map is lit
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, CLAMP_TO_BORDER);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, CLAMP_TO_BORDER);
+				glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+				glTexParameteri(GL_TEXTURE_2D, TEXTURE_COMPARE_MODE, COMPARE_REF_TO_TEXTURE);
+				glTexParameteri(GL_TEXTURE_2D, TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+				BindFramebuffer(FRAMEBUFFER, shadow_framebuffers[i]);
+				FramebufferTexture2D(FRAMEBUFFER, DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadow_textures[i], 0);
+				glDrawBuffer(GL_NONE);
+				glReadBuffer(GL_NONE);
+				complete = complete && (CheckFramebufferStatus(FRAMEBUFFER) == FRAMEBUFFER_COMPLETE);
+				glClear(GL_DEPTH_BUFFER_BIT);
+			}
+			BindFramebuffer(FRAMEBUFFER, 0);
+			glBindTexture(GL_TEXTURE_2D, 0);
+
+			if (!complete)
+			{
+				DeleteFramebuffers(ShadowLayer::COUNT, shadow_framebuffers);
+				glDeleteTextures(ShadowLayer::COUNT, shadow_textures);
+				memset(shadow_framebuffers, 0, sizeof(shadow_framebuffers));
+				memset(shadow_textures, 0, sizeof(shadow_textures));
+				return false;
+			}
+
+			shadow_map_size = size;
+			return true;
+		}
+
+		bool ShadowMapsReady()
+		{
+			return shadow_map_size != 0;
+		}
+
+		bool SetShadowLight(const PxVec3& direction, const PxBounds3& bounds)
+		{
+			//light space with z pointing towards the light
+			PxVec3 z = -direction.getNormalized();
+			PxVec3 x = ((PxAbs(z.y) < .99f) ? PxVec3(0.f, 1.f, 0.f) : PxVec3(1.f, 0.f, 0.f)).cross(z).getNormalized();
+			PxVec3 y = z.cross(x);
+
+			PxVec3 minimum(PX_MAX_F32), maximum(-PX_MAX_F32);
+			for (PxU32 i = 0; i < 8; i++)
+			{
+				PxVec3 corner((i & 1) ? bounds.maximum.x : bounds.minimum.x, (i & 2) ? bounds.maximum.y : bounds.minimum.y, (i & 4) ? bounds.maximum.z : bounds.minimum.z);
+				PxVec3 p(x.dot(corner), y.dot(corner), z.dot(corner));
+				minimum = minimum.minimum(p);
+				maximum = maximum.maximum(p);
+			}
+			//room between the light and the bounds for the moving casters above them
+			maximum.z += (bounds.maximum - bounds.minimum).magnitude();
+			PxVec3 size = (maximum - minimum).maximum(PxVec3(1e-3f));
+
+			//orthographic projection of the light space box, the side closest to the light at depth -1
+			PxVec3 scale(2.f / size.x, 2.f / size.y, -2.f / size.z);
+			PxVec3 offset(-minimum.x * scale.x - 1.f, -minimum.y * scale.y - 1.f, -maximum.z * scale.z - 1.f);
+			PxMat44 matrix(PxVec4(x.x * scale.x, y.x * scale.y, z.x * scale.z, 0.f),
+				PxVec4(x.y * scale.x, y.y * scale.y, z.y * scale.z, 0.f),
+				PxVec4(x.z * scale.x, y.z * scale.y, z.z * scale.z, 0.f),
+				PxVec4(offset, 1.f));
+
+			if (!memcmp(&matrix, &light_matrix, sizeof(PxMat44)))
+				return false;
+
+			light_matrix = matrix;
+			const PxMat44 bias(PxVec4(.5f, 0.f, 0.f, 0.f), PxVec4(0.f, .5f, 0.f, 0.f), PxVec4(0.f, 0.f, .5f, 0.f), PxVec4(.5f, .5f, .5f, 1.f));
+			shadow_matrix = bias * light_matrix;
+			return true;
+		}
+
+		void BeginShadowMap(ShadowLayer::Enum layer)
+		{
+			glGetIntegerv(GL_VIEWPORT, window_viewport);
+			BindFramebuffer(FRAMEBUFFER, shadow_framebuffers[layer]);
+			glViewport(0, 0, shadow_map_size, shadow_map_size);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+			//push the casters back a little so surfaces do not shadow themselves
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(2.f, 4.f);
+
+			glMatrixMode(GL_PROJECTION);
+			glPushMatrix();
+			glLoadMatrixf(light_matrix.front());
+			glMatrixMode(GL_MODELVIEW);
+			glPushMatrix();
+			glLoadIdentity();
+		}
+
+		void EndShadowMap()
+		{
+			glMatrixMode(GL_PROJECTION);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+			glPopMatrix();
+
+			glDisable(GL_POLYGON_OFFSET_FILL);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			BindFramebuffer(FRAMEBUFFER, 0);
+			glViewport(window_viewport[0], window_viewport[1], window_viewport[2], window_viewport[3]);
+		}
+
+		GLuint ShadowTexture(ShadowLayer::Enum layer)
+		{
+			return shadow_textures[layer];
+		}
+
+		const PxMat44& ShadowMatrix()
+		{
+			return shadow_matrix;
+		}
+	}
+}
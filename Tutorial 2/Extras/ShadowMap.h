@@ -0,0 +1,48 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "GLExtensions.h"
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///Depth maps of the shadow casters seen from a directional light
+		///The static casters are drawn into their own map, which is kept until the light or the casters change,
+		///and the moving casters into a second map every frame. A point is lit when it is in front of both.
+		struct ShadowLayer
+		{
+			enum Enum
+			{
+				STATIC,
+				DYNAMIC,
+				COUNT
+			};
+		};
+
+		///Create the depth textures and their framebuffers, call after LoadGLExtensions
+		///Returns false when the driver can not render into depth textures.
+		bool InitShadowMaps(PxU32 size);
+
+		///Were the shadow maps created?
+		bool ShadowMapsReady();
+
+		///Fit the view of a light shining along direction around bounds
+		///Returns true if the view changed, the static casters have to be drawn again then.
+		bool SetShadowLight(const PxVec3& direction, const PxBounds3& bounds);
+
+		///Draw into the depth map of a layer as seen from the light, only depth is written until EndShadowMap
+		void BeginShadowMap(ShadowLayer::Enum layer);
+
+		///Go back to drawing into the window
+		void EndShadowMap();
+
+		///Depth texture of a layer
+		GLuint ShadowTexture(ShadowLayer::Enum layer);
+
+		///World to shadow map transform, x and y are texture coordinates and z the depth from 0 to 1
+		const PxMat44& ShadowMatrix();
+	}
+}
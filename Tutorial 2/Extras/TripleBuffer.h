@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+
+namespace VisualDebugger
+{
+	///Passes the latest of a stream of values from one producer thread to one consumer thread without locks
+	///The producer fills Back() and publishes it, the consumer picks up the latest published value with Acquire
+	///and reads it through Front(). Neither thread ever waits for the other, values published faster
+	///than the consumer acquires them are overwritten unseen.
+	template<class T>
+	class TripleBuffer
+	{
+		//set on the shared index while it holds a value the consumer has not acquired
+		static const unsigned int FRESH = 4;
+
+		T buffers[3];
+		//the buffer between the two threads, swapped with the producer's back or the consumer's front
+		std::atomic<unsigned int> middle;
+		unsigned int back;
+		unsigned int front;
+
+		TripleBuffer(const TripleBuffer&);
+		TripleBuffer& operator=(const TripleBuffer&);
+
+	public:
+		TripleBuffer() : middle(1), back(0), front(2) {}
+
+		///The value being filled by the producer
+		T& Back()
+		{
+			return buffers[back];
+		}
+
+		///Hand the back value to the consumer and get the one it left in exchange
+		void Publish()
+		{
+			back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+		}
+
+		///Swap in the latest published value, returns false if nothing was published since the last call
+		bool Acquire()
+		{
+			if (!(middle.load(std::memory_order_relaxed) & FRESH))
+				return false;
+			front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+			return true;
+		}
+
+		///The value read by the consumer
+		T& Front()
+		{
+			return buffers[front];
+		}
+
+		///All three values, only safe while neither thread uses the buffer
+		T& operator[](unsigned int index)
+		{
+			return buffers[index];
+		}
+	};
+}
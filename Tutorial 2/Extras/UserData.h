@@ -1,6 +1,12 @@
 #pragma once
 
 #include "PxPhysicsAPI.h"
+#include <memory>
+
+namespace PhysicsEngine
+{
+	class Model;
+}
 
 //add here any other structures that you want to pass from your simulation to the renderer
 class UserData
@@ -8,7 +14,13 @@ class UserData
 public:
 	physx::PxVec3* color;
 	physx::PxClothMeshDesc* cloth_mesh_desc;
+	//full detail model drawn instead of a simplified collision mesh, shared with the render snapshots
+	std::shared_ptr<const PhysicsEngine::Model> render_model;
+	//colors indexed by the triangle material indices of a mesh with a material table
+	physx::PxVec3* material_colors;
+	physx::PxU32 material_count;
 
-	UserData(physx::PxVec3* _color=0, physx::PxClothMeshDesc* _cloth_mesh_desc=0) :
-		color(_color), cloth_mesh_desc(_cloth_mesh_desc) {}
+	UserData(physx::PxVec3* _color=0, physx::PxClothMeshDesc* _cloth_mesh_desc=0, physx::PxVec3* _material_colors=0,
+		physx::PxU32 _material_count=0) :
+		color(_color), cloth_mesh_desc(_cloth_mesh_desc), material_colors(_material_colors), material_count(_material_count) {}
 };
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "FileIO.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///MappedFile methods
+
+#ifdef _WIN32
+	MappedFile::MappedFile()
+		: data(0), size(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(0)
+	{
+	}
+#else
+	MappedFile::MappedFile()
+		: data(0), size(0), file_handle(-1)
+	{
+	}
+#endif
+
+	MappedFile::MappedFile(const string& path)
+		: MappedFile()
+	{
+		Open(path);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::Open(const string& path)
+	{
+		Close();
+
+		file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+		if (file_handle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER file_size;
+		//empty files cannot be mapped
+		if (!GetFileSizeEx(file_handle, &file_size) || (file_size.QuadPart == 0))
+		{
+			Close();
+			return false;
+		}
+
+		mapping_handle = CreateFileMappingA(file_handle, 0, PAGE_READONLY, 0, 0, 0);
+		if (!mapping_handle)
+		{
+			Close();
+			return false;
+		}
+
+		data = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+		if (!data)
+		{
+			Close();
+			return false;
+		}
+
+		size = (size_t)file_size.QuadPart;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping_handle)
+			CloseHandle(mapping_handle);
+		if (file_handle != INVALID_HANDLE_VALUE)
+			CloseHandle(file_handle);
+
+		data = 0;
+		size = 0;
+		mapping_handle = 0;
+		file_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	bool MappedFile::Open(const string& path)
+	{
+		Close();
+
+		file_handle = open(path.c_str(), O_RDONLY);
+		if (file_handle < 0)
+			return false;
+
+		struct stat file_stat;
+		//empty files cannot be mapped
+		if ((fstat(file_handle, &file_stat) != 0) || (file_stat.st_size == 0))
+		{
+			Close();
+			return false;
+		}
+
+		void* mapping = mmap(0, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file_handle, 0);
+		if (mapping == MAP_FAILED)
+		{
+			Close();
+			return false;
+		}
+
+		data = mapping;
+		size = (size_t)file_stat.st_size;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (data)
+			munmap((void*)data, size);
+		if (file_handle >= 0)
+			close(file_handle);
+
+		data = 0;
+		size = 0;
+		file_handle = -1;
+	}
+#endif
+
+	///File functions
+
+	bool FileExists(const string& path)
+	{
+#ifdef _WIN32
+		DWORD attributes = GetFileAttributesA(path.c_str());
+		return (attributes != INVALID_FILE_ATTRIBUTES) && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+		struct stat file_stat;
+		return (stat(path.c_str(), &file_stat) == 0) && S_ISREG(file_stat.st_mode);
+#endif
+	}
+
+	bool CreateDirectories(const string& path)
+	{
+		//create every directory along the path, existing ones are skipped
+		for (size_t i = 1; i <= path.size(); i++)
+		{
+			if ((i < path.size()) && (path[i] != '/') && (path[i] != '\\'))
+				continue;
+
+			string directory = path.substr(0, i);
+			if (directory.empty() || (directory == ".") || (directory == ".."))
+				continue;
+#ifdef _WIN32
+			if (!CreateDirectoryA(directory.c_str(), 0) && (GetLastError() != ERROR_ALREADY_EXISTS))
+				return false;
+#else
+			if ((mkdir(directory.c_str(), 0755) != 0) && (errno != EEXIST))
+				return false;
+#endif
+		}
+		return true;
+	}
+
+	bool WriteFileAtomic(const string& path, const void* data, size_t size)
+	{
+		//unique per thread so that concurrent writers never share a temporary file
+		stringstream temp_path;
+		temp_path << path << "." << hash<thread::id>()(this_thread::get_id()) << ".tmp";
+
+		{
+			ofstream out(temp_path.str().c_str(), ios::out | ios::binary | ios::trunc);
+			if (!out)
+				return false;
+
+			out.write((const char*)data, size);
+			out.close();
+			if (!out)
+			{
+				remove(temp_path.str().c_str());
+				return false;
+			}
+		}
+
+#ifdef _WIN32
+		if (!MoveFileExA(temp_path.str().c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+#else
+		if (rename(temp_path.str().c_str(), path.c_str()) != 0)
+#endif
+		{
+			remove(temp_path.str().c_str());
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace PhysicsEngine
+{
+	///Read-only memory-mapped file
+	class MappedFile
+	{
+		const void* data;
+		size_t size;
+#ifdef _WIN32
+		void* file_handle;
+		void* mapping_handle;
+#else
+		int file_handle;
+#endif
+
+		//non-copyable, the mapping is owned by a single object
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+	public:
+		MappedFile();
+
+		///Map the whole file into memory, returns false if it cannot be opened
+		explicit MappedFile(const std::string& path);
+
+		~MappedFile();
+
+		///Map the whole file into memory, returns false if it cannot be opened
+		bool Open(const std::string& path);
+
+		///Unmap the file
+		void Close();
+
+		///Is a file mapped?
+		bool IsOpen() const { return data != 0; }
+
+		///Pointer to the first byte of the file
+		const void* Data() const { return data; }
+
+		///Size of the file in bytes
+		size_t Size() const { return size; }
+	};
+
+	///Check if a file exists
+	bool FileExists(const std::string& path);
+
+	///Create a directory and any missing parent directories
+	bool CreateDirectories(const std::string& path);
+
+	///Write a file so that readers either see the old content or the complete new one
+	///(the data goes to a temporary file first which is then renamed over the target)
+	bool WriteFileAtomic(const std::string& path, const void* data, size_t size);
+}
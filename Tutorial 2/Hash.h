@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <cstdio>
+#include "PxPhysicsAPI.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///64-bit FNV-1a hash used to build content keys (cache entries, asset files)
+	class Hasher
+	{
+		PxU64 value;
+
+	public:
+		Hasher() : value(14695981039346656037ULL) {}
+
+		///Add raw bytes to the hash
+		void Add(const void* data, size_t size)
+		{
+			const PxU8* bytes = (const PxU8*)data;
+			for (size_t i = 0; i < size; i++)
+			{
+				value ^= bytes[i];
+				value *= 1099511628211ULL;
+			}
+		}
+
+		///Add a single value of a trivially copyable type
+		template<class T>
+		void Add(const T& data)
+		{
+			Add(&data, sizeof(T));
+		}
+
+		void Add(const std::string& data)
+		{
+			Add(data.c_str(), data.size());
+		}
+
+		///Get the hash value
+		PxU64 Get() const
+		{
+			return value;
+		}
+
+		///Get the hash value as a 16 character hex string
+		std::string Hex() const
+		{
+			char buffer[17];
+			snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)value);
+			return buffer;
+		}
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include <vector>
+#include <unordered_map>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///Several static models merged into a single triangle mesh
+	///Every triangle keeps the material index of the model it came from, so a single shape with a material table
+	///replaces one actor per model and keeps friction and restitution per surface.
+	class MergedMesh
+	{
+	public:
+		vector<PxVec3> vertices;
+		vector<PxU32> indices;
+		vector<PxMaterialTableIndex> materials;
+
+		///Append the triangles of a model (or a subset of them), only the vertices they use are copied
+		void Add(const vector<PxVec3>& verts, const vector<PxU32>& trigs, PxMaterialTableIndex material)
+		{
+			unordered_map<PxU32, PxU32> remap;
+			for (PxU32 i = 0; i + 2 < trigs.size(); i += 3)
+			{
+				for (PxU32 k = 0; k < 3; k++)
+				{
+					pair<unordered_map<PxU32, PxU32>::iterator, bool> found = remap.insert(make_pair(trigs[i + k], (PxU32)vertices.size()));
+					if (found.second)
+						vertices.push_back(verts[trigs[i + k]]);
+					indices.push_back(found.first->second);
+				}
+				materials.push_back(material);
+			}
+		}
+
+		///Number of triangles
+		PxU32 TriangleCount() const
+		{
+			return (PxU32)materials.size();
+		}
+
+		///Bounds of the merged vertices
+		PxBounds3 Bounds() const
+		{
+			PxBounds3 bounds = PxBounds3::empty();
+			for (PxU32 i = 0; i < vertices.size(); i++)
+				bounds.include(vertices[i]);
+			return bounds;
+		}
+
+		///Cooking description, valid while the merged mesh is alive
+		PxTriangleMeshDesc Desc() const
+		{
+			PxTriangleMeshDesc mesh_desc;
+			mesh_desc.points.count = (PxU32)vertices.size();
+			mesh_desc.points.stride = sizeof(PxVec3);
+			mesh_desc.points.data = &vertices.front();
+			mesh_desc.triangles.count = (PxU32)indices.size() / 3;
+			mesh_desc.triangles.stride = 3 * sizeof(PxU32);
+			mesh_desc.triangles.data = &indices.front();
+			mesh_desc.materialIndices.stride = sizeof(PxMaterialTableIndex);
+			mesh_desc.materialIndices.data = &materials.front();
+			return mesh_desc;
+		}
+	};
+}
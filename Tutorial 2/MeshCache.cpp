@@ -0,0 +1,177 @@
+#include "MeshCache.h"
+#include "FileIO.h"
+#include "Hash.h"
+#include <iostream>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	//bump when the layout of the cache keys changes
+	static const PxU32 mesh_cache_version = 1;
+
+	//cooked meshes are stored next to the models
+	string mesh_cache_directory = "..//Assets//Cache//";
+
+	void MeshCacheDirectory(const string& path)
+	{
+		mesh_cache_directory = path;
+	}
+
+	string MeshCacheDirectory()
+	{
+		return mesh_cache_directory;
+	}
+
+	//cooking parameters change the cooked data, so they are part of the key
+	void HashCookingParams(Hasher& hasher, const PxCookingParams& params)
+	{
+		hasher.Add(params.scale.length);
+		hasher.Add(params.scale.speed);
+		hasher.Add(params.areaTestEpsilon);
+		hasher.Add(params.planeTolerance);
+		hasher.Add((PxU32)params.convexMeshCookingType);
+		hasher.Add(params.suppressTriangleMeshRemapTable);
+		hasher.Add(params.buildTriangleAdjacencies);
+		hasher.Add(params.buildGPUData);
+		hasher.Add((PxU32)params.meshPreprocessParams);
+		hasher.Add(params.meshWeldTolerance);
+		hasher.Add((PxU32)params.midphaseDesc.getType());
+		if (params.midphaseDesc.getType() == PxMeshMidPhase::eBVH33)
+		{
+			hasher.Add(params.midphaseDesc.mBVH33Desc.meshSizePerformanceTradeOff);
+			hasher.Add((PxU32)params.midphaseDesc.mBVH33Desc.meshCookingHint);
+		}
+		else
+		{
+			hasher.Add(params.midphaseDesc.mBVH34Desc.numTrisPerLeaf);
+		}
+	}
+
+	//hash a strided array element by element so that padding between elements is ignored
+	void HashStrided(Hasher& hasher, const void* data, PxU32 count, PxU32 stride, PxU32 element_size)
+	{
+		hasher.Add(count);
+		if (!data)
+			return;
+
+		const PxU8* bytes = (const PxU8*)data;
+		if (stride == element_size)
+		{
+			hasher.Add(bytes, (size_t)count*element_size);
+			return;
+		}
+
+		for (PxU32 i = 0; i < count; i++)
+			hasher.Add(bytes + (size_t)i*stride, element_size);
+	}
+
+	string CacheKey(const char* type, const PxCookingParams& params, const Hasher& data)
+	{
+		Hasher hasher;
+		hasher.Add(string(type));
+		hasher.Add(mesh_cache_version);
+		hasher.Add((PxU32)PX_PHYSICS_VERSION);
+		HashCookingParams(hasher, params);
+		hasher.Add(data.Get());
+		return hasher.Hex();
+	}
+
+	string CachePath(const string& key, const char* extension)
+	{
+		return mesh_cache_directory + key + extension;
+	}
+
+	//store the cooked stream, a failure only costs the next startup a cook
+	void StoreCached(const string& path, const PxDefaultMemoryOutputStream& stream)
+	{
+		if (!CreateDirectories(mesh_cache_directory) || !WriteFileAtomic(path, stream.getData(), stream.getSize()))
+			cerr << "MeshCache: could not write " << path << endl;
+	}
+
+	PxTriangleMesh* CookTriangleMesh(const PxTriangleMeshDesc& mesh_desc, const CookingOptions& options)
+	{
+		PxCooking* cooking = GetCooking(options);
+		string path;
+
+		if (!mesh_cache_directory.empty())
+		{
+			Hasher data;
+			HashStrided(data, mesh_desc.points.data, mesh_desc.points.count, mesh_desc.points.stride, sizeof(PxVec3));
+			PxU32 index_size = (mesh_desc.flags & PxMeshFlag::e16_BIT_INDICES) ? 3*sizeof(PxU16) : 3*sizeof(PxU32);
+			HashStrided(data, mesh_desc.triangles.data, mesh_desc.triangles.count, mesh_desc.triangles.stride, index_size);
+			HashStrided(data, mesh_desc.materialIndices.data, mesh_desc.materialIndices.data ? mesh_desc.triangles.count : 0,
+				mesh_desc.materialIndices.stride, sizeof(PxMaterialTableIndex));
+			data.Add((PxU16)mesh_desc.flags);
+
+			path = CachePath(CacheKey("triangle", cooking->getParams(), data), ".tri");
+
+			//cache hit: create the mesh straight from the mapped file
+			MappedFile file(path);
+			if (file.IsOpen())
+			{
+				PxDefaultMemoryInputData input((PxU8*)file.Data(), (PxU32)file.Size());
+				PxTriangleMesh* mesh = GetPhysics()->createTriangleMesh(input);
+				if (mesh)
+					return mesh;
+				cerr << "MeshCache: " << path << " is invalid, cooking again" << endl;
+			}
+		}
+
+		PxDefaultMemoryOutputStream stream;
+
+		if (!cooking->cookTriangleMesh(mesh_desc, stream))
+			throw new Exception("PhysicsEngine::CookTriangleMesh, cooking failed.");
+
+		if (!path.empty())
+			StoreCached(path, stream);
+
+		PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+
+		return GetPhysics()->createTriangleMesh(input);
+	}
+
+	PxConvexMesh* CookConvexMesh(const PxConvexMeshDesc& mesh_desc, const CookingOptions& options)
+	{
+		PxCooking* cooking = GetCooking(options);
+		string path;
+
+		if (!mesh_cache_directory.empty())
+		{
+			Hasher data;
+			HashStrided(data, mesh_desc.points.data, mesh_desc.points.count, mesh_desc.points.stride, sizeof(PxVec3));
+			HashStrided(data, mesh_desc.polygons.data, mesh_desc.polygons.count, mesh_desc.polygons.stride, sizeof(PxHullPolygon));
+			PxU32 index_size = (mesh_desc.flags & PxConvexFlag::e16_BIT_INDICES) ? sizeof(PxU16) : sizeof(PxU32);
+			HashStrided(data, mesh_desc.indices.data, mesh_desc.indices.count, mesh_desc.indices.stride, index_size);
+			data.Add((PxU16)mesh_desc.flags);
+			data.Add(mesh_desc.vertexLimit);
+			data.Add(mesh_desc.quantizedCount);
+
+			path = CachePath(CacheKey("convex", cooking->getParams(), data), ".cvx");
+
+			//cache hit: create the mesh straight from the mapped file
+			MappedFile file(path);
+			if (file.IsOpen())
+			{
+				PxDefaultMemoryInputData input((PxU8*)file.Data(), (PxU32)file.Size());
+				PxConvexMesh* mesh = GetPhysics()->createConvexMesh(input);
+				if (mesh)
+					return mesh;
+				cerr << "MeshCache: " << path << " is invalid, cooking again" << endl;
+			}
+		}
+
+		PxDefaultMemoryOutputStream stream;
+
+		if (!cooking->cookConvexMesh(mesh_desc, stream))
+			throw new Exception("PhysicsEngine::CookConvexMesh, cooking failed.");
+
+		if (!path.empty())
+			StoreCached(path, stream);
+
+		PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+
+		return GetPhysics()->createConvexMesh(input);
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include <string>
+
+namespace PhysicsEngine
+{
+	///Set the directory cooked meshes are cached in (an empty string disables the cache)
+	void MeshCacheDirectory(const string& path);
+
+	///Get the directory cooked meshes are cached in
+	string MeshCacheDirectory();
+
+	///Cook a triangle mesh or load it from the cache when the same data was cooked before
+	PxTriangleMesh* CookTriangleMesh(const PxTriangleMeshDesc& mesh_desc, const CookingOptions& options=CookingOptions());
+
+	///Cook a convex mesh or load it from the cache when the same data was cooked before
+	PxConvexMesh* CookConvexMesh(const PxConvexMeshDesc& mesh_desc, const CookingOptions& options=CookingOptions());
+}
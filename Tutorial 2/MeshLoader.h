@@ -0,0 +1,466 @@
+#pragma once
+
+#include "ModelLoader.h"
+#include "Model.h"
+#include "BinaryMesh.h"
+#include "MeshCache.h"
+#include "ConvexDecomposition.h"
+#include "MeshSimplifier.h"
+#include "MeshWelder.h"
+#include "AssetCache.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <deque>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///Kind of PhysX mesh cooked from a model
+	struct MeshType
+	{
+		enum Enum
+		{
+			TRIANGLE,
+			CONVEX,
+			//concave dynamic object, decomposed into convex hulls
+			COMPOUND,
+			//parsed only, the model is kept in vertices and indices for the course streamer
+			STREAMED
+		};
+	};
+
+	///A model loaded and cooked by the MeshLoader
+	struct LoadedMesh
+	{
+		string path;
+		MeshType::Enum type;
+		CookingOptions options;
+		//simplification tolerance of the collision mesh, 0 cooks the model as it is
+		PxReal collision_tolerance;
+		//vertices closer than this are merged after parsing, negative keeps the model as exported
+		PxReal weld_epsilon;
+		//scale baked into the vertices
+		PxVec3 scale;
+		//splitting of COMPOUND models, --decompose stores the hulls for the same parameters
+		DecompositionParams decomposition;
+		PxTriangleMesh* triangle_mesh;
+		//full detail model for rendering when the collision mesh is simplified
+		shared_ptr<const Model> render_model;
+		PxConvexMesh* convex_mesh;
+		vector<PxConvexMesh*> convex_hulls;
+		vector<PxVec3> vertices;
+		vector<PxU32> indices;
+		PxU32 vertex_count;
+		PxU32 triangle_count;
+		PxU32 collision_triangle_count;
+		//read from the converted .mesh file instead of parsing the .obj
+		bool binary;
+		//the meshes were shared from the asset cache, nothing was parsed or cooked
+		bool cached;
+		WeldStats weld;
+		//timings in milliseconds
+		double parse_time;
+		double weld_time;
+		double simplify_time;
+		double cook_time;
+
+		LoadedMesh(const string& _path, MeshType::Enum _type, const CookingOptions& _options, PxReal _collision_tolerance, PxReal _weld_epsilon,
+			const PxVec3& _scale, const DecompositionParams& _decomposition)
+			: path(_path), type(_type), options(_options), collision_tolerance(_collision_tolerance), weld_epsilon(_weld_epsilon), scale(_scale),
+			decomposition(_decomposition), triangle_mesh(0), convex_mesh(0), vertex_count(0), triangle_count(0), collision_triangle_count(0), binary(false), cached(false), parse_time(0.0),
+			weld_time(0.0), simplify_time(0.0), cook_time(0.0)
+		{
+		}
+	};
+
+	///Loader stage parsing and cooking a batch of models concurrently on the thread pool
+	///Load waits for every model, results are stored in the order the models were added, so actors built from them
+	///are always created in the same order regardless of which job finishes first.
+	///Start returns straight away instead: finished jobs queue their model and the main thread takes them with Next,
+	///so actors can be created while the other models are still loading.
+	class MeshLoader
+	{
+		vector<LoadedMesh> meshes;
+		PxReal weld_epsilon;
+		double wall_time;
+		vector<future<void> > jobs;
+		chrono::high_resolution_clock::time_point start_time;
+		//models whose job has finished but which were not taken with Next yet
+		mutable mutex finished_mutex;
+		deque<PxU32> finished;
+		PxU32 finished_count;
+
+		static double Milliseconds(chrono::high_resolution_clock::time_point start)
+		{
+			return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+		}
+
+		static PxTriangleMesh* CookMesh(const vector<PxVec3>& vertices, const vector<PxU32>& indices, const CookingOptions& options)
+		{
+			PxTriangleMeshDesc mesh_desc;
+			mesh_desc.points.count = (PxU32)vertices.size();
+			mesh_desc.points.stride = sizeof(PxVec3);
+			mesh_desc.points.data = &vertices.front();
+			mesh_desc.triangles.count = (PxU32)indices.size() / 3;
+			mesh_desc.triangles.stride = 3 * sizeof(PxU32);
+			mesh_desc.triangles.data = &indices.front();
+
+			return CookTriangleMesh(mesh_desc, options);
+		}
+
+		//everything that changes the cooked meshes of a model besides its path and scale
+		static string AssetVariant(const LoadedMesh& mesh)
+		{
+			ostringstream variant;
+			variant << mesh.type << " " << mesh.collision_tolerance << " " << mesh.weld_epsilon << " " << mesh.options.midphase << " "
+				<< mesh.options.weld_tolerance << " " << mesh.options.clean_mesh << mesh.options.active_edges << mesh.options.runtime;
+			if (mesh.type == MeshType::COMPOUND)
+				variant << " " << mesh.decomposition.max_hulls << " " << mesh.decomposition.resolution << " " << mesh.decomposition.concavity
+					<< " " << mesh.decomposition.hull_vertex_limit;
+			return variant.str();
+		}
+
+		//share the meshes of an asset loaded before, the counts are taken from the meshes
+		static bool FindAsset(LoadedMesh& mesh, const string& key)
+		{
+			Asset asset;
+			if (!GetAssetCache().Find(key, asset))
+				return false;
+
+			mesh.cached = true;
+			mesh.triangle_mesh = asset.triangle_mesh;
+			mesh.render_model = asset.render_model;
+			mesh.convex_mesh = asset.convex_mesh;
+			mesh.convex_hulls = asset.convex_hulls;
+			if (mesh.triangle_mesh)
+			{
+				mesh.collision_triangle_count = mesh.triangle_mesh->getNbTriangles();
+				mesh.vertex_count = mesh.render_model ? mesh.render_model->VertexCount() : mesh.triangle_mesh->getNbVertices();
+				mesh.triangle_count = mesh.render_model ? mesh.render_model->TriangleCount() : mesh.triangle_mesh->getNbTriangles();
+			}
+			else if (mesh.convex_mesh)
+			{
+				mesh.vertex_count = mesh.convex_mesh->getNbVertices();
+			}
+			return true;
+		}
+
+		static void InsertAsset(LoadedMesh& mesh, const string& key)
+		{
+			Asset asset;
+			asset.triangle_mesh = mesh.triangle_mesh;
+			asset.render_model = mesh.render_model;
+			asset.convex_mesh = mesh.convex_mesh;
+			asset.convex_hulls = mesh.convex_hulls;
+			GetAssetCache().Insert(key, asset);
+			mesh.triangle_mesh = asset.triangle_mesh;
+			mesh.render_model = asset.render_model;
+			mesh.convex_mesh = asset.convex_mesh;
+			mesh.convex_hulls = asset.convex_hulls;
+		}
+
+		//parse and cook a single model, runs on a worker thread
+		static void LoadMesh(LoadedMesh& mesh)
+		{
+			//streamed models are cooked in chunks by the course streamer, everything else is shared
+			string key;
+			if (mesh.type != MeshType::STREAMED)
+			{
+				key = AssetCache::Key(mesh.path, mesh.scale, AssetVariant(mesh));
+				if (FindAsset(mesh, key))
+					return;
+			}
+
+			ModelImport importer;
+			vector<PxVec3> vertices;
+			vector<PxU32> indices;
+
+			//models converted with --convert are mapped instead of parsed, meshes cooked as they are
+			//are cooked straight from the mapping. The conversion has to come from the model as it is now, welded
+			//the same way, a mesh shipped without its model is always used.
+			chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+			BinaryMesh binary;
+			mesh.binary = binary.Open(BinaryMeshPath(mesh.path)) && (!FileExists(mesh.path) || binary.Matches(mesh.path, mesh.weld_epsilon));
+			if (!mesh.binary)
+				binary.Close();
+			bool scaled = (mesh.scale != PxVec3(1.f));
+			bool direct = mesh.binary && !scaled && ((mesh.type == MeshType::CONVEX) || ((mesh.type == MeshType::TRIANGLE) && (mesh.collision_tolerance <= 0.f)));
+			//simplified triangle meshes are drawn with the model, which keeps the normals and texture coordinates
+			shared_ptr<Model> model;
+			if ((mesh.type == MeshType::TRIANGLE) && (mesh.collision_tolerance > 0.f))
+				model = make_shared<Model>();
+			if (!mesh.binary && model)
+			{
+				//one parse feeds the model and the collision mesh
+				ObjModel obj;
+				if (!LoadOBJFile(mesh.path, obj))
+					throw new Exception("MeshLoader::LoadMesh, cannot open " + mesh.path + ".");
+				model->Load(obj);
+				vertices.swap(obj.vertices);
+				indices.swap(obj.indices);
+			}
+			else if (!mesh.binary)
+			{
+				importer.LoadOBJ(mesh.path.c_str(), vertices, indices);
+			}
+			else if (!direct)
+			{
+				binary.Read(vertices, indices);
+				if (model)
+					model->Load(binary);
+			}
+			if (scaled)
+			{
+				for (PxU32 i = 0; i < vertices.size(); i++)
+					vertices[i] = vertices[i].multiply(mesh.scale);
+				if (model)
+					model->Scale(mesh.scale);
+			}
+			mesh.parse_time = Milliseconds(start);
+
+			//converted models were welded by the converter, only the seams it split for the normals and texture coordinates
+			//are merged again, convex hulls only need the points
+			if (!direct && (mesh.type != MeshType::CONVEX) && (mesh.weld_epsilon >= 0.f))
+			{
+				start = chrono::high_resolution_clock::now();
+				mesh.weld = WeldMesh(vertices, indices, mesh.binary ? 0.f : mesh.weld_epsilon);
+				mesh.weld_time = Milliseconds(start);
+			}
+
+			mesh.vertex_count = mesh.binary ? binary.VertexCount() : (PxU32)vertices.size();
+			mesh.triangle_count = (mesh.binary ? binary.IndexCount() : (PxU32)indices.size()) / 3;
+			mesh.collision_triangle_count = mesh.triangle_count;
+
+			if (direct)
+			{
+				start = chrono::high_resolution_clock::now();
+				if (mesh.type == MeshType::TRIANGLE)
+					mesh.triangle_mesh = CookTriangleMesh(binary.TriangleMeshDesc(), mesh.options);
+				else
+					mesh.convex_mesh = CookConvexMesh(binary.ConvexMeshDesc(), mesh.options);
+				mesh.cook_time = Milliseconds(start);
+				InsertAsset(mesh, key);
+				return;
+			}
+
+			//the model is kept for rendering, collisions use the simplified copy
+			if (model)
+			{
+				start = chrono::high_resolution_clock::now();
+				vector<PxVec3> full_vertices;
+				vector<PxU32> full_indices;
+				full_vertices.swap(vertices);
+				full_indices.swap(indices);
+				mesh.collision_triangle_count = SimplifyMesh(full_vertices, full_indices, mesh.collision_tolerance, vertices, indices);
+				mesh.simplify_time = Milliseconds(start);
+				mesh.render_model = model;
+			}
+
+			start = chrono::high_resolution_clock::now();
+			if (mesh.type == MeshType::TRIANGLE)
+			{
+				mesh.triangle_mesh = CookMesh(vertices, indices, mesh.options);
+			}
+			else if (mesh.type == MeshType::COMPOUND)
+			{
+				mesh.convex_hulls = CookConvexHulls(DecomposeConvexCached(vertices, indices, mesh.decomposition), mesh.decomposition);
+			}
+			else if (mesh.type == MeshType::STREAMED)
+			{
+				mesh.vertices.swap(vertices);
+				mesh.indices.swap(indices);
+			}
+			else
+			{
+				PxConvexMeshDesc mesh_desc;
+				mesh_desc.points.count = (PxU32)vertices.size();
+				mesh_desc.points.stride = sizeof(PxVec3);
+				mesh_desc.points.data = &vertices.front();
+				mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+				mesh_desc.vertexLimit = 256;
+
+				mesh.convex_mesh = CookConvexMesh(mesh_desc, mesh.options);
+			}
+			mesh.cook_time = Milliseconds(start);
+
+			if (!key.empty())
+				InsertAsset(mesh, key);
+		}
+
+		//queue a model whose job has finished, successfully or not
+		void Finish(PxU32 index)
+		{
+			lock_guard<mutex> lock(finished_mutex);
+			finished.push_back(index);
+			if (++finished_count == meshes.size())
+				wall_time = Milliseconds(start_time);
+		}
+
+	public:
+		MeshLoader() : weld_epsilon(1e-5f), wall_time(0.0), finished_count(0) {}
+
+		///Waits for the jobs still running, they write into the models
+		~MeshLoader()
+		{
+			for (unsigned int i = 0; i < jobs.size(); i++)
+				if (jobs[i].valid())
+					jobs[i].wait();
+		}
+
+		///Vertices closer than epsilon are merged in the models added from now on, negative disables welding (see WeldMesh)
+		void WeldEpsilon(PxReal epsilon)
+		{
+			weld_epsilon = epsilon;
+		}
+
+		///Queue a model for loading, returns its index
+		///A collision tolerance above 0 simplifies triangle meshes for collisions and keeps the model as the render mesh.
+		///Models loaded before with the same scale and options share their meshes (see AssetCache).
+		///COMPOUND models are split with the decomposition parameters.
+		PxU32 Add(const string& path, MeshType::Enum type, const CookingOptions& options=CookingOptions(), PxReal collision_tolerance=0.f,
+			const PxVec3& scale=PxVec3(1.f), const DecompositionParams& decomposition=DecompositionParams())
+		{
+			meshes.push_back(LoadedMesh(path, type, options, collision_tolerance, weld_epsilon, scale, decomposition));
+			return (PxU32)meshes.size() - 1;
+		}
+
+		///Start parsing and cooking all queued models in parallel and return without waiting
+		///No models can be added once the loading has started.
+		void Start()
+		{
+			start_time = chrono::high_resolution_clock::now();
+
+			//assets of earlier loads which no actor uses any more
+			GetAssetCache().Collect();
+
+			for (unsigned int i = 0; i < meshes.size(); i++)
+			{
+				jobs.push_back(GetThreadPool().Submit([this, i]
+				{
+					try
+					{
+						LoadMesh(meshes[i]);
+					}
+					catch (...)
+					{
+						Finish(i);
+						throw;
+					}
+					Finish(i);
+				}));
+			}
+		}
+
+		///Take the next finished model, returns false if none has finished since the last call
+		///Call from the thread creating the actors, a model that failed to load throws its Exception here.
+		bool Next(PxU32& index)
+		{
+			{
+				lock_guard<mutex> lock(finished_mutex);
+				if (finished.empty())
+					return false;
+				index = finished.front();
+				finished.pop_front();
+			}
+			jobs[index].get();
+			return true;
+		}
+
+		///Parse and cook all queued models in parallel and wait for them to finish
+		void Load()
+		{
+			Start();
+
+			//wait for every job before reporting the first failure, the jobs write into meshes
+			Exception* error = 0;
+			for (unsigned int i = 0; i < jobs.size(); i++)
+			{
+				try
+				{
+					jobs[i].get();
+				}
+				catch (Exception* exc)
+				{
+					if (!error)
+						error = exc;
+					else
+						delete exc;
+				}
+			}
+
+			if (error)
+				throw error;
+		}
+
+		///Number of models whose job has finished
+		PxU32 FinishedCount() const
+		{
+			lock_guard<mutex> lock(finished_mutex);
+			return finished_count;
+		}
+
+		///Have all models finished loading?
+		bool Done() const
+		{
+			return FinishedCount() == Size();
+		}
+
+		///Get a loaded model
+		const LoadedMesh& Get(PxU32 index) const
+		{
+			return meshes[index];
+		}
+
+		///Number of queued models
+		PxU32 Size() const
+		{
+			return (PxU32)meshes.size();
+		}
+
+		///Print the per-model parse, simplification and cook timings
+		void Report(ostream& out) const
+		{
+			double serial_time = 0.0;
+
+			out << "MeshLoader: " << meshes.size() << " models on " << GetThreadPool().Size() << " threads, "
+				<< GetAssetCache().Size() << " assets cached" << endl;
+			out << fixed << setprecision(2);
+			for (unsigned int i = 0; i < meshes.size(); i++)
+			{
+				const LoadedMesh& mesh = meshes[i];
+				if (mesh.cached)
+				{
+					out << "  " << left << setw(40) << mesh.path << right
+						<< setw(9) << mesh.vertex_count << " verts"
+						<< setw(9) << mesh.triangle_count << " trigs  shared from the asset cache" << endl;
+					continue;
+				}
+				out << "  " << left << setw(40) << mesh.path << right
+					<< setw(9) << mesh.vertex_count << " verts"
+					<< setw(9) << mesh.triangle_count << " trigs"
+					<< (mesh.binary ? "  map   " : "  parse ") << setw(9) << mesh.parse_time << " ms"
+					<< "  cook " << setw(9) << mesh.cook_time << " ms" << endl;
+				if ((mesh.weld.input_vertices != mesh.weld.output_vertices) || (mesh.weld.input_triangles != mesh.weld.output_triangles))
+				{
+					out << "    welded " << mesh.weld.input_vertices << " verts ("
+						<< 100.0 * (1.0 - (double)mesh.weld.output_vertices / PxMax(mesh.weld.input_vertices, 1u)) << "% fewer), dropped "
+						<< mesh.weld.degenerate_triangles << " degenerate and " << mesh.weld.duplicate_triangles << " duplicate trigs"
+						<< "  weld " << mesh.weld_time << " ms" << endl;
+				}
+				if (mesh.collision_triangle_count != mesh.triangle_count)
+				{
+					out << "    collision mesh " << mesh.collision_triangle_count << " trigs ("
+						<< 100.0 * (1.0 - (double)mesh.collision_triangle_count / PxMax(mesh.triangle_count, 1u)) << "% fewer)"
+						<< "  simplify " << mesh.simplify_time << " ms" << endl;
+				}
+				serial_time += mesh.parse_time + mesh.weld_time + mesh.simplify_time + mesh.cook_time;
+			}
+			out << "  total " << wall_time << " ms (" << serial_time << " ms of work)" << endl;
+			out.unsetf(ios::floatfield);
+		}
+	};
+}
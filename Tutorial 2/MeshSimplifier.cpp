@@ -0,0 +1,396 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <cmath>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	//moving a vertex off an open border costs this much more than moving it off a face
+	static const double boundary_weight = 1000.0;
+	//smallest cosine between a face normal before and after a collapse, prevents fold overs
+	static const PxReal min_normal_dot = .2f;
+
+	//symmetric 4x4 matrix summing the squared distances of a point to a set of planes
+	class Quadric
+	{
+		double m[10];
+
+	public:
+		Quadric()
+		{
+			for (PxU32 i = 0; i < 10; i++)
+				m[i] = 0.0;
+		}
+
+		void AddPlane(const PxVec3& n, PxReal d, double weight=1.0)
+		{
+			double a = n.x, b = n.y, c = n.z, e = d;
+			m[0] += weight * a * a; m[1] += weight * a * b; m[2] += weight * a * c; m[3] += weight * a * e;
+			m[4] += weight * b * b; m[5] += weight * b * c; m[6] += weight * b * e;
+			m[7] += weight * c * c; m[8] += weight * c * e;
+			m[9] += weight * e * e;
+		}
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			for (PxU32 i = 0; i < 10; i++)
+				m[i] += q.m[i];
+			return *this;
+		}
+
+		double Error(const PxVec3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+				+ m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+				+ m[7] * z * z + 2.0 * m[8] * z + m[9];
+		}
+
+		//position with the least error, false if the quadric is singular (flat or straight regions)
+		bool Optimal(PxVec3& p) const
+		{
+			double det = m[0] * (m[4] * m[7] - m[5] * m[5]) - m[1] * (m[1] * m[7] - m[5] * m[2]) + m[2] * (m[1] * m[5] - m[4] * m[2]);
+			if (fabs(det) < 1e-10)
+				return false;
+
+			double i00 = m[4] * m[7] - m[5] * m[5], i01 = m[2] * m[5] - m[1] * m[7], i02 = m[1] * m[5] - m[2] * m[4];
+			double i11 = m[0] * m[7] - m[2] * m[2], i12 = m[1] * m[2] - m[0] * m[5];
+			double i22 = m[0] * m[4] - m[1] * m[1];
+			p.x = (PxReal)(-(i00 * m[3] + i01 * m[6] + i02 * m[8]) / det);
+			p.y = (PxReal)(-(i01 * m[3] + i11 * m[6] + i12 * m[8]) / det);
+			p.z = (PxReal)(-(i02 * m[3] + i12 * m[6] + i22 * m[8]) / det);
+			return true;
+		}
+	};
+
+	class Simplifier
+	{
+		//an edge collapse waiting in the queue, stale once either vertex changed
+		struct Collapse
+		{
+			double cost;
+			PxU32 v0, v1;
+			PxU32 stamp0, stamp1;
+			PxVec3 position;
+
+			bool operator<(const Collapse& collapse) const
+			{
+				return cost > collapse.cost;
+			}
+		};
+
+		vector<PxVec3> positions;
+		vector<Quadric> quadrics;
+		vector<PxU32> stamps;
+		vector<bool> vertex_removed;
+		vector<vector<PxU32> > vertex_trigs;
+		vector<PxU32> indices;
+		vector<PxMaterialTableIndex> materials;
+		vector<bool> trig_removed;
+		priority_queue<Collapse> queue;
+		double max_cost;
+
+		bool HasVertex(PxU32 trig, PxU32 v) const
+		{
+			return (indices[trig * 3] == v) || (indices[trig * 3 + 1] == v) || (indices[trig * 3 + 2] == v);
+		}
+
+		void Neighbours(PxU32 v, vector<PxU32>& out) const
+		{
+			out.clear();
+			for (PxU32 i = 0; i < vertex_trigs[v].size(); i++)
+			{
+				PxU32 trig = vertex_trigs[v][i];
+				for (PxU32 k = 0; k < 3; k++)
+					if (indices[trig * 3 + k] != v)
+						out.push_back(indices[trig * 3 + k]);
+			}
+			sort(out.begin(), out.end());
+			out.erase(unique(out.begin(), out.end()), out.end());
+		}
+
+		void Weld(const vector<PxVec3>& verts, const vector<PxU32>& trigs, const vector<PxMaterialTableIndex>& trig_materials)
+		{
+			//merge exact duplicates so that the surface is connected across split vertices
+			vector<PxU32> order(verts.size());
+			for (PxU32 i = 0; i < order.size(); i++)
+				order[i] = i;
+			sort(order.begin(), order.end(), [&verts](PxU32 a, PxU32 b)
+			{
+				if (verts[a].x != verts[b].x) return verts[a].x < verts[b].x;
+				if (verts[a].y != verts[b].y) return verts[a].y < verts[b].y;
+				return verts[a].z < verts[b].z;
+			});
+
+			vector<PxU32> remap(verts.size());
+			for (PxU32 i = 0; i < order.size(); i++)
+			{
+				if ((i == 0) || (verts[order[i]] != verts[order[i - 1]]))
+					positions.push_back(verts[order[i]]);
+				remap[order[i]] = (PxU32)positions.size() - 1;
+			}
+
+			//drop triangles that became degenerate
+			for (PxU32 t = 0; t + 2 < trigs.size(); t += 3)
+			{
+				PxU32 a = remap[trigs[t]], b = remap[trigs[t + 1]], c = remap[trigs[t + 2]];
+				if ((a == b) || (b == c) || (c == a))
+					continue;
+				if ((positions[b] - positions[a]).cross(positions[c] - positions[a]).magnitudeSquared() == 0.f)
+					continue;
+				indices.push_back(a);
+				indices.push_back(b);
+				indices.push_back(c);
+				materials.push_back(trig_materials.empty() ? 0 : trig_materials[t / 3]);
+			}
+		}
+
+		void BuildQuadrics()
+		{
+			quadrics.resize(positions.size());
+			vertex_trigs.resize(positions.size());
+			unordered_map<PxU64, PxU32> edge_trigs;
+			//material of the first triangle on every edge, edges between two materials count as borders
+			unordered_map<PxU64, PxU32> edge_materials;
+
+			for (PxU32 t = 0; t < indices.size() / 3; t++)
+			{
+				const PxVec3& p0 = positions[indices[t * 3]];
+				PxVec3 n = (positions[indices[t * 3 + 1]] - p0).cross(positions[indices[t * 3 + 2]] - p0).getNormalized();
+				for (PxU32 k = 0; k < 3; k++)
+				{
+					PxU32 v0 = indices[t * 3 + k], v1 = indices[t * 3 + (k + 1) % 3];
+					quadrics[v0].AddPlane(n, -n.dot(p0));
+					vertex_trigs[v0].push_back(t);
+					PxU64 edge = ((PxU64)PxMin(v0, v1) << 32) | PxMax(v0, v1);
+					edge_trigs[edge]++;
+					if (!edge_materials.insert(make_pair(edge, (PxU32)materials[t])).second && (edge_materials[edge] != materials[t]))
+						edge_materials[edge] = PX_MAX_U32;
+				}
+			}
+
+			//border edges (open or between materials) get a plane perpendicular to their face
+			for (PxU32 t = 0; t < indices.size() / 3; t++)
+			{
+				const PxVec3& p0 = positions[indices[t * 3]];
+				PxVec3 n = (positions[indices[t * 3 + 1]] - p0).cross(positions[indices[t * 3 + 2]] - p0).getNormalized();
+				for (PxU32 k = 0; k < 3; k++)
+				{
+					PxU32 v0 = indices[t * 3 + k], v1 = indices[t * 3 + (k + 1) % 3];
+					PxU64 edge = ((PxU64)PxMin(v0, v1) << 32) | PxMax(v0, v1);
+					if ((edge_trigs[edge] != 1) && (edge_materials[edge] != PX_MAX_U32))
+						continue;
+
+					PxVec3 border_normal = (positions[v1] - positions[v0]).cross(n);
+					if (border_normal.normalize() == 0.f)
+						continue;
+					PxReal d = -border_normal.dot(positions[v0]);
+					quadrics[v0].AddPlane(border_normal, d, boundary_weight);
+					quadrics[v1].AddPlane(border_normal, d, boundary_weight);
+				}
+			}
+		}
+
+		void QueueCollapse(PxU32 v0, PxU32 v1)
+		{
+			Quadric q = quadrics[v0];
+			q += quadrics[v1];
+
+			const PxVec3& p0 = positions[v0];
+			const PxVec3& p1 = positions[v1];
+			PxVec3 midpoint = (p0 + p1) * .5f;
+
+			//the endpoints keep flat regions exact, the optimum is only used when it stays near the edge
+			PxVec3 candidates[4] = { p0, p1, midpoint, midpoint };
+			PxU32 candidate_count = 3;
+			if (q.Optimal(candidates[3]) && ((candidates[3] - midpoint).magnitude() <= (p1 - p0).magnitude()))
+				candidate_count = 4;
+
+			Collapse collapse;
+			collapse.cost = PX_MAX_F64;
+			for (PxU32 i = 0; i < candidate_count; i++)
+			{
+				double cost = PxMax(0.0, q.Error(candidates[i]));
+				if (cost < collapse.cost)
+				{
+					collapse.cost = cost;
+					collapse.position = candidates[i];
+				}
+			}
+
+			if (collapse.cost > max_cost)
+				return;
+
+			collapse.v0 = v0;
+			collapse.v1 = v1;
+			collapse.stamp0 = stamps[v0];
+			collapse.stamp1 = stamps[v1];
+			queue.push(collapse);
+		}
+
+		bool CanCollapse(PxU32 v0, PxU32 v1, const PxVec3& position) const
+		{
+			//link condition: the only shared neighbours are the opposite corners of the shared triangles,
+			//otherwise the collapse pinches the surface
+			vector<PxU32> n0, n1, shared;
+			Neighbours(v0, n0);
+			Neighbours(v1, n1);
+			set_intersection(n0.begin(), n0.end(), n1.begin(), n1.end(), back_inserter(shared));
+
+			PxU32 edge_trigs = 0;
+			for (PxU32 i = 0; i < vertex_trigs[v0].size(); i++)
+				if (HasVertex(vertex_trigs[v0][i], v1))
+					edge_trigs++;
+			if ((edge_trigs == 0) || (shared.size() != edge_trigs))
+				return false;
+
+			//no triangle may flip or collapse to a sliver
+			PxU32 vs[2] = { v0, v1 };
+			for (PxU32 s = 0; s < 2; s++)
+			{
+				for (PxU32 i = 0; i < vertex_trigs[vs[s]].size(); i++)
+				{
+					PxU32 trig = vertex_trigs[vs[s]][i];
+					if (HasVertex(trig, v0) && HasVertex(trig, v1))
+						continue;
+
+					PxVec3 p[3], q[3];
+					for (PxU32 k = 0; k < 3; k++)
+					{
+						p[k] = positions[indices[trig * 3 + k]];
+						q[k] = (indices[trig * 3 + k] == vs[s]) ? position : p[k];
+					}
+					PxVec3 old_normal = (p[1] - p[0]).cross(p[2] - p[0]);
+					PxVec3 new_normal = (q[1] - q[0]).cross(q[2] - q[0]);
+					if (new_normal.magnitudeSquared() <= old_normal.magnitudeSquared() * 1e-6f)
+						return false;
+					if (old_normal.getNormalized().dot(new_normal.getNormalized()) < min_normal_dot)
+						return false;
+				}
+			}
+
+			return true;
+		}
+
+		void Apply(PxU32 v0, PxU32 v1, const PxVec3& position)
+		{
+			positions[v0] = position;
+			quadrics[v0] += quadrics[v1];
+
+			for (PxU32 i = 0; i < vertex_trigs[v1].size(); i++)
+			{
+				PxU32 trig = vertex_trigs[v1][i];
+				if (HasVertex(trig, v0))
+				{
+					trig_removed[trig] = true;
+					for (PxU32 k = 0; k < 3; k++)
+					{
+						vector<PxU32>& list = vertex_trigs[indices[trig * 3 + k]];
+						if (indices[trig * 3 + k] != v1)
+							list.erase(remove(list.begin(), list.end(), trig), list.end());
+					}
+				}
+				else
+				{
+					for (PxU32 k = 0; k < 3; k++)
+						if (indices[trig * 3 + k] == v1)
+							indices[trig * 3 + k] = v0;
+					vertex_trigs[v0].push_back(trig);
+				}
+			}
+
+			vertex_trigs[v1].clear();
+			vertex_removed[v1] = true;
+			stamps[v0]++;
+			stamps[v1]++;
+
+			vector<PxU32> neighbours;
+			Neighbours(v0, neighbours);
+			for (PxU32 i = 0; i < neighbours.size(); i++)
+				QueueCollapse(v0, neighbours[i]);
+		}
+
+	public:
+		Simplifier(const vector<PxVec3>& verts, const vector<PxU32>& trigs, const vector<PxMaterialTableIndex>& trig_materials, PxReal max_error)
+			: max_cost((double)max_error * max_error)
+		{
+			Weld(verts, trigs, trig_materials);
+			BuildQuadrics();
+			stamps.assign(positions.size(), 0);
+			vertex_removed.assign(positions.size(), false);
+			trig_removed.assign(indices.size() / 3, false);
+		}
+
+		void Run()
+		{
+			vector<PxU32> neighbours;
+			for (PxU32 v = 0; v < positions.size(); v++)
+			{
+				Neighbours(v, neighbours);
+				for (PxU32 i = 0; i < neighbours.size(); i++)
+					if (v < neighbours[i])
+						QueueCollapse(v, neighbours[i]);
+			}
+
+			//the queue only holds collapses within the tolerance, so it simply runs dry
+			while (!queue.empty())
+			{
+				Collapse collapse = queue.top();
+				queue.pop();
+
+				if (vertex_removed[collapse.v0] || vertex_removed[collapse.v1] ||
+					(stamps[collapse.v0] != collapse.stamp0) || (stamps[collapse.v1] != collapse.stamp1))
+					continue;
+
+				if (CanCollapse(collapse.v0, collapse.v1, collapse.position))
+					Apply(collapse.v0, collapse.v1, collapse.position);
+			}
+		}
+
+		PxU32 Output(vector<PxVec3>& out_verts, vector<PxU32>& out_trigs, vector<PxMaterialTableIndex>& out_materials) const
+		{
+			vector<PxU32> remap(positions.size(), PX_MAX_U32);
+			out_verts.clear();
+			out_trigs.clear();
+			out_materials.clear();
+
+			for (PxU32 t = 0; t < trig_removed.size(); t++)
+			{
+				if (trig_removed[t])
+					continue;
+				out_materials.push_back(materials[t]);
+				for (PxU32 k = 0; k < 3; k++)
+				{
+					PxU32 v = indices[t * 3 + k];
+					if (remap[v] == PX_MAX_U32)
+					{
+						remap[v] = (PxU32)out_verts.size();
+						out_verts.push_back(positions[v]);
+					}
+					out_trigs.push_back(remap[v]);
+				}
+			}
+
+			return (PxU32)out_trigs.size() / 3;
+		}
+	};
+
+	PxU32 SimplifyMesh(const vector<PxVec3>& verts, const vector<PxU32>& trigs, PxReal max_error,
+		vector<PxVec3>& out_verts, vector<PxU32>& out_trigs)
+	{
+		vector<PxMaterialTableIndex> out_materials;
+		return SimplifyMesh(verts, trigs, vector<PxMaterialTableIndex>(), max_error, out_verts, out_trigs, out_materials);
+	}
+
+	PxU32 SimplifyMesh(const vector<PxVec3>& verts, const vector<PxU32>& trigs, const vector<PxMaterialTableIndex>& materials,
+		PxReal max_error, vector<PxVec3>& out_verts, vector<PxU32>& out_trigs, vector<PxMaterialTableIndex>& out_materials)
+	{
+		Simplifier simplifier(verts, trigs, materials, max_error);
+		simplifier.Run();
+		return simplifier.Output(out_verts, out_trigs, out_materials);
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///Simplify a triangle mesh by quadric edge collapses (Garland-Heckbert)
+	///Edges are collapsed in order of increasing quadric error until the next collapse would move the surface
+	///further than max_error from the planes of the original triangles. Coplanar triangles have no error,
+	///so flat regions are merged exactly; creases and open borders are kept. Returns the number of triangles left.
+	PxU32 SimplifyMesh(const vector<PxVec3>& verts, const vector<PxU32>& trigs, PxReal max_error,
+		vector<PxVec3>& out_verts, vector<PxU32>& out_trigs);
+
+	///Same as above for a mesh with per-triangle materials, the borders between materials are kept like open borders
+	PxU32 SimplifyMesh(const vector<PxVec3>& verts, const vector<PxU32>& trigs, const vector<PxMaterialTableIndex>& materials,
+		PxReal max_error, vector<PxVec3>& out_verts, vector<PxU32>& out_trigs, vector<PxMaterialTableIndex>& out_materials);
+}
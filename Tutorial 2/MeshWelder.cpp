@@ -0,0 +1,177 @@
+#include "MeshWelder.h"
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	static inline PxU64 CellKey(PxI64 x, PxI64 y, PxI64 z)
+	{
+		return ((PxU64)x * 73856093ULL) ^ ((PxU64)y * 19349663ULL) ^ ((PxU64)z * 83492791ULL);
+	}
+
+	//key of an exact position, -0 and 0 are the same position
+	static inline PxU64 PositionKey(const PxVec3& p)
+	{
+		PxU32 bits[3];
+		PxReal values[3] = { p.x + 0.f, p.y + 0.f, p.z + 0.f };
+		memcpy(bits, values, sizeof(bits));
+		return CellKey(bits[0], bits[1], bits[2]);
+	}
+
+	//corners of a triangle rotated so that the smallest index comes first, keeps the winding, returns the first corner
+	static inline PxU32 CanonicalTriangle(const PxU32* t, PxU32* out)
+	{
+		PxU32 first = (t[1] < t[0]) ? ((t[2] < t[1]) ? 2 : 1) : ((t[2] < t[0]) ? 2 : 0);
+		for (PxU32 k = 0; k < 3; k++)
+			out[k] = t[(first + k) % 3];
+		return first;
+	}
+
+	WeldStats WeldMesh(vector<PxVec3>& vertices, vector<PxU32>& indices, PxReal epsilon, vector<PxU32>* corners)
+	{
+		WeldStats stats;
+		stats.input_vertices = (PxU32)vertices.size();
+		stats.input_triangles = (PxU32)indices.size() / 3;
+
+		//map every vertex to the first one within epsilon
+		vector<PxVec3> welded;
+		vector<PxU32> remap(vertices.size());
+		unordered_multimap<PxU64, PxU32> cells;
+		cells.reserve(vertices.size());
+		PxReal epsilon_squared = epsilon * epsilon;
+
+		for (PxU32 i = 0; i < vertices.size(); i++)
+		{
+			const PxVec3& p = vertices[i];
+			PxU32 found = (PxU32)welded.size();
+
+			if (epsilon > 0.f)
+			{
+				//cells are twice the epsilon, so the box of radius epsilon around the vertex touches at most two cells per axis
+				PxReal cell_size = 2.f * epsilon;
+				PxI64 x0 = (PxI64)PxFloor((p.x - epsilon) / cell_size), x1 = (PxI64)PxFloor((p.x + epsilon) / cell_size);
+				PxI64 y0 = (PxI64)PxFloor((p.y - epsilon) / cell_size), y1 = (PxI64)PxFloor((p.y + epsilon) / cell_size);
+				PxI64 z0 = (PxI64)PxFloor((p.z - epsilon) / cell_size), z1 = (PxI64)PxFloor((p.z + epsilon) / cell_size);
+				for (PxI64 x = x0; (x <= x1) && (found == welded.size()); x++)
+					for (PxI64 y = y0; (y <= y1) && (found == welded.size()); y++)
+						for (PxI64 z = z0; (z <= z1) && (found == welded.size()); z++)
+						{
+							pair<unordered_multimap<PxU64, PxU32>::iterator, unordered_multimap<PxU64, PxU32>::iterator> range =
+								cells.equal_range(CellKey(x, y, z));
+							for (unordered_multimap<PxU64, PxU32>::iterator it = range.first; it != range.second; it++)
+								if ((welded[it->second] - p).magnitudeSquared() <= epsilon_squared)
+								{
+									found = it->second;
+									break;
+								}
+						}
+
+				if (found == welded.size())
+					cells.insert(make_pair(CellKey((PxI64)PxFloor(p.x / cell_size), (PxI64)PxFloor(p.y / cell_size), (PxI64)PxFloor(p.z / cell_size)), found));
+			}
+			else
+			{
+				PxU64 key = PositionKey(p);
+				pair<unordered_multimap<PxU64, PxU32>::iterator, unordered_multimap<PxU64, PxU32>::iterator> range = cells.equal_range(key);
+				for (unordered_multimap<PxU64, PxU32>::iterator it = range.first; it != range.second; it++)
+					if (welded[it->second] == p)
+					{
+						found = it->second;
+						break;
+					}
+
+				if (found == welded.size())
+					cells.insert(make_pair(key, found));
+			}
+
+			if (found == welded.size())
+				welded.push_back(p);
+			remap[i] = found;
+		}
+
+		//drop degenerate triangles
+		vector<PxU32> trigs;
+		vector<PxU32> trig_corners;
+		trigs.reserve(indices.size());
+		if (corners)
+			trig_corners.reserve(indices.size());
+		for (PxU32 t = 0; t + 2 < indices.size(); t += 3)
+		{
+			PxU32 a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+			if ((a == b) || (b == c) || (a == c) || ((welded[b] - welded[a]).cross(welded[c] - welded[a]).magnitudeSquared() == 0.f))
+			{
+				stats.degenerate_triangles++;
+				continue;
+			}
+			PxU32 trig[3] = { a, b, c };
+			PxU32 canonical[3];
+			PxU32 first = CanonicalTriangle(trig, canonical);
+			trigs.insert(trigs.end(), canonical, canonical + 3);
+			if (corners)
+				for (PxU32 k = 0; k < 3; k++)
+					trig_corners.push_back(t + (first + k) % 3);
+		}
+
+		//sort the triangles to find the duplicates, the first of a group is kept in its original place
+		PxU32 trig_count = (PxU32)trigs.size() / 3;
+		vector<PxU32> order(trig_count);
+		for (PxU32 i = 0; i < trig_count; i++)
+			order[i] = i;
+		sort(order.begin(), order.end(), [&trigs](PxU32 t0, PxU32 t1)
+		{
+			const PxU32* a = &trigs[t0 * 3];
+			const PxU32* b = &trigs[t1 * 3];
+			if (a[0] != b[0]) return a[0] < b[0];
+			if (a[1] != b[1]) return a[1] < b[1];
+			if (a[2] != b[2]) return a[2] < b[2];
+			return t0 < t1;
+		});
+		vector<bool> keep(trig_count, true);
+		for (PxU32 i = 1; i < trig_count; i++)
+		{
+			if (!memcmp(&trigs[order[i] * 3], &trigs[order[i - 1] * 3], 3 * sizeof(PxU32)))
+			{
+				keep[order[i]] = false;
+				stats.duplicate_triangles++;
+			}
+		}
+
+		//compact the vertices still in use, in their original order
+		vector<PxU32> used(welded.size(), 0xffffffff);
+		for (PxU32 i = 0; i < trig_count; i++)
+			if (keep[i])
+				for (PxU32 k = 0; k < 3; k++)
+					used[trigs[i * 3 + k]] = 0;
+
+		vertices.clear();
+		for (PxU32 i = 0; i < welded.size(); i++)
+		{
+			if (used[i] == 0)
+			{
+				used[i] = (PxU32)vertices.size();
+				vertices.push_back(welded[i]);
+			}
+		}
+
+		indices.clear();
+		if (corners)
+			corners->clear();
+		for (PxU32 i = 0; i < trig_count; i++)
+		{
+			if (!keep[i])
+				continue;
+			for (PxU32 k = 0; k < 3; k++)
+				indices.push_back(used[trigs[i * 3 + k]]);
+			if (corners)
+				corners->insert(corners->end(), trig_corners.begin() + i * 3, trig_corners.begin() + i * 3 + 3);
+		}
+
+		stats.output_vertices = (PxU32)vertices.size();
+		stats.output_triangles = (PxU32)indices.size() / 3;
+		return stats;
+	}
+}
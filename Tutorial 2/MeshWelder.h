@@ -0,0 +1,32 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///What a WeldMesh call removed
+	struct WeldStats
+	{
+		PxU32 input_vertices;
+		PxU32 output_vertices;
+		PxU32 input_triangles;
+		PxU32 output_triangles;
+		//triangles with two corners on the same vertex or no area
+		PxU32 degenerate_triangles;
+		//triangles with the same corners as an earlier one (in any rotation of the same winding)
+		PxU32 duplicate_triangles;
+
+		WeldStats() : input_vertices(0), output_vertices(0), input_triangles(0), output_triangles(0),
+			degenerate_triangles(0), duplicate_triangles(0) {}
+	};
+
+	///Merge the vertices closer than epsilon and remap the indices to them
+	///Positions are looked up in a spatial hash with cells of twice the epsilon, the first vertex of a group is kept.
+	///Degenerate and duplicate triangles are dropped and vertices no triangle uses are removed.
+	///An epsilon of 0 merges exactly equal positions only (the seams of exported models).
+	///Corners (if given) receives the input corner of every output index, to carry per-corner attributes along.
+	WeldStats WeldMesh(vector<PxVec3>& vertices, vector<PxU32>& indices, PxReal epsilon=1e-5f, vector<PxU32>* corners=0);
+}
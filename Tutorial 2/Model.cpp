@@ -0,0 +1,238 @@
+#include "Model.h"
+#include "ObjParser.h"
+#include "BinaryMesh.h"
+#include <unordered_map>
+#include <algorithm>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	//position, texture coordinate and normal index of a corner
+	struct CornerKey
+	{
+		PxU32 indices[3];
+
+		bool operator==(const CornerKey& key) const
+		{
+			return (indices[0] == key.indices[0]) && (indices[1] == key.indices[1]) && (indices[2] == key.indices[2]);
+		}
+	};
+
+	struct CornerKeyHash
+	{
+		size_t operator()(const CornerKey& key) const
+		{
+			return (size_t)(((PxU64)key.indices[0] * 73856093ULL) ^ ((PxU64)key.indices[1] * 19349663ULL) ^ ((PxU64)key.indices[2] * 83492791ULL));
+		}
+	};
+
+	//a corner shared by the flat shaded triangles with the same normal and material around a position
+	struct FlatCornerKey
+	{
+		PxU32 index;
+		PxU32 material;
+		PxI32 normal[3];
+
+		bool operator==(const FlatCornerKey& key) const
+		{
+			return (index == key.index) && (material == key.material) && (normal[0] == key.normal[0]) &&
+				(normal[1] == key.normal[1]) && (normal[2] == key.normal[2]);
+		}
+	};
+
+	struct FlatCornerKeyHash
+	{
+		size_t operator()(const FlatCornerKey& key) const
+		{
+			return (size_t)(((PxU64)key.index * 73856093ULL) ^ ((PxU64)key.material * 19349663ULL) ^
+				((PxU64)(PxU32)key.normal[0] * 83492791ULL) ^ ((PxU64)(PxU32)key.normal[1] * 2654435761ULL) ^ (PxU64)(PxU32)key.normal[2]);
+		}
+	};
+
+	//area weighted normals of the positions
+	static vector<PxVec3> SmoothNormals(const PxVec3* positions, PxU32 position_count, const PxU32* indices, PxU32 index_count)
+	{
+		vector<PxVec3> normals(position_count, PxVec3(0.f));
+		for (PxU32 t = 0; t + 2 < index_count; t += 3)
+		{
+			const PxVec3& v0 = positions[indices[t]];
+			PxVec3 normal = (positions[indices[t + 1]] - v0).cross(positions[indices[t + 2]] - v0);
+			for (PxU32 k = 0; k < 3; k++)
+				normals[indices[t + k]] += normal;
+		}
+		for (PxU32 i = 0; i < normals.size(); i++)
+			normals[i].normalizeSafe();
+		return normals;
+	}
+
+	bool Model::Load(const string& path)
+	{
+		ObjModel obj;
+		if (!LoadOBJFile(path, obj))
+			return false;
+		Load(obj);
+		return true;
+	}
+
+	void Model::Load(const ObjModel& obj)
+	{
+		//smooth normals of the positions, used by the corners without one
+		vector<PxVec3> smooth_normals;
+		if (find(obj.normal_indices.begin(), obj.normal_indices.end(), ObjModel::no_index) != obj.normal_indices.end())
+			smooth_normals = SmoothNormals(obj.vertices.data(), (PxU32)obj.vertices.size(), obj.indices.data(), (PxU32)obj.indices.size());
+
+		//one vertex per distinct corner
+		vertices.clear();
+		vector<PxU32> indices(obj.indices.size());
+		unordered_map<CornerKey, PxU32, CornerKeyHash> corners;
+		corners.reserve(obj.vertices.size());
+		for (PxU32 i = 0; i < obj.indices.size(); i++)
+		{
+			CornerKey key = { { obj.indices[i], obj.texcoord_indices[i], obj.normal_indices[i] } };
+			pair<unordered_map<CornerKey, PxU32, CornerKeyHash>::iterator, bool> found = corners.insert(make_pair(key, (PxU32)vertices.size()));
+			if (found.second)
+			{
+				Vertex vertex;
+				vertex.position = obj.vertices[key.indices[0]];
+				vertex.texcoord = (key.indices[1] != ObjModel::no_index) ? obj.texcoords[key.indices[1]] : PxVec2(0.f, 0.f);
+				vertex.normal = (key.indices[2] != ObjModel::no_index) ? obj.normals[key.indices[2]] : smooth_normals[key.indices[0]];
+				vertices.push_back(vertex);
+			}
+			indices[i] = found.first->second;
+		}
+
+		materials.clear();
+		SetIndices(indices);
+	}
+
+	void Model::Load(const BinaryMesh& mesh)
+	{
+		const PxVec3* positions = mesh.Vertices();
+		const PxU32 vertex_count = mesh.VertexCount();
+		vector<PxVec3> smooth_normals;
+		const PxVec3* normals = mesh.Normals();
+		if (mesh.NormalCount() != vertex_count)
+		{
+			smooth_normals = SmoothNormals(positions, vertex_count, mesh.Indices(), mesh.IndexCount());
+			normals = smooth_normals.data();
+		}
+		const PxVec2* texcoords = (mesh.TexcoordCount() == vertex_count) ? mesh.Texcoords() : 0;
+
+		vertices.resize(vertex_count);
+		for (PxU32 i = 0; i < vertex_count; i++)
+		{
+			vertices[i].position = positions[i];
+			vertices[i].normal = normals[i];
+			vertices[i].texcoord = texcoords ? texcoords[i] : PxVec2(0.f, 0.f);
+		}
+
+		vector<PxU32> indices(mesh.Indices(), mesh.Indices() + mesh.IndexCount());
+		materials.clear();
+		SetIndices(indices);
+	}
+
+	void Model::Load(const vector<PxVec3>& positions, const vector<PxU32>& triangles, const vector<PxMaterialTableIndex>& triangle_materials)
+	{
+		//the normals are snapped before they are compared, so nearly coplanar triangles share their corners too
+		vertices.clear();
+		vector<PxU32> indices(triangles.size());
+		unordered_map<FlatCornerKey, PxU32, FlatCornerKeyHash> corners;
+		corners.reserve(triangles.size() * 2 / 3);
+		for (PxU32 t = 0; t + 2 < triangles.size(); t += 3)
+		{
+			const PxVec3& v0 = positions[triangles[t]];
+			PxVec3 normal = (positions[triangles[t + 1]] - v0).cross(positions[triangles[t + 2]] - v0);
+			normal.normalizeSafe();
+			PxU32 material = triangle_materials.empty() ? 0 : triangle_materials[t / 3];
+
+			for (PxU32 k = 0; k < 3; k++)
+			{
+				FlatCornerKey key = { triangles[t + k], material,
+					{ (PxI32)PxFloor(normal.x * 4096.f + .5f), (PxI32)PxFloor(normal.y * 4096.f + .5f), (PxI32)PxFloor(normal.z * 4096.f + .5f) } };
+				pair<unordered_map<FlatCornerKey, PxU32, FlatCornerKeyHash>::iterator, bool> found = corners.insert(make_pair(key, (PxU32)vertices.size()));
+				if (found.second)
+				{
+					Vertex vertex;
+					vertex.position = positions[triangles[t + k]];
+					vertex.normal = normal;
+					vertex.texcoord = PxVec2(0.f, 0.f);
+					vertices.push_back(vertex);
+				}
+				indices[t + k] = found.first->second;
+			}
+		}
+
+		materials = triangle_materials;
+		SetIndices(indices);
+	}
+
+	void Model::Scale(const PxVec3& scale)
+	{
+		//normals transform with the inverse transpose, which for a scale is the inverse scale
+		PxVec3 normal_scale(1.f / scale.x, 1.f / scale.y, 1.f / scale.z);
+		for (PxU32 i = 0; i < vertices.size(); i++)
+		{
+			vertices[i].position = vertices[i].position.multiply(scale);
+			vertices[i].normal = vertices[i].normal.multiply(normal_scale);
+			vertices[i].normal.normalizeSafe();
+		}
+	}
+
+	void Model::SetIndices(vector<PxU32>& indices)
+	{
+		indices16.clear();
+		indices32.clear();
+		if (Has16BitIndices())
+			indices16.assign(indices.begin(), indices.end());
+		else
+			indices32.swap(indices);
+	}
+
+	const void* Model::IndexData() const
+	{
+		if (Has16BitIndices())
+			return indices16.empty() ? 0 : &indices16.front();
+		return indices32.empty() ? 0 : &indices32.front();
+	}
+
+	PxBounds3 Model::Bounds() const
+	{
+		PxBounds3 bounds = PxBounds3::empty();
+		for (PxU32 i = 0; i < vertices.size(); i++)
+			bounds.include(vertices[i].position);
+		return bounds;
+	}
+
+	PxTriangleMeshDesc Model::TriangleMeshDesc() const
+	{
+		PxTriangleMeshDesc mesh_desc;
+		mesh_desc.points.count = VertexCount();
+		mesh_desc.points.stride = sizeof(Vertex);
+		mesh_desc.points.data = vertices.empty() ? 0 : &vertices.front().position;
+		mesh_desc.triangles.count = TriangleCount();
+		mesh_desc.triangles.data = IndexData();
+		if (Has16BitIndices())
+		{
+			mesh_desc.triangles.stride = 3 * sizeof(PxU16);
+			mesh_desc.flags |= PxMeshFlag::e16_BIT_INDICES;
+		}
+		else
+		{
+			mesh_desc.triangles.stride = 3 * sizeof(PxU32);
+		}
+		return mesh_desc;
+	}
+
+	PxConvexMeshDesc Model::ConvexMeshDesc() const
+	{
+		PxConvexMeshDesc mesh_desc;
+		mesh_desc.points.count = VertexCount();
+		mesh_desc.points.stride = sizeof(Vertex);
+		mesh_desc.points.data = vertices.empty() ? 0 : &vertices.front().position;
+		mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+		mesh_desc.vertexLimit = 256;
+		return mesh_desc;
+	}
+}
@@ -1,48 +1,86 @@
 #pragma once
 #include <vector>
-#include "PhysicsEngine.h"
-#include <iomanip>
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <vector>
 #include <string>
+#include "PhysicsEngine.h"
+#include "Vertex.h"
 
 namespace PhysicsEngine {
 
 	using namespace std;
 
+	struct ObjModel;
+	class BinaryMesh;
+
+	///Renderable model: an interleaved vertex array and a triangle index buffer
+	///Every distinct position/texture coordinate/normal combination of the .obj corners becomes one Vertex.
+	///Indices are 16-bit when the model has at most 65535 vertices and 32-bit otherwise. The same arrays are
+	///handed to the cooker through a strided view, so one load feeds both rendering and collisions.
 	class Model {
 	public:
+		Model() {}
 
-		Model(char* path)
+		///Load an .obj model, throws an Exception if it cannot be opened or is malformed
+		explicit Model(const string& path)
 		{
-			this->loadModel(path);
+			if (!Load(path))
+				throw new Exception("Model::Model, cannot open " + path + ".");
 		}
 
-		vector<PxVec3> vertices;
-		vector<PxU32> indices;
-		vector<PxVec2> texCords;
-		vector<PxVec3> normals;
+		///Load an .obj model, returns false if it cannot be opened
+		///Corners without a normal get the smooth normal of the triangles around their position.
+		bool Load(const string& path);
 
-		vector<PxReal> modelData;
+		///Build the model from a parsed .obj model (see above)
+		void Load(const ObjModel& obj);
 
-	private:
-		//vector<Mesh> meshes;
-		string directory;
+		///Build the model from a converted mesh, which has a normal (and a texture coordinate) per vertex already
+		///Meshes converted without normals get smooth ones.
+		void Load(const BinaryMesh& mesh);
 
-		void loadModel(string path)
-		{
-			std::ifstream in(path, std::ios::in);
-			if (!in)
-			{
-				std::cout << ".obj file cannot be opened " << path << std::endl;
-				exit(1);
-			}
+		///Build a flat shaded model from positions and triangles, with a material index per triangle or none
+		///The corners around a position share a vertex where their triangles have the same normal and material.
+		void Load(const vector<PxVec3>& positions, const vector<PxU32>& triangles,
+			const vector<PxMaterialTableIndex>& triangle_materials=vector<PxMaterialTableIndex>());
 
-			this->directory = path.substr(0, (path.find_last_of('/') + 1));
+		///Scale the positions, the normals follow non-uniform scales
+		void Scale(const PxVec3& scale);
 
-			
-		}
+		///Interleaved vertices
+		const vector<Vertex>& Vertices() const { return vertices; }
+
+		PxU32 VertexCount() const { return (PxU32)vertices.size(); }
+
+		PxU32 IndexCount() const { return (PxU32)(Has16BitIndices() ? indices16.size() : indices32.size()); }
+
+		PxU32 TriangleCount() const { return IndexCount() / 3; }
+
+		///Are the indices stored as PxU16?
+		bool Has16BitIndices() const { return vertices.size() <= 0xffff; }
+
+		///Index buffer, PxU16 or PxU32 elements (see Has16BitIndices)
+		const void* IndexData() const;
+
+		///Get a single index
+		PxU32 Index(PxU32 i) const { return Has16BitIndices() ? indices16[i] : indices32[i]; }
+
+		///Material index of every triangle, empty if the model has a single material
+		const vector<PxMaterialTableIndex>& Materials() const { return materials; }
+
+		///Bounds of the vertex positions
+		PxBounds3 Bounds() const;
+
+		///Cooking description reading the positions out of the interleaved vertices, valid while the model is alive
+		PxTriangleMeshDesc TriangleMeshDesc() const;
+
+		///Cooking description of the convex hull of the positions, valid while the model is alive
+		PxConvexMeshDesc ConvexMeshDesc() const;
+
+	private:
+		vector<Vertex> vertices;
+		vector<PxU16> indices16;
+		vector<PxU32> indices32;
+		vector<PxMaterialTableIndex> materials;
+
+		void SetIndices(vector<PxU32>& indices);
 	};
-}
\ No newline at end of file
+}
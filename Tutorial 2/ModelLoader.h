@@ -10,6 +10,7 @@
 #include <algorithm>
 
 #include "Vertex.h"
+#include "ObjParser.h"
 
 namespace PhysicsEngine
 {
@@ -20,6 +21,18 @@ namespace PhysicsEngine
 	public:
 
 		//Load .obj file
+		//Memory maps the file and parses it in place, much faster than LoadOBJ2 on large models (see --bench obj)
+		//Handles every face form and polygons, throws an Exception if the file cannot be opened or is malformed
+		bool LoadOBJ(const char* filename, std::vector<PxVec3>& vertices, std::vector<PxU32>& indices)
+		{
+			if (!LoadOBJFile(filename, vertices, indices))
+				throw new Exception(std::string("ModelImport::LoadOBJ, cannot open ") + filename + ".");
+			std::cout << "Model: " << filename << " loaded" << std::endl;
+			return true;
+		}
+
+		//Load .obj file (line by line with string streams)
+		//Only reads triangles in v/t/n form, kept as the baseline of --bench obj
 		//Inspiration from https://en.wikibooks.org/wiki/OpenGL_Programming/Modern_OpenGL_Tutorial_Load_OBJ
 
 		bool LoadOBJ2(const char* filename, std::vector<PxVec3>& vertices, std::vector<PxU32>& indices)
@@ -29,7 +42,7 @@ namespace PhysicsEngine
 			if (!in)
 			{
 				std::cout << ".obj file cannot be opened " << filename << std::endl;
-				exit(1);
+				return false;
 			}
 
 			//read the file checking for .obj elements
@@ -91,6 +104,7 @@ namespace PhysicsEngine
 				}
 			}//end of while
 			std::cout << "Model: " << filename << " loaded" << std::endl;
+			return true;
 		}//end of LoadOBJ
 	};
 }
\ No newline at end of file
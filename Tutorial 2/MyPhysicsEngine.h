@@ -2,10 +2,13 @@
 
 #include "BasicActors.h"
 #include "ModelLoader.h"
+#include "MeshLoader.h"
+#include "CourseStreamer.h"
 #include "Model.h"
 #include <iostream>
 #include <string>
 #include <iomanip>
+#include <sstream>
 
 namespace PhysicsEngine
 {
@@ -29,6 +32,11 @@ namespace PhysicsEngine
 			ConvexMesh(vector<PxVec3>(begin(pyramid_verts), end(pyramid_verts)), pose, density)
 		{
 		}
+
+		MeshDynamic(PxConvexMesh* mesh, PxTransform pose = PxTransform(PxIdentity), PxReal density = 1.f) :
+			ConvexMesh(mesh, pose, density)
+		{
+		}
 	};
 
 	class Mesh : public TriangleMesh
@@ -38,6 +46,11 @@ namespace PhysicsEngine
 			TriangleMesh(vector<PxVec3>(begin(pyramid_verts), end(pyramid_verts)), vector<PxU32>(begin(pyramid_trigs), end(pyramid_trigs)), pose)
 		{
 		}
+
+		Mesh(PxTriangleMesh* mesh, PxTransform pose = PxTransform(PxIdentity)) :
+			TriangleMesh(mesh, pose)
+		{
+		}
 	};
 
 	struct TriggerTypes {
@@ -186,11 +199,21 @@ namespace PhysicsEngine
 		Sphere* ball;
 		BoxStatic* hole1, * hole2, * hole3, * pipeExit, * holeFinal;
 		PxMaterial* course_phys_mat, * rail_phys_mat, * ballMaterial, * ice_phys_mat;
-		Mesh* course, * rail, * iceFloor, *ballHolder, *environment;
+		Mesh* ballHolder;
+		CourseStreamer* courseStreamer;
 		MeshDynamic* diamond, * d20, *barrel;
-		ModelImport modelImporter;
+		CompoundConvexMesh* spikeBall;
 		BoxRigid* joint1, * jointBlade;
 
+		//models loaded in the background, the actors are added as their models finish (see CustomUpdate)
+		MeshLoader* loader;
+		PxU32 course_mesh, rail_mesh, ice_floor_mesh, environment_mesh, ball_holder_mesh, diamond_mesh, d20_mesh, barrel_mesh, spike_ball_mesh;
+		PxU32 streamed_meshes;
+		//the first chunks around the balls are in the scene
+		bool course_loaded;
+		//balls held kinematic until there is something to land on
+		vector<DynamicActor*> held_balls;
+
 
 	public:
 
@@ -202,11 +225,16 @@ namespace PhysicsEngine
 
 		//Specify your custom filter shader here!
 		//PxDefaultSimulationFilterShader by default
-		MyScene() : Scene(CustomFilterShader)
+		MyScene() : Scene(CustomFilterShader), courseStreamer(0), loader(0)
 		{
 
 		};
 
+		~MyScene()
+		{
+			ReleaseLoading();
+		}
+
 		///A custom scene class
 		void SetVisualisation()
 		{
@@ -239,6 +267,22 @@ namespace PhysicsEngine
 		//Custom udpate function
 		virtual void CustomUpdate()
 		{
+			if (loader)
+				AddLoadedMeshes();
+
+			if (courseStreamer)
+			{
+				courseStreamer->Update(courseStreamer->BallFocus());
+				if (!course_loaded && (courseStreamer->LoadingChunks() == 0))
+				{
+					course_loaded = true;
+					cout << "CourseStreamer: " << courseStreamer->LoadedChunks() << " of " << courseStreamer->ChunkCount() << " chunks loaded" << endl;
+				}
+			}
+
+			if (!held_balls.empty() && CourseReady())
+				ReleaseBalls();
+
 			//float rotationValue = PxSin(0.01f * px_scene->getTimestamp());
 
 			//joint1->GetShape()->setLocalPose(PxTransform(PxQuat(rotationValue, PxVec3(0, 0, 1.f))));
@@ -246,6 +290,12 @@ namespace PhysicsEngine
 
 		void ObjectInit()
 		{
+			//a reset starts the loading again
+			ReleaseLoading();
+			ballHolder = 0;
+			streamed_meshes = 0;
+			course_loaded = false;
+
 			plane = new Plane();
 			plane->Color(PxVec3(210.f / 255.f, 210.f / 255.f, 210.f / 255.f));
 			//plane->Material(groundMaterial);
@@ -295,105 +345,179 @@ namespace PhysicsEngine
 			pipeExit->SetTrigger(true);
 			Add(pipeExit);
 
-			modelImporter.LoadOBJ2("..//Assets//Models//Course.obj", pyramid_verts, pyramid_trigs);
-
-			course = new Mesh(PxTransform(0, 0, 0));
-			course->Color(color_palette[2]);
-			course->Material(course_phys_mat);
-			course->Name("Course");
-			course->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES, 0);
-			Add(course);
+			//the balls wait for the course, see HoldBall
+			HoldBall(ball);
+
+			//parse and cook all the models in parallel in the background, the window shows up straight away
+			//and the actors are added by CustomUpdate as their models finish
+			loader = new MeshLoader();
+			course_mesh = loader->Add("..//Assets//Models//Course.obj", MeshType::STREAMED);
+			rail_mesh = loader->Add("..//Assets//Models//Railing.obj", MeshType::STREAMED);
+			ice_floor_mesh = loader->Add("..//Assets//Models//Ice Floor.obj", MeshType::STREAMED);
+			environment_mesh = loader->Add("..//Assets//Models//Environment.obj", MeshType::STREAMED);
+			ball_holder_mesh = loader->Add("..//Assets//Models//Ball Holder.obj", MeshType::TRIANGLE);
+			diamond_mesh = loader->Add("..//Assets//Models//Diamond.obj", MeshType::CONVEX);
+			d20_mesh = loader->Add("..//Assets//Models//D20.obj", MeshType::CONVEX);
+			barrel_mesh = loader->Add("..//Assets//Models//Barrel.obj", MeshType::CONVEX);
+			//the spike ball is concave, a single convex hull would fill in the gaps between the spikes
+			spike_ball_mesh = loader->Add("..//Assets//Models//SpikeBall.obj", MeshType::COMPOUND);
+			loader->Start();
 
-			pyramid_verts.clear();
-			pyramid_trigs.clear();
-
-			modelImporter.LoadOBJ2("..//Assets//Models//Railing.obj", pyramid_verts, pyramid_trigs);
-
-			rail = new Mesh(PxTransform(0, 0, 0));
-			rail->Color(color_palette[3]);
-			rail->Material(rail_phys_mat);
-			course->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES, 0);
-			rail->Name("Railing");
-			Add(rail);
-
-			pyramid_verts.clear();
-			pyramid_trigs.clear();
-
-			modelImporter.LoadOBJ2("..//Assets//Models//Ice Floor.obj", pyramid_verts, pyramid_trigs);
-
-			iceFloor = new Mesh(PxTransform(0, 0, 0));
-			iceFloor->Color(color_palette[4]);
-			iceFloor->Material(ice_phys_mat);
-			iceFloor->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES, 0);
-			iceFloor->Name("Ice Floor");
-			Add(iceFloor);
-
-
-			pyramid_verts.clear();
-			pyramid_trigs.clear();
-
-			modelImporter.LoadOBJ2("..//Assets//Models//Environment.obj", pyramid_verts, pyramid_trigs);
-
-			environment = new Mesh(PxTransform(0, 0, 0));
-			environment->Color(color_palette[4]);
-			environment->Material(ice_phys_mat);
-			environment->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES, 0);
-			environment->Name("Environment Detail");
-			Add(environment);
-
-			pyramid_verts.clear();
-			pyramid_trigs.clear();
-
-			modelImporter.LoadOBJ2("..//Assets//Models//Ball Holder.obj", pyramid_verts, pyramid_trigs);
+			//joint1 = new BoxRigid(PxTransform(0, 15, -40));
+			//joint1->SetKinematic(true);
+			//Add(joint1);
 
-			ballHolder = new Mesh(PxTransform(0, 0, 100));
-			Add(ballHolder);
+			//jointBlade = new BoxRigid(PxTransform(0, 10, -40), PxVec3(5, 2.5f, .1f));
+			////jointBlade->SetKinematic(true);
+			//Add(jointBlade);
+		}
 
-			pyramid_verts.clear();
-			pyramid_trigs.clear();
+		///Are the assets still loading?
+		bool Loading() const
+		{
+			return (loader != 0) || !course_loaded;
+		}
 
-			modelImporter.LoadOBJ2("..//Assets//Models//Diamond.obj", pyramid_verts, pyramid_trigs);
+		///Loading progress for the HUD
+		string LoadingStatus() const
+		{
+			ostringstream status;
+			if (loader)
+				status << "Loading models: " << loader->FinishedCount() << " of " << loader->Size();
+			else if (courseStreamer)
+				status << "Loading course: " << courseStreamer->LoadedChunks() << " chunks, " << courseStreamer->LoadingChunks() << " cooking";
+			return status.str();
+		}
 
-			diamond = new MeshDynamic(PxTransform(0, 1, 100), 6.3f);
-			diamond->Color(color_palette[0]);
-			diamond->Material(ballMaterial);
-			diamond->SetAngularDamping(2.0f);
-			diamond->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES | FilterGroup::TRAPS, 0);
-			diamond->Name("Diamond");
-			Add(diamond);
+	private:
+		//wait for the models and chunks being loaded and drop the streamed course
+		void ReleaseLoading()
+		{
+			delete loader;
+			loader = 0;
+			delete courseStreamer;
+			courseStreamer = 0;
+			held_balls.clear();
+		}
 
-			pyramid_verts.clear();
-			pyramid_trigs.clear();
+		//the course and the ball holder are in the scene
+		bool CourseReady() const
+		{
+			return course_loaded && ballHolder;
+		}
 
-			modelImporter.LoadOBJ2("..//Assets//Models//D20.obj", pyramid_verts, pyramid_trigs);
+		//keep a ball in place until the course is ready, the balls must not fall through it
+		void HoldBall(DynamicActor* actor)
+		{
+			if (CourseReady())
+				return;
+			actor->SetKinematic(true);
+			held_balls.push_back(actor);
+		}
 
-			d20 = new MeshDynamic(PxTransform(0, 1, 100), 4.1f);
-			d20->Color(color_palette[0]);
-			d20->Material(ballMaterial);
-			d20->SetAngularDamping(2.0f);
-			d20->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES | FilterGroup::TRAPS, 0);
-			d20->Name("D20");
-			Add(d20);
+		void ReleaseBalls()
+		{
+			for (PxU32 i = 0; i < held_balls.size(); i++)
+			{
+				held_balls[i]->SetKinematic(false);
+				((PxRigidDynamic*)held_balls[i]->Get())->wakeUp();
+			}
+			held_balls.clear();
+		}
 
-			pyramid_verts.clear();
-			pyramid_trigs.clear();
-			modelImporter.LoadOBJ2("..//Assets//Models//Barrel.obj", pyramid_verts, pyramid_trigs);
+		//create the actors of the models which finished loading since the last update
+		void AddLoadedMeshes()
+		{
+			//taken before the finished models, so none can finish unseen after the loop
+			bool done = loader->Done();
+			PxU32 index;
+			while (loader->Next(index))
+			{
+				const LoadedMesh& mesh = loader->Get(index);
 
-			barrel = new MeshDynamic(PxTransform(0, 1, 100), 1.f);
-			barrel->Color(color_palette[0]);
-			barrel->Material(ballMaterial);
-			barrel->SetAngularDamping(2.0f);
-			barrel->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES | FilterGroup::TRAPS, 0);
-			barrel->Name("Barrel");
-			Add(barrel);
+				if ((index == course_mesh) || (index == rail_mesh) || (index == ice_floor_mesh) || (index == environment_mesh))
+				{
+					//all layers have to be in before the first chunk is loaded
+					if (++streamed_meshes < 4)
+						continue;
+
+					//the course is streamed in chunks around the balls, see CustomUpdate
+					//the models are merged into one mesh per chunk with a material per model, so every chunk is a single actor
+					//the chunks are cooked once into the cache, so they use the best runtime structure (see --bench cooking)
+					//and collide with a simplified copy of the models (see --bench simplify), the tolerance is well below the radius of the balls
+					StreamingParams streaming;
+					streaming.options = CookingOptions::QualityBVH34();
+					streaming.collision_tolerance = .01f;
+					courseStreamer = new CourseStreamer(this, streaming);
+					courseStreamer->AddLayer(loader->Get(course_mesh).vertices, loader->Get(course_mesh).indices, course_phys_mat, color_palette[2]);
+					courseStreamer->AddLayer(loader->Get(rail_mesh).vertices, loader->Get(rail_mesh).indices, rail_phys_mat, color_palette[3]);
+					courseStreamer->AddLayer(loader->Get(ice_floor_mesh).vertices, loader->Get(ice_floor_mesh).indices, ice_phys_mat, color_palette[4]);
+					courseStreamer->AddLayer(loader->Get(environment_mesh).vertices, loader->Get(environment_mesh).indices, ice_phys_mat, color_palette[4]);
+					courseStreamer->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES);
+				}
+				else if (index == ball_holder_mesh)
+				{
+					ballHolder = new Mesh(mesh.triangle_mesh, PxTransform(0, 0, 100));
+					ballHolder->RenderModel(mesh.render_model);
+					Add(ballHolder);
+				}
+				else if (index == diamond_mesh)
+				{
+					diamond = new MeshDynamic(mesh.convex_mesh, PxTransform(0, 1, 100), 6.3f);
+					diamond->Color(color_palette[0]);
+					diamond->Material(ballMaterial);
+					diamond->SetAngularDamping(2.0f);
+					diamond->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES | FilterGroup::TRAPS, 0);
+					diamond->Name("Diamond");
+					HoldBall(diamond);
+					Add(diamond);
+				}
+				else if (index == d20_mesh)
+				{
+					d20 = new MeshDynamic(mesh.convex_mesh, PxTransform(0, 1, 100), 4.1f);
+					d20->Color(color_palette[0]);
+					d20->Material(ballMaterial);
+					d20->SetAngularDamping(2.0f);
+					d20->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES | FilterGroup::TRAPS, 0);
+					d20->Name("D20");
+					HoldBall(d20);
+					Add(d20);
+				}
+				else if (index == barrel_mesh)
+				{
+					barrel = new MeshDynamic(mesh.convex_mesh, PxTransform(0, 1, 100), 1.f);
+					barrel->Color(color_palette[0]);
+					barrel->Material(ballMaterial);
+					barrel->SetAngularDamping(2.0f);
+					barrel->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES | FilterGroup::TRAPS, 0);
+					barrel->Name("Barrel");
+					HoldBall(barrel);
+					Add(barrel);
+				}
+				else if (index == spike_ball_mesh)
+				{
+					spikeBall = new CompoundConvexMesh(mesh.convex_hulls, PxTransform(0, 1, 100), 1.f);
+					spikeBall->Color(color_palette[0]);
+					spikeBall->Material(ballMaterial);
+					spikeBall->SetAngularDamping(2.0f);
+					//filter every hull, not only the first shape
+					spikeBall->SetupFiltering(FilterGroup::BALL, FilterGroup::HOLES | FilterGroup::TRAPS);
+					spikeBall->Name("SpikeBall");
+					HoldBall(spikeBall);
+					Add(spikeBall);
+				}
+			}
 
-			//joint1 = new BoxRigid(PxTransform(0, 15, -40));
-			//joint1->SetKinematic(true);
-			//Add(joint1);
+			//every actor is in, the streamer keeps its own copy of the course
+			if (done)
+			{
+				loader->Report(cout);
+				delete loader;
+				loader = 0;
 
-			//jointBlade = new BoxRigid(PxTransform(0, 10, -40), PxVec3(5, 2.5f, .1f));
-			////jointBlade->SetKinematic(true);
-			//Add(jointBlade);
+				//no job uses the asset cache now, free the meshes of earlier runs and removed actors
+				GetAssetCache().Collect();
+			}
 		}
 	};
 }
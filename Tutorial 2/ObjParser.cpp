@@ -0,0 +1,440 @@
+#include "ObjParser.h"
+#include "FileIO.h"
+#include "ThreadPool.h"
+#include <charconv>
+#include <cstring>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	static inline const char* SkipSpaces(const char* p, const char* end)
+	{
+		while ((p < end) && ((*p == ' ') || (*p == '\t')))
+			p++;
+		return p;
+	}
+
+	static inline const char* NextLine(const char* p, const char* end)
+	{
+		const char* eol = (const char*)memchr(p, '\n', end - p);
+		return eol ? eol + 1 : end;
+	}
+
+	//is the line a record of the given type ("v ", "vt ", "f ")?
+	static inline bool IsRecord(const char* p, const char* end, const char* type, size_t length)
+	{
+		return ((size_t)(end - p) > length) && !memcmp(p, type, length) && ((p[length] == ' ') || (p[length] == '\t'));
+	}
+
+	//end of the data on a line, comments start with '#'
+	static inline bool IsLineEnd(const char* p, const char* end)
+	{
+		return (p == end) || (*p == '\r') || (*p == '\n') || (*p == '#');
+	}
+
+	static inline const char* ParseFloat(const char* p, const char* end, PxReal& value, bool& valid)
+	{
+		p = SkipSpaces(p, end);
+		if ((p < end) && (*p == '+'))
+			p++;
+		from_chars_result result = from_chars(p, end, value);
+		if (result.ec != errc())
+		{
+			valid = false;
+			return p;
+		}
+		return result.ptr;
+	}
+
+	//number of corners of a face record, one per whitespace separated token
+	static inline size_t CountCorners(const char* p, const char* end)
+	{
+		size_t count = 0;
+		for (p = SkipSpaces(p, end); !IsLineEnd(p, end); p = SkipSpaces(p, end))
+		{
+			count++;
+			while (!IsLineEnd(p, end) && (*p != ' ') && (*p != '\t'))
+				p++;
+		}
+		return count;
+	}
+
+	//a face corner: v, v/t, v//n or v/t/n, the missing indices are 0
+	//returns 0 if the corner is malformed
+	static inline const char* ParseCorner(const char* p, const char* end, PxI32* values)
+	{
+		from_chars_result result = from_chars(p, end, values[0]);
+		if ((result.ec != errc()) || (values[0] == 0))
+			return 0;
+		p = result.ptr;
+
+		values[1] = values[2] = 0;
+		for (PxU32 i = 1; (i < 3) && (p < end) && (*p == '/'); i++)
+		{
+			p++;
+			result = from_chars(p, end, values[i]);
+			if (result.ec == errc())
+				p = result.ptr;
+		}
+
+		if (!IsLineEnd(p, end) && (*p != ' ') && (*p != '\t'))
+			return 0;
+		return p;
+	}
+
+	//.obj indices start at 1, negative indices count back from the last element read
+	//returns false if the index is outside of the elements of the file
+	static inline bool ResolveIndex(PxI32 value, size_t read, size_t total, PxU32& index)
+	{
+		PxI64 resolved = (value > 0) ? (PxI64)value - 1 : (PxI64)read + value;
+		index = (PxU32)resolved;
+		return (resolved >= 0) && (resolved < (PxI64)total);
+	}
+
+	//elements of the file: positions, texture coordinates, normals and face corners
+	struct ObjCounts
+	{
+		size_t vertices;
+		size_t texcoords;
+		size_t normals;
+		size_t indices;
+
+		ObjCounts() : vertices(0), texcoords(0), normals(0), indices(0) {}
+
+		ObjCounts& operator+=(const ObjCounts& counts)
+		{
+			vertices += counts.vertices;
+			texcoords += counts.texcoords;
+			normals += counts.normals;
+			indices += counts.indices;
+			return *this;
+		}
+	};
+
+	//where a chunk writes, the attribute outputs are null when only positions are parsed
+	struct ObjOutput
+	{
+		PxVec3* vertices;
+		PxVec2* texcoords;
+		PxVec3* normals;
+		PxU32* indices;
+		PxU32* texcoord_indices;
+		PxU32* normal_indices;
+	};
+
+	//a piece of the file cut at line boundaries, parsed by one job
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+		size_t line_count;
+		ObjCounts counts;
+		//first malformed line, counted from the start of the chunk (0 = none)
+		size_t error_line;
+		string error;
+	};
+
+	static void CountChunk(ObjChunk& chunk)
+	{
+		chunk.line_count = 0;
+		chunk.counts = ObjCounts();
+		for (const char* line = chunk.begin; line < chunk.end; line = NextLine(line, chunk.end))
+		{
+			chunk.line_count++;
+			const char* p = SkipSpaces(line, chunk.end);
+			if (IsRecord(p, chunk.end, "v", 1))
+			{
+				chunk.counts.vertices++;
+			}
+			else if (IsRecord(p, chunk.end, "vt", 2))
+			{
+				chunk.counts.texcoords++;
+			}
+			else if (IsRecord(p, chunk.end, "vn", 2))
+			{
+				chunk.counts.normals++;
+			}
+			else if (IsRecord(p, chunk.end, "f", 1))
+			{
+				//polygons are split into a fan of triangles
+				size_t corners = CountCorners(p + 2, chunk.end);
+				if (corners >= 3)
+					chunk.counts.indices += (corners - 2) * 3;
+			}
+		}
+	}
+
+	//parse straight into the slice of the output reserved for the chunk
+	//first are the elements in the file before the chunk (for relative indices), total the elements in the whole file
+	static void ParseChunk(ObjChunk& chunk, const ObjCounts& first, const ObjCounts& total, ObjOutput out)
+	{
+		const char* end = chunk.end;
+		ObjCounts read = first;
+		size_t line_number = 0;
+		for (const char* line = chunk.begin; line < end; line = NextLine(line, end))
+		{
+			line_number++;
+			const char* p = SkipSpaces(line, end);
+			if (IsRecord(p, end, "v", 1))
+			{
+				PxVec3& v = *out.vertices++;
+				bool valid = true;
+				p = ParseFloat(p + 2, end, v.x, valid);
+				p = ParseFloat(p, end, v.y, valid);
+				ParseFloat(p, end, v.z, valid);
+				read.vertices++;
+				if (!valid)
+				{
+					chunk.error_line = line_number;
+					chunk.error = "a vertex needs three coordinates";
+					return;
+				}
+			}
+			else if (IsRecord(p, end, "vt", 2))
+			{
+				read.texcoords++;
+				if (!out.texcoords)
+					continue;
+
+				//the optional third coordinate of 3D textures is ignored
+				PxVec2& t = *out.texcoords++;
+				bool valid = true;
+				p = ParseFloat(p + 3, end, t.x, valid);
+				ParseFloat(p, end, t.y, valid);
+				if (!valid)
+				{
+					chunk.error_line = line_number;
+					chunk.error = "a texture coordinate needs two values";
+					return;
+				}
+			}
+			else if (IsRecord(p, end, "vn", 2))
+			{
+				read.normals++;
+				if (!out.normals)
+					continue;
+
+				PxVec3& n = *out.normals++;
+				bool valid = true;
+				p = ParseFloat(p + 3, end, n.x, valid);
+				p = ParseFloat(p, end, n.y, valid);
+				ParseFloat(p, end, n.z, valid);
+				if (!valid)
+				{
+					chunk.error_line = line_number;
+					chunk.error = "a normal needs three coordinates";
+					return;
+				}
+			}
+			else if (IsRecord(p, end, "f", 1))
+			{
+				//corners: position, texture coordinate and normal indices
+				PxU32 first_corner[3] = { 0, 0, 0 }, previous[3] = { 0, 0, 0 }, corners = 0;
+				for (p = SkipSpaces(p + 2, end); !IsLineEnd(p, end); p = SkipSpaces(p, end))
+				{
+					PxI32 values[3];
+					p = ParseCorner(p, end, values);
+					if (!p)
+					{
+						chunk.error_line = line_number;
+						chunk.error = "malformed face corner";
+						return;
+					}
+
+					PxU32 corner[3] = { 0, ObjModel::no_index, ObjModel::no_index };
+					if (!ResolveIndex(values[0], read.vertices, total.vertices, corner[0]))
+					{
+						chunk.error_line = line_number;
+						chunk.error = "face index " + to_string(values[0]) + " is out of range";
+						return;
+					}
+					if (out.texcoord_indices && values[1] && !ResolveIndex(values[1], read.texcoords, total.texcoords, corner[1]))
+					{
+						chunk.error_line = line_number;
+						chunk.error = "texture coordinate index " + to_string(values[1]) + " is out of range";
+						return;
+					}
+					if (out.normal_indices && values[2] && !ResolveIndex(values[2], read.normals, total.normals, corner[2]))
+					{
+						chunk.error_line = line_number;
+						chunk.error = "normal index " + to_string(values[2]) + " is out of range";
+						return;
+					}
+
+					if (corners >= 2)
+					{
+						const PxU32* fan[3] = { first_corner, previous, corner };
+						for (PxU32 k = 0; k < 3; k++)
+						{
+							*out.indices++ = fan[k][0];
+							if (out.texcoord_indices)
+								*out.texcoord_indices++ = fan[k][1];
+							if (out.normal_indices)
+								*out.normal_indices++ = fan[k][2];
+						}
+					}
+					else if (corners == 0)
+					{
+						memcpy(first_corner, corner, sizeof(corner));
+					}
+					memcpy(previous, corner, sizeof(corner));
+					corners++;
+				}
+
+				if (corners < 3)
+				{
+					chunk.error_line = line_number;
+					chunk.error = "a face needs at least three corners";
+					return;
+				}
+			}
+		}
+	}
+
+	//offset an output by the elements before a chunk, null outputs stay null
+	template<class T>
+	static inline T* Advance(T* output, size_t count)
+	{
+		return output ? output + count : 0;
+	}
+
+	static ObjOutput ChunkOutput(const ObjOutput& out, const ObjCounts& first)
+	{
+		ObjOutput chunk_out;
+		chunk_out.vertices = out.vertices + first.vertices;
+		chunk_out.texcoords = Advance(out.texcoords, first.texcoords);
+		chunk_out.normals = Advance(out.normals, first.normals);
+		chunk_out.indices = out.indices + first.indices;
+		chunk_out.texcoord_indices = Advance(out.texcoord_indices, first.indices);
+		chunk_out.normal_indices = Advance(out.normal_indices, first.indices);
+		return chunk_out;
+	}
+
+	//the chunked parse shared by both outputs, allocate is called with the totals and returns where to write
+	template<class Allocate>
+	static void ParseChunks(const char* data, size_t size, unsigned int thread_count, Allocate allocate)
+	{
+		//small files are not worth the jobs
+		const size_t min_chunk_size = 256 * 1024;
+		const char* end = data + size;
+
+		if (thread_count == 0)
+			thread_count = GetThreadPool().Size();
+		size_t chunk_count = PxMax((size_t)1, PxMin((size_t)thread_count * 4, size / min_chunk_size));
+
+		//cut the file into chunks at the first newline after every even split
+		vector<ObjChunk> chunks;
+		const char* begin = data;
+		for (size_t i = 1; (i <= chunk_count) && (begin < end); i++)
+		{
+			ObjChunk chunk;
+			chunk.begin = begin;
+			chunk.end = (i == chunk_count) ? end : NextLine(PxMax(begin, data + size / chunk_count * i), end);
+			chunk.error_line = 0;
+			chunks.push_back(chunk);
+			begin = chunk.end;
+		}
+
+		//count, then give every chunk its place in the output with a prefix sum over the counts
+		TaskGroup group(GetThreadPool());
+		vector<future<void> > jobs;
+		for (size_t i = 1; i < chunks.size(); i++)
+		{
+			ObjChunk* chunk = &chunks[i];
+			jobs.push_back(group.Submit([chunk] { CountChunk(*chunk); }));
+		}
+		if (!chunks.empty())
+			CountChunk(chunks[0]);
+		group.Wait();
+		for (size_t i = 0; i < jobs.size(); i++)
+			jobs[i].get();
+
+		vector<ObjCounts> firsts(chunks.size());
+		ObjCounts total;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			firsts[i] = total;
+			total += chunks[i].counts;
+		}
+		ObjOutput out = allocate(total);
+
+		jobs.clear();
+		for (size_t i = 1; i < chunks.size(); i++)
+		{
+			ObjChunk* chunk = &chunks[i];
+			ObjCounts first = firsts[i];
+			ObjOutput chunk_out = ChunkOutput(out, first);
+			jobs.push_back(group.Submit([chunk, first, total, chunk_out] { ParseChunk(*chunk, first, total, chunk_out); }));
+		}
+		if (!chunks.empty())
+			ParseChunk(chunks[0], firsts[0], total, out);
+		group.Wait();
+		for (size_t i = 0; i < jobs.size(); i++)
+			jobs[i].get();
+
+		//report the first malformed line of the file
+		size_t first_line = 0;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			if (chunks[i].error_line)
+				throw new Exception("PhysicsEngine::ParseOBJ, line " + to_string(first_line + chunks[i].error_line) + ": " + chunks[i].error + ".");
+			first_line += chunks[i].line_count;
+		}
+	}
+
+	void ParseOBJ(const char* data, size_t size, vector<PxVec3>& vertices, vector<PxU32>& indices, unsigned int thread_count)
+	{
+		ParseChunks(data, size, thread_count, [&vertices, &indices](const ObjCounts& total)
+		{
+			//the indices refer to the vertices of this file, also when appending to a model
+			size_t vertex_start = vertices.size(), index_start = indices.size();
+			vertices.resize(vertex_start + total.vertices);
+			indices.resize(index_start + total.indices);
+
+			ObjOutput out = { vertices.data() + vertex_start, 0, 0, indices.data() + index_start, 0, 0 };
+			return out;
+		});
+	}
+
+	void ParseOBJ(const char* data, size_t size, ObjModel& model, unsigned int thread_count)
+	{
+		ParseChunks(data, size, thread_count, [&model](const ObjCounts& total)
+		{
+			model.vertices.resize(total.vertices);
+			model.texcoords.resize(total.texcoords);
+			model.normals.resize(total.normals);
+			model.indices.resize(total.indices);
+			model.texcoord_indices.resize(total.indices);
+			model.normal_indices.resize(total.indices);
+
+			ObjOutput out = { model.vertices.data(), model.texcoords.data(), model.normals.data(),
+				model.indices.data(), model.texcoord_indices.data(), model.normal_indices.data() };
+			return out;
+		});
+	}
+
+	bool LoadOBJFile(const string& path, vector<PxVec3>& vertices, vector<PxU32>& indices)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+		{
+			//empty files cannot be mapped, they are simply empty models
+			return FileExists(path);
+		}
+
+		ParseOBJ((const char*)file.Data(), file.Size(), vertices, indices);
+		return true;
+	}
+
+	bool LoadOBJFile(const string& path, ObjModel& model)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+			return FileExists(path);
+
+		ParseOBJ((const char*)file.Data(), file.Size(), model);
+		return true;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include <vector>
+#include <string>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///Parse the text of an .obj file: vertex positions and the position indices of its faces
+	///Faces can be in any of the v, v/t, v//n and v/t/n forms with absolute or relative (negative) indices, polygons
+	///are split into a fan of triangles. Malformed records throw an Exception naming the line.
+	///The text is scanned in place (no line copies or streams). Large files are cut into chunks at line boundaries
+	///which are counted and parsed in parallel on the thread pool, every chunk writing into its own slice of the output
+	///(placed by a prefix sum over the counts), so the result is identical for any thread count (0 = all workers).
+	void ParseOBJ(const char* data, size_t size, vector<PxVec3>& vertices, vector<PxU32>& indices, unsigned int thread_count=0);
+
+	///Memory map and parse an .obj file, returns false if it cannot be opened (and throws if it is malformed)
+	bool LoadOBJFile(const string& path, vector<PxVec3>& vertices, vector<PxU32>& indices);
+
+	///All attributes of an .obj file, with the texture coordinate and normal index of every triangle corner
+	struct ObjModel
+	{
+		//corners without a texture coordinate or normal
+		static const PxU32 no_index = 0xffffffff;
+
+		vector<PxVec3> vertices;
+		vector<PxVec2> texcoords;
+		vector<PxVec3> normals;
+		vector<PxU32> indices;
+		vector<PxU32> texcoord_indices;
+		vector<PxU32> normal_indices;
+	};
+
+	///Parse the text of an .obj file with its texture coordinates and normals (see above), the model is replaced
+	void ParseOBJ(const char* data, size_t size, ObjModel& model, unsigned int thread_count=0);
+
+	///Memory map and parse an .obj file with its texture coordinates and normals
+	bool LoadOBJFile(const string& path, ObjModel& model);
+}
@@ -1,14 +1,52 @@
 #include "PhysicsEngine.h"
+#include "AssetCache.h"
 #include <iostream>
+#include <sstream>
+#include <mutex>
+#include <atomic>
 
 namespace PhysicsEngine
 {
 	using namespace physx;
 	using namespace std;
 
+	//the default allocator, counting the bytes in use
+	class CountingAllocator : public PxAllocatorCallback
+	{
+		//a header in front of every block keeps its size and the 16 byte alignment PhysX needs
+		static const size_t header_size = 16;
+
+		PxDefaultAllocator allocator;
+		atomic<size_t> allocated;
+
+	public:
+		CountingAllocator() : allocated(0) {}
+
+		void* allocate(size_t size, const char* type_name, const char* filename, int line)
+		{
+			PxU8* block = (PxU8*)allocator.allocate(size + header_size, type_name, filename, line);
+			if (!block)
+				return 0;
+			*(size_t*)block = size;
+			allocated += size;
+			return block + header_size;
+		}
+
+		void deallocate(void* ptr)
+		{
+			if (!ptr)
+				return;
+			PxU8* block = (PxU8*)ptr - header_size;
+			allocated -= *(size_t*)block;
+			allocator.deallocate(block);
+		}
+
+		size_t Allocated() const { return allocated; }
+	};
+
 	//default error and allocator callbacks
 	PxDefaultErrorCallback gDefaultErrorCallback;
-	PxDefaultAllocator gDefaultAllocatorCallback;
+	CountingAllocator gDefaultAllocatorCallback;
 
 	//PhysX objects
 	PxFoundation* foundation = 0;
@@ -19,6 +57,9 @@ namespace PhysicsEngine
 #endif
 	PxPhysics* physics = 0;
 	PxCooking* cooking = 0;
+	//cooking objects for non-default options, created on first use
+	std::vector<std::pair<CookingOptions, PxCooking*> > option_cookings;
+	std::mutex option_cookings_mutex;
 
 	///PhysX functions
 	void PxInit()
@@ -70,6 +111,10 @@ namespace PhysicsEngine
 
 	void PxRelease()
 	{
+		GetAssetCache().Clear();
+		for (unsigned int i = 0; i < option_cookings.size(); i++)
+			option_cookings[i].second->release();
+		option_cookings.clear();
 		if (cooking)
 			cooking->release();
 		if (physics)
@@ -80,6 +125,11 @@ namespace PhysicsEngine
 			foundation->release();
 	}
 
+	size_t PxAllocatedBytes()
+	{
+		return gDefaultAllocatorCallback.Allocated();
+	}
+
 	PxPhysics* GetPhysics() 
 	{ 
 		return physics; 
@@ -90,6 +140,107 @@ namespace PhysicsEngine
 		return cooking;
 	}
 
+	PxCooking* GetCooking(const CookingOptions& options)
+	{
+		if (options == CookingOptions())
+			return cooking;
+
+		//loaders cook from several threads at once
+		std::lock_guard<std::mutex> lock(option_cookings_mutex);
+
+		for (unsigned int i = 0; i < option_cookings.size(); i++)
+			if (option_cookings[i].first == options)
+				return option_cookings[i].second;
+
+		PxCooking* option_cooking = PxCreateCooking(PX_PHYSICS_VERSION, *foundation, options.Params(physics->getTolerancesScale()));
+		if (!option_cooking)
+			throw new Exception("PhysicsEngine::GetCooking, Could not initialise the cooking component.");
+
+		option_cookings.push_back(std::make_pair(options, option_cooking));
+		return option_cooking;
+	}
+
+	///CookingOptions methods
+
+	CookingOptions CookingOptions::Runtime()
+	{
+		CookingOptions options;
+		options.midphase = PxMeshMidPhase::eBVH34;
+		options.clean_mesh = false;
+		options.active_edges = false;
+		options.runtime = true;
+		return options;
+	}
+
+	CookingOptions CookingOptions::QualityBVH33(PxReal weld_tolerance)
+	{
+		CookingOptions options;
+		options.midphase = PxMeshMidPhase::eBVH33;
+		options.weld_tolerance = weld_tolerance;
+		return options;
+	}
+
+	CookingOptions CookingOptions::QualityBVH34(PxReal weld_tolerance)
+	{
+		CookingOptions options;
+		options.midphase = PxMeshMidPhase::eBVH34;
+		options.weld_tolerance = weld_tolerance;
+		return options;
+	}
+
+	PxCookingParams CookingOptions::Params(const PxTolerancesScale& scale) const
+	{
+		PxCookingParams params(scale);
+
+		params.midphaseDesc.setToDefault(midphase);
+		if (midphase == PxMeshMidPhase::eBVH33)
+		{
+			params.midphaseDesc.mBVH33Desc.meshCookingHint = runtime ? PxMeshCookingHint::eCOOKING_PERFORMANCE : PxMeshCookingHint::eSIM_PERFORMANCE;
+		}
+		else
+		{
+			//bigger leaves cook faster and take less memory but are slower to query
+			params.midphaseDesc.mBVH34Desc.numTrisPerLeaf = runtime ? 15 : 4;
+		}
+
+		PxMeshPreprocessingFlags flags;
+		if (!clean_mesh)
+			flags |= PxMeshPreprocessingFlag::eDISABLE_CLEAN_MESH;
+		if (!active_edges)
+			flags |= PxMeshPreprocessingFlag::eDISABLE_ACTIVE_EDGES_PRECOMPUTE;
+		if (clean_mesh && (weld_tolerance > 0.f))
+		{
+			flags |= PxMeshPreprocessingFlag::eWELD_VERTICES;
+			params.meshWeldTolerance = weld_tolerance;
+		}
+		params.meshPreprocessParams = flags;
+
+		//the remap table is only needed to map contacts back to source triangles
+		params.suppressTriangleMeshRemapTable = runtime;
+
+		return params;
+	}
+
+	string CookingOptions::Name() const
+	{
+		stringstream name;
+		name << ((midphase == PxMeshMidPhase::eBVH33) ? "BVH33" : "BVH34")
+			<< (runtime ? " runtime" : " quality");
+		if (weld_tolerance > 0.f)
+			name << " weld " << weld_tolerance;
+		if (!clean_mesh)
+			name << " no-clean";
+		if (!active_edges)
+			name << " no-active-edges";
+		return name.str();
+	}
+
+	bool CookingOptions::operator==(const CookingOptions& other) const
+	{
+		return (midphase == other.midphase) && (weld_tolerance == other.weld_tolerance) && (clean_mesh == other.clean_mesh) &&
+			(active_edges == other.active_edges) && (runtime == other.runtime);
+	}
+
 	PxMaterial* GetMaterial(PxU32 index)
 	{
 		std::vector<PxMaterial*> materials(physics->getNbMaterials());
@@ -146,6 +297,13 @@ namespace PhysicsEngine
 		}
 	}
 
+	void Actor::RenderModel(const std::shared_ptr<const Model>& model, PxU32 shape_index)
+	{
+		std::vector<PxShape*> shape_list = GetShapes(shape_index);
+		for (PxU32 i = 0; i < shape_list.size(); i++)
+			((UserData*)shape_list[i]->userData)->render_model = model;
+	}
+
 	PxShape* Actor::GetShape(PxU32 index)
 	{
 		std::vector<PxShape*> shapes(((PxRigidActor*)actor)->getNbShapes());
@@ -317,6 +475,11 @@ namespace PhysicsEngine
 		px_scene->addActor(*actor);
 	}
 
+	void Scene::Remove(Actor* actor)
+	{
+		px_scene->removeActor(*actor->Get());
+	}
+
 	PxScene* Scene::Get() 
 	{ 
 		return px_scene; 
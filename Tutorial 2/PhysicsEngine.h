@@ -17,12 +17,58 @@ namespace PhysicsEngine
 	///Release PhysX resources
 	void PxRelease();
 
+	///Bytes PhysX has allocated and not freed yet, for measuring the memory of single objects
+	size_t PxAllocatedBytes();
+
 	///Get the PxPhysics object
 	PxPhysics* GetPhysics();
 
 	///Get the cooking object
 	PxCooking* GetCooking();
 
+	///Per-mesh cooking options
+	///Runtime options favour cooking speed (meshes cooked while the game runs),
+	///the other presets favour query and contact performance (meshes cooked offline or cached).
+	struct CookingOptions
+	{
+		//midphase structure (BVH33 or BVH34)
+		PxMeshMidPhase::Enum midphase;
+		//vertices closer than this are welded, 0 disables welding (requires clean_mesh)
+		PxReal weld_tolerance;
+		//remove duplicate vertices and degenerate triangles
+		bool clean_mesh;
+		//precompute active edges for smoother contacts
+		bool active_edges;
+		//favour cooking speed over runtime performance
+		bool runtime;
+
+		///Default options, identical to the PxCookingParams built by PxInit
+		CookingOptions()
+			: midphase(PxMeshMidPhase::eBVH33), weld_tolerance(0.f), clean_mesh(true), active_edges(true), runtime(false)
+		{
+		}
+
+		///Fastest cooking: BVH34, no cleaning and no active edges precompute
+		static CookingOptions Runtime();
+
+		///Offline quality BVH33
+		static CookingOptions QualityBVH33(PxReal weld_tolerance=1e-3f);
+
+		///Offline quality BVH34
+		static CookingOptions QualityBVH34(PxReal weld_tolerance=1e-3f);
+
+		///Build the cooking parameters
+		PxCookingParams Params(const PxTolerancesScale& scale) const;
+
+		///Short description for reports
+		string Name() const;
+
+		bool operator==(const CookingOptions& other) const;
+	};
+
+	///Get the cooking object configured with the given options
+	PxCooking* GetCooking(const CookingOptions& options);
+
 	///Get the specified material
 	PxMaterial* GetMaterial(PxU32 index=0);
 
@@ -59,6 +105,9 @@ namespace PhysicsEngine
 
 		void Material(PxMaterial* new_material, PxU32 shape_index=-1);
 
+		///Draw a model instead of the collision mesh (e.g. the full detail model), shared by the shapes and the render snapshots
+		void RenderModel(const std::shared_ptr<const Model>& model, PxU32 shape_index=-1);
+
 		PxShape* GetShape(PxU32 index=0);
 
 		std::vector<PxShape*> Actor::GetShapes(PxU32 index=-1);
@@ -136,6 +185,9 @@ namespace PhysicsEngine
 
 		void Add(PxActor* actor);
 
+		///Remove actors
+		void Remove(Actor* actor);
+
 		///Get the PxScene object
 		PxScene* Get();
 
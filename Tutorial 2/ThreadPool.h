@@ -0,0 +1,186 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///A fixed set of worker threads executing queued jobs in submission order
+	class ThreadPool
+	{
+		vector<thread> workers;
+		queue<function<void()> > jobs;
+		mutex jobs_mutex;
+		condition_variable jobs_available;
+		bool stopping;
+
+		void Work()
+		{
+			for (;;)
+			{
+				function<void()> job;
+				{
+					unique_lock<mutex> lock(jobs_mutex);
+					jobs_available.wait(lock, [this] { return stopping || !jobs.empty(); });
+					if (stopping && jobs.empty())
+						return;
+					job = move(jobs.front());
+					jobs.pop();
+				}
+				job();
+			}
+		}
+
+	public:
+		///Create a pool, by default with one worker per hardware thread
+		explicit ThreadPool(unsigned int count = 0)
+			: stopping(false)
+		{
+			if (count == 0)
+				count = thread::hardware_concurrency();
+			if (count == 0)
+				count = 1;
+
+			for (unsigned int i = 0; i < count; i++)
+				workers.push_back(thread(&ThreadPool::Work, this));
+		}
+
+		///Finish the queued jobs and join the workers
+		~ThreadPool()
+		{
+			{
+				lock_guard<mutex> lock(jobs_mutex);
+				stopping = true;
+			}
+			jobs_available.notify_all();
+			for (unsigned int i = 0; i < workers.size(); i++)
+				workers[i].join();
+		}
+
+		///Queue a job, the returned future holds its result (or exception)
+		template<class F>
+		auto Submit(F job) -> future<decltype(job())>
+		{
+			typedef decltype(job()) Result;
+			shared_ptr<packaged_task<Result()> > task = make_shared<packaged_task<Result()> >(move(job));
+			future<Result> result = task->get_future();
+			Post([task] { (*task)(); });
+			return result;
+		}
+
+		///Queue a job without a result
+		void Post(function<void()> job)
+		{
+			{
+				lock_guard<mutex> lock(jobs_mutex);
+				jobs.push(move(job));
+			}
+			jobs_available.notify_one();
+		}
+
+		///Number of worker threads
+		unsigned int Size() const
+		{
+			return (unsigned int)workers.size();
+		}
+	};
+
+	///Jobs split off one piece of work and waited for together
+	///The jobs run on the pool, but a thread waiting for the group runs the ones not started yet itself,
+	///so a job can wait for a group of its own without starving the pool. It never runs unrelated jobs of the pool.
+	class TaskGroup
+	{
+		//shared with the pool jobs, which can outlive the group when the waiter ran their job first
+		struct State
+		{
+			mutex jobs_mutex;
+			condition_variable jobs_done;
+			queue<function<void()> > jobs;
+			//queued and running jobs
+			unsigned int pending;
+
+			State() : pending(0) {}
+
+			//run the next job of the group if it has not been started, returns false if there is none
+			bool RunNext()
+			{
+				function<void()> job;
+				{
+					lock_guard<mutex> lock(jobs_mutex);
+					if (jobs.empty())
+						return false;
+					job = move(jobs.front());
+					jobs.pop();
+				}
+				job();
+
+				lock_guard<mutex> lock(jobs_mutex);
+				if (--pending == 0)
+					jobs_done.notify_all();
+				return true;
+			}
+		};
+
+		ThreadPool& pool;
+		shared_ptr<State> state;
+
+		TaskGroup(const TaskGroup&);
+		TaskGroup& operator=(const TaskGroup&);
+
+	public:
+		explicit TaskGroup(ThreadPool& pool)
+			: pool(pool), state(make_shared<State>())
+		{
+		}
+
+		///Waits for the jobs, a group can not be left with jobs running
+		~TaskGroup()
+		{
+			Wait();
+		}
+
+		///Queue a job of the group, the returned future holds its result (or exception)
+		template<class F>
+		auto Submit(F job) -> future<decltype(job())>
+		{
+			typedef decltype(job()) Result;
+			shared_ptr<packaged_task<Result()> > task = make_shared<packaged_task<Result()> >(move(job));
+			future<Result> result = task->get_future();
+			{
+				lock_guard<mutex> lock(state->jobs_mutex);
+				state->jobs.push([task] { (*task)(); });
+				state->pending++;
+			}
+
+			//one pool job per group job, it finds nothing to do if the waiter got there first
+			shared_ptr<State> group_state = state;
+			pool.Post([group_state] { group_state->RunNext(); });
+			return result;
+		}
+
+		///Run the jobs not started yet on the calling thread and wait for the others to finish
+		void Wait()
+		{
+			while (state->RunNext())
+				;
+
+			unique_lock<mutex> lock(state->jobs_mutex);
+			state->jobs_done.wait(lock, [this] { return state->pending == 0; });
+		}
+	};
+
+	///Pool shared by the loaders
+	inline ThreadPool& GetThreadPool()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+}
@@ -1,5 +1,8 @@
 #include <iostream>
 #include "VisualDebugger.h"
+#include "Benchmarks.h"
+#include "MeshLoader.h"
+#include "BinaryMesh.h"
 
 /*
 * In this assignment I wanted to push my limits of my programming ability to get the most out of it. So I aimed to make a high detailed golf course
@@ -31,8 +34,97 @@
 
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
+	//command line tools: --bench <name> [arguments]
+	if ((argc > 1) && (string(argv[1]) == "--bench"))
+	{
+		try
+		{
+			return Benchmarks::Run(argc - 2, argv + 2) ? 0 : 1;
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			return 1;
+		}
+	}
+
+	//offline conversion of models into binary meshes next to them: --convert <model.obj>...
+	if ((argc > 2) && (string(argv[1]) == "--convert"))
+	{
+		int failed = 0;
+		for (int i = 2; i < argc; i++)
+		{
+			string mesh_path = PhysicsEngine::BinaryMeshPath(argv[i]);
+			PhysicsEngine::BinaryMesh mesh;
+			//a malformed model is reported and skipped, the rest are still converted
+			try
+			{
+				if (!PhysicsEngine::ConvertToBinaryMesh(argv[i], mesh_path) || !mesh.Open(mesh_path) || !mesh.Verify())
+				{
+					cerr << argv[i] << ": conversion failed" << endl;
+					failed++;
+					continue;
+				}
+			}
+			catch (Exception* exc)
+			{
+				cerr << argv[i] << ": " << exc->what() << endl;
+				delete exc;
+				failed++;
+				continue;
+			}
+			cout << argv[i] << " -> " << mesh_path << ": " << mesh.VertexCount() << " verts, " << mesh.IndexCount() / 3 << " trigs, hash "
+				<< hex << mesh.ContentHash() << dec << endl;
+		}
+		return failed ? 1 : 0;
+	}
+
+	//offline convex decomposition into the mesh cache: --decompose <model.obj> [max hulls]
+	//the model goes through the loader like at runtime, so the stored hulls are found by a COMPOUND model
+	//loaded with the same number of hulls
+	if ((argc > 2) && (string(argv[1]) == "--decompose"))
+	{
+		try
+		{
+			PhysicsEngine::PxInit();
+			PhysicsEngine::DecompositionParams params;
+			if (argc > 3)
+				params.max_hulls = (physx::PxU32)atoi(argv[3]);
+			{
+				PhysicsEngine::MeshLoader loader;
+				loader.Add(argv[2], PhysicsEngine::MeshType::COMPOUND, PhysicsEngine::CookingOptions(), 0.f, physx::PxVec3(1.f), params);
+				loader.Load();
+				cout << argv[2] << ": " << loader.Get(0).convex_hulls.size() << " hulls stored in " << PhysicsEngine::MeshCacheDirectory() << endl;
+			}
+			PhysicsEngine::PxRelease();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	//the game without a window, frames stored as PNG files: --headless [frames] [directory]
+	//a driver without pbuffers (EGL or WGL_ARB_pbuffer) reports that no offscreen context can be created
+	if ((argc > 1) && (string(argv[1]) == "--headless"))
+	{
+		try
+		{
+			unsigned int frame_count = (argc > 2) ? (unsigned int)atoi(argv[2]) : 600;
+			VisualDebugger::Capture(800, 800, frame_count, (argc > 3) ? argv[3] : "capture");
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			return 1;
+		}
+		return 0;
+	}
+
 	try 
 	{ 
 		VisualDebugger::Init("Tutorial 2", 800, 800); 
@@ -3,11 +3,15 @@
 
 namespace PhysicsEngine
 {
-	struct Vertex
+	///Interleaved vertex of a Model, 32 bytes and 16 byte aligned
+	///The members are in the order of the GL_T2F_N3F_V3F interleaved array format, so an array of vertices
+	///can be handed to OpenGL in one call: glInterleavedArrays(GL_T2F_N3F_V3F, sizeof(Vertex), vertices).
+	struct alignas(16) Vertex
 	{
-		PxVec3 position;
-		PxVec3 color;
 		PxVec2 texcoord;
 		PxVec3 normal;
+		PxVec3 position;
 	};
-}
\ No newline at end of file
+
+	static_assert(sizeof(Vertex) == 32, "Vertex has to stay tightly packed for the interleaved arrays");
+}
@@ -3,6 +3,12 @@
 #include "Extras\Camera.h"
 #include "Extras\Renderer.h"
 #include "Extras\HUD.h"
+#include "Extras\FrameCapture.h"
+#include "Extras\TripleBuffer.h"
+#include "FileIO.h"
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 namespace VisualDebugger
 {
@@ -20,7 +26,8 @@ namespace VisualDebugger
 		EMPTY = 0,
 		HELP = 1,
 		PAUSE = 2,
-		WIN = 3
+		WIN = 3,
+		LOADING = 4
 	};
 
 	//function declarations
@@ -38,11 +45,20 @@ namespace VisualDebugger
 	void mouseCallback(int button, int state, int x, int y);
 	void exitCallback(void);
 
+	void QueueKeyPress(unsigned char key, int x, int y);
+	void QueueKeyRelease(unsigned char key, int x, int y);
+	void QueueKeySpecial(int key, int x, int y);
+	void QueueMouse(int button, int state, int x, int y);
+	void QueueMotion(int x, int y);
+	void QueuePassiveMotion(int x, int y);
+	void HandleInput();
+
 	void continuousMotionCallback(int x, int y);
 
 	void RenderScene();
+	void Simulate();
 	void ToggleRenderMode();
-	void HUDInit();
+	void HUDInit(HUD& hud);
 
 	void UpdateCamera(PxRigidBody* currentActor);
 	void CameraInput(int key);
@@ -58,7 +74,56 @@ namespace VisualDebugger
 	bool key_state[MAX_KEYS];
 	bool mouse_state[MAX_MOUSE_KEYS];
 	bool hud_show = true;
-	HUD hud;
+
+	typedef std::chrono::steady_clock Clock;
+
+	///Everything drawn in a frame, filled by the simulation thread after each step
+	struct RenderFrame
+	{
+		Renderer::RenderSnapshot scene;
+		PxVec3 camera_eye;
+		PxVec3 camera_dir;
+		//the camera at the step before, blended like the shapes
+		PxVec3 previous_camera_eye;
+		PxVec3 previous_camera_dir;
+		//when the step was due, the frame is drawn between the previous step and this one until the next is due
+		Clock::time_point step_time;
+		HUD hud;
+	};
+
+	void Step(const Clock::time_point& step_time);
+	void DrawFrame(RenderFrame& frame, PxReal alpha);
+
+	///Threads
+	//the simulation, game logic, input handling and camera run on their own thread at the fixed step,
+	//the GLUT thread draws the latest frame they published
+	std::thread simulation_thread;
+	std::atomic<bool> simulating(false);
+	TripleBuffer<RenderFrame> frames;
+
+	//input events queued by the GLUT callbacks and handled on the simulation thread, without locks
+	struct InputEvent
+	{
+		enum Type
+		{
+			KEY_PRESS,
+			KEY_RELEASE,
+			KEY_SPECIAL,
+			MOUSE,
+			MOTION,
+			PASSIVE_MOTION
+		};
+
+		Type type;
+		int key;
+		int state;
+		int x;
+		int y;
+	};
+	const unsigned int INPUT_QUEUE_SIZE = 256;
+	InputEvent input_queue[INPUT_QUEUE_SIZE];
+	std::atomic<unsigned int> input_head(0);
+	std::atomic<unsigned int> input_tail(0);
 
 	///Mouse Handling
 	int mMouseX = 0;
@@ -119,22 +184,19 @@ namespace VisualDebugger
 
 		camera = new Camera(PxVec3(0.0f, 5.0f, 15.0f), PxVec3(0.f, -.5f, -1.f), 5.f);
 
-		//initialise HUD
-		HUDInit();
-
 		///Assign callbacks
 		//render
 		glutDisplayFunc(RenderScene);
 
 		//keyboard
-		glutKeyboardFunc(KeyPress);
-		glutSpecialFunc(KeySpecial);
-		glutKeyboardUpFunc(KeyRelease);
+		glutKeyboardFunc(QueueKeyPress);
+		glutSpecialFunc(QueueKeySpecial);
+		glutKeyboardUpFunc(QueueKeyRelease);
 
 		//mouse
-		glutMouseFunc(mouseCallback);
-		glutMotionFunc(motionCallback);
-		glutPassiveMotionFunc(continuousMotionCallback);
+		glutMouseFunc(QueueMouse);
+		glutMotionFunc(QueueMotion);
+		glutPassiveMotionFunc(QueuePassiveMotion);
 
 
 		//exit
@@ -144,7 +206,7 @@ namespace VisualDebugger
 		motionCallback(0, 0);
 	}
 
-	void HUDInit()
+	void HUDInit(HUD& hud)
 	{
 
 		string amountOfShotsSTR = to_string(shotsTaken);
@@ -165,11 +227,15 @@ namespace VisualDebugger
 		hud.AddLine(HELP, "    F5 - help on/off");
 		hud.AddLine(HELP, "    F6 - shadows on/off");
 		hud.AddLine(HELP, "    F7 - render mode");
+		hud.AddLine(HELP, "    shapes drawn: " + to_string(Renderer::DrawnShapes()) + ", culled: " + to_string(Renderer::CulledShapes()));
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Camera");
 		hud.AddLine(HELP, "    mouse + click - change orientation");
 		hud.AddLine(HELP, "    F8 - reset view");
 		hud.AddLine(HELP, "");
+		hud.AddLine(HELP, " Capture");
+		hud.AddLine(HELP, "    F11 - record frames to capture/ on/off" + string(Renderer::Capturing() ? " (recording)" : ""));
+		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Special");
 		hud.AddLine(HELP, "    F1 - Change the current ball that is being played with");
 		hud.AddLine(HELP, "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n Power of Shot: " + powerOfShot);
@@ -184,6 +250,12 @@ namespace VisualDebugger
 		//Winning Screen
 		hud.AddLine(WIN, "\n\n\n\n\n    " + courseScore);
 
+		//loading screen, shown until the models and the first chunks of the course are in
+		hud.AddLine(LOADING, "");
+		hud.AddLine(LOADING, "");
+		hud.AddLine(LOADING, "");
+		hud.AddLine(LOADING, "   " + scene->LoadingStatus());
+
 		switch (hud.ActiveScreen())
 		{
 		case EMPTY:
@@ -210,17 +282,60 @@ namespace VisualDebugger
 			//set font color for all screens
 			hud.Color(PxVec3(0.f, 0.f, 0.f));
 			break;
+		case LOADING:
+			hud.FontSize(0.02f);
+			hud.Color(PxVec3(0.f, 0.f, 0.f));
+			break;
 		}
 	}
 
 	//----------------------------------
 
-	//Start the main loop
+	//Start the simulation thread and the main loop
 	void Start()
 	{
+		simulating = true;
+		simulation_thread = std::thread(Simulate);
 		glutMainLoop();
 	}
 
+	void Capture(int width, int height, unsigned int frame_count, const std::string& directory)
+	{
+		if (!Renderer::InitHeadless(width, height))
+			throw new Exception("VisualDebugger::Capture, cannot create an offscreen OpenGL context.");
+		if (!PhysicsEngine::CreateDirectories(directory))
+			throw new Exception("VisualDebugger::Capture, cannot create the capture directory.");
+
+		///Init PhysX
+		PhysicsEngine::PxInit();
+		scene = new PhysicsEngine::MyScene();
+		scene->Init();
+
+		screenWidth = width;
+		screenHeight = height;
+
+		///Init renderer
+		Renderer::BackgroundColor(PxVec3(150.f / 255.f, 150.f / 255.f, 150.f / 255.f));
+		Renderer::SetRenderDetail(40);
+		Renderer::Init();
+
+		camera = new Camera(PxVec3(0.0f, 5.0f, 15.0f), PxVec3(0.f, -.5f, -1.f), 5.f);
+
+		//no simulation thread: the steps run back to back and every frame shows its own step,
+		//so a capture is the same at any speed the machine draws it
+		Renderer::StartCapture(directory + "/frame_%05d.png", Renderer::CaptureFormat::PNG);
+		Clock::time_point step_time = Clock::now();
+		for (unsigned int i = 0; i < frame_count; i++)
+		{
+			Step(step_time);
+			step_time += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<PxReal>(delta_time));
+			frames.Acquire();
+			DrawFrame(frames.Front(), 1.f);
+		}
+
+		exitCallback();
+	}
+
 	void Update()
 	{
 		//Check if the ball is not moving to update how much the power of the shot is.
@@ -274,8 +389,6 @@ namespace VisualDebugger
 			}
 		}
 
-		HUDInit();
-
 		if (scene->my_callback->trigger || scene->my_callback->collision)
 		{
 			//Enter
@@ -350,13 +463,57 @@ namespace VisualDebugger
 			scene->triggered = false;
 	}
 
-	//Render the scene and perform a single simulation step
-	void RenderScene()
+	//Hand the state of the step to the render thread
+	void PublishFrame(const Clock::time_point& step_time)
+	{
+		static PxVec3 step_eye = camera->getEye();
+		static PxVec3 step_dir = camera->getDir();
+
+		RenderFrame& frame = frames.Back();
+		frame.previous_camera_eye = step_eye;
+		frame.previous_camera_dir = step_dir;
+		frame.camera_eye = step_eye = camera->getEye();
+		frame.camera_dir = step_dir = camera->getDir();
+		frame.step_time = step_time;
+
+		if ((render_mode == NORMAL) || (render_mode == BOTH))
+		{
+			std::vector<PxActor*> actors = scene->GetAllActors();
+			frame.scene.Take(actors.size() ? &actors[0] : 0, (PxU32)actors.size());
+		}
+		else
+			frame.scene.Clear();
+
+		if ((render_mode == DEBUG) || (render_mode == BOTH))
+			frame.scene.debug.Take(scene->Get()->getRenderBuffer());
+
+		//adjust the HUD state
+		if (scene->Loading())
+			frame.hud.ActiveScreen(LOADING);
+		else if (hud_show)
+		{
+			if (scene->Pause())
+				frame.hud.ActiveScreen(PAUSE);
+			else if (holeComplete)
+				frame.hud.ActiveScreen(WIN);
+			else
+				frame.hud.ActiveScreen(HELP);
+		}
+		else
+			frame.hud.ActiveScreen(EMPTY);
+		HUDInit(frame.hud);
+
+		frames.Publish();
+	}
+
+	//Handle the input and perform a single simulation step
+	void Step(const Clock::time_point& step_time)
 	{
 		//Update Loops
 		//FixedUpdate(); // Physics
 
 		//Handle Input States
+		HandleInput();
 		KeyHold();
 		MouseHold();
 
@@ -372,40 +529,6 @@ namespace VisualDebugger
 		if (!zooming)
 			UpdateCamera(scene->GetSelectedActor());
 
-		//Rendering
-		Renderer::Start(camera->getEye(), camera->getDir());
-
-		if ((render_mode == DEBUG) || (render_mode == BOTH))
-		{
-			Renderer::Render(scene->Get()->getRenderBuffer());
-		}
-
-		if ((render_mode == NORMAL) || (render_mode == BOTH))
-		{
-			std::vector<PxActor*> actors = scene->GetAllActors();
-			if (actors.size())
-				Renderer::Render(&actors[0], (PxU32)actors.size());
-		}
-
-		//adjust the HUD state
-		if (hud_show)
-		{
-			if (scene->Pause())
-				hud.ActiveScreen(PAUSE);
-			else if (holeComplete)
-				hud.ActiveScreen(WIN);
-			else
-				hud.ActiveScreen(HELP);
-		}
-		else
-			hud.ActiveScreen(EMPTY);
-
-		//render HUD
-		hud.Render();
-
-		//finish rendering
-		Renderer::Finish();
-
 		//Stop the balls velocity when it is slowing down so it doesn't take too long to shoot again.
 		if (scene->GetSelectedActor()->getLinearVelocity().normalize() <= 0.1f && ballMoving)
 		{
@@ -418,6 +541,73 @@ namespace VisualDebugger
 				ballMoving = false;
 			}
 		}
+
+		PublishFrame(step_time);
+	}
+
+	//The simulation thread, a step every delta_time independent of the frame rate
+	void Simulate()
+	{
+		const Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<PxReal>(delta_time));
+		Clock::time_point next_step = Clock::now();
+
+		while (simulating)
+		{
+			Clock::time_point now = Clock::now();
+			if (now < next_step)
+			{
+				std::this_thread::sleep_until(next_step);
+				continue;
+			}
+
+			//after a stall (e.g. a window drag) carry on from now instead of catching up
+			Clock::time_point step_time = next_step;
+			next_step += step;
+			if (now - next_step > 10 * step)
+				next_step = now;
+
+			Step(step_time);
+		}
+	}
+
+	//Draw the latest frame of the simulation, moved on towards the next step by the time since it was due
+	void RenderScene()
+	{
+		static bool frame_ready = false;
+		if (frames.Acquire())
+			frame_ready = true;
+		if (!frame_ready)
+			return;
+
+		RenderFrame& frame = frames.Front();
+
+		//the part of a step the simulation has run ahead of the frame, which is drawn that far from the step
+		//before towards its own: a step behind the simulation, but moving smoothly at any frame rate
+		PxReal alpha = std::chrono::duration<PxReal>(Clock::now() - frame.step_time).count() / delta_time;
+		DrawFrame(frame, PxClamp(alpha, 0.f, 1.f));
+	}
+
+	//Draw a frame moved alpha of the way from the step before towards its own
+	void DrawFrame(RenderFrame& frame, PxReal alpha)
+	{
+		frame.scene.Interpolate(alpha);
+		PxVec3 camera_eye = frame.previous_camera_eye + (frame.camera_eye - frame.previous_camera_eye) * alpha;
+		PxVec3 camera_dir = frame.previous_camera_dir + (frame.camera_dir - frame.previous_camera_dir) * alpha;
+		//the blend of two directions is shorter than both, down to nothing for opposite ones
+		if (camera_dir.normalize() < 1e-6f)
+			camera_dir = frame.camera_dir;
+
+		//Rendering
+		Renderer::Start(camera_eye, camera_dir);
+
+		Renderer::Render(frame.scene.debug);
+		Renderer::Render(frame.scene);
+
+		//render HUD
+		frame.hud.Render();
+
+		//finish rendering
+		Renderer::Finish();
 	}
 
 	//----------------------------------
@@ -480,7 +670,7 @@ namespace VisualDebugger
 		switch (button)
 		{
 		case 0: //Left
-			if (!ballMoving) // Checking if the ball is currently rolling otherwise the player can't shoot!
+			if (!ballMoving && !scene->Loading()) // Checking if the ball is currently rolling otherwise the player can't shoot!
 			{
 				//Need to sort out rotation of the camera and lock the ball in the centre of the screen otherwise
 				//shooting will be off centred as it uses the centre of the screen to shoot the ball with power.
@@ -544,6 +734,9 @@ namespace VisualDebugger
 		{
 			//Switch through the balls that you can play with.
 		case GLUT_KEY_F1:
+			//the other balls are still loading
+			if (scene->Loading())
+				break;
 			scene->GetSelectedActor()->setGlobalPose(PxTransform(PxVec3(0, 1, 100)));
 			scene->SelectNextActor();
 			scene->GetSelectedActor()->setGlobalPose(PxTransform(lastPosition));
@@ -553,10 +746,6 @@ namespace VisualDebugger
 			//hud on/off
 			hud_show = !hud_show;
 			break;
-		case GLUT_KEY_F6:
-			//shadows on/off
-			Renderer::ShowShadows(!Renderer::ShowShadows());
-			break;
 		case GLUT_KEY_F7:
 			//toggle render mode
 			ToggleRenderMode();
@@ -593,10 +782,6 @@ namespace VisualDebugger
 
 		key_state[key] = true;
 
-		//exit
-		if (key == 27)
-			exit(0);
-
 		UserKeyPress(key);
 	}
 
@@ -655,6 +840,106 @@ namespace VisualDebugger
 	//			Callbacks
 	//-----------------------------
 
+	//queue an event for the simulation thread, dropped if it fell that far behind
+	void PushInput(InputEvent::Type type, int key, int state, int x, int y)
+	{
+		unsigned int head = input_head.load(std::memory_order_relaxed);
+		if (head - input_tail.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE)
+			return;
+
+		InputEvent& input = input_queue[head % INPUT_QUEUE_SIZE];
+		input.type = type;
+		input.key = key;
+		input.state = state;
+		input.x = x;
+		input.y = y;
+		input_head.store(head + 1, std::memory_order_release);
+	}
+
+	//handle the queued events on the simulation thread
+	void HandleInput()
+	{
+		unsigned int tail = input_tail.load(std::memory_order_relaxed);
+		unsigned int head = input_head.load(std::memory_order_acquire);
+		for (; tail != head; tail++)
+		{
+			const InputEvent& input = input_queue[tail % INPUT_QUEUE_SIZE];
+			switch (input.type)
+			{
+			case InputEvent::KEY_PRESS:
+				KeyPress((unsigned char)input.key, input.x, input.y);
+				break;
+			case InputEvent::KEY_RELEASE:
+				KeyRelease((unsigned char)input.key, input.x, input.y);
+				break;
+			case InputEvent::KEY_SPECIAL:
+				KeySpecial(input.key, input.x, input.y);
+				break;
+			case InputEvent::MOUSE:
+				mouseCallback(input.key, input.state, input.x, input.y);
+				break;
+			case InputEvent::MOTION:
+				motionCallback(input.x, input.y);
+				break;
+			case InputEvent::PASSIVE_MOTION:
+				continuousMotionCallback(input.x, input.y);
+				break;
+			}
+		}
+		input_tail.store(tail, std::memory_order_release);
+	}
+
+	void QueueKeyPress(unsigned char key, int x, int y)
+	{
+		//exit
+		if (key == 27)
+			exit(0);
+
+		PushInput(InputEvent::KEY_PRESS, key, 0, x, y);
+	}
+
+	void QueueKeyRelease(unsigned char key, int x, int y)
+	{
+		PushInput(InputEvent::KEY_RELEASE, key, 0, x, y);
+	}
+
+	//the display keys change the renderer and are handled right away on the GLUT thread
+	void QueueKeySpecial(int key, int x, int y)
+	{
+		switch (key)
+		{
+		case GLUT_KEY_F6:
+			//shadows on/off
+			Renderer::ShowShadows(!Renderer::ShowShadows());
+			break;
+		case GLUT_KEY_F11:
+			//record frames on/off
+			if (Renderer::Capturing())
+				Renderer::StopCapture();
+			else if (PhysicsEngine::CreateDirectories("capture"))
+				Renderer::StartCapture("capture/frame%05d.png", Renderer::CaptureFormat::PNG);
+			break;
+		default:
+			PushInput(InputEvent::KEY_SPECIAL, key, 0, x, y);
+			break;
+		}
+	}
+
+	void QueueMouse(int button, int state, int x, int y)
+	{
+		PushInput(InputEvent::MOUSE, button, state, x, y);
+	}
+
+	void QueueMotion(int x, int y)
+	{
+		PushInput(InputEvent::MOTION, 0, 0, x, y);
+	}
+
+	void QueuePassiveMotion(int x, int y)
+	{
+		PushInput(InputEvent::PASSIVE_MOTION, 0, 0, x, y);
+	}
+
 	//Handle Mouse Movement when mouse button is pushed. Also handles mouse position
 	void motionCallback(int x, int y)
 	{
@@ -749,7 +1034,8 @@ namespace VisualDebugger
 	//handle force control keys
 	void ForceInput(int key)
 	{
-		if (!scene->GetSelectedActor())
+		//no forces on the balls held while loading
+		if (!scene->GetSelectedActor() || scene->Loading())
 			return;
 
 		switch (toupper(key))
@@ -783,6 +1069,15 @@ namespace VisualDebugger
 	//--------------------------------
 	void exitCallback(void)
 	{
+		//finish the step in progress
+		simulating = false;
+		if (simulation_thread.joinable())
+			simulation_thread.join();
+		//the frames hold references on the shapes
+		for (unsigned int i = 0; i < 3; i++)
+			frames[i].scene.Clear();
+		//store the frames still in flight
+		Renderer::StopCapture();
 		delete camera;
 		delete scene;
 		PhysicsEngine::PxRelease();
@@ -11,5 +11,9 @@ namespace VisualDebugger
 
 	///Start visualisation
 	void Start();
+
+	///Run the game without a window and store frame_count frames as PNG files in the directory,
+	///needs an offscreen OpenGL context (an EGL or WGL pbuffer, see Renderer::InitHeadless)
+	void Capture(int width, int height, unsigned int frame_count, const std::string& directory);
 }
 